@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Constant propagation and folding
+ */
+
+#include <algorithm>
+#include <deque>
+
+#include <libsolidity/codegen/ConstantPropagator.hpp>
+#include <libsolidity/codegen/TVMCommons.hpp>
+
+using namespace solidity;
+using namespace solidity::frontend;
+using namespace solidity::util;
+
+namespace {
+
+using Value = std::optional<bigint>;
+
+// Values on the top of the stack. Values below the tracked ones are unknown.
+class KnownStack {
+public:
+	Value get(int i) const {
+		return i < size() ? m_values.at(size() - 1 - i) : std::nullopt;
+	}
+
+	void push(Value const& value) {
+		m_values.emplace_back(value);
+	}
+
+	void pop(int n) {
+		m_values.resize(std::max(0, size() - n));
+	}
+
+	void clear() {
+		m_values.clear();
+	}
+
+	void apply(Stack const& _node) {
+		int const i = _node.i();
+		int const j = _node.j();
+		int const k = _node.k();
+		switch (_node.opcode()) {
+		case Stack::Opcode::DROP:
+			pop(i);
+			break;
+		case Stack::Opcode::BLKDROP2: {
+			std::vector<Value> values = top(i + j);
+			values.resize(j);
+			replaceTop(i + j, values);
+			break;
+		}
+		case Stack::Opcode::POP_S: {
+			std::vector<Value> values = top(i + 1);
+			values.at(i) = values.at(0);
+			values.erase(values.begin());
+			replaceTop(i + 1, values);
+			break;
+		}
+		case Stack::Opcode::BLKPUSH:
+			for (int n = 0; n < i; ++n)
+				push(get(j));
+			break;
+		case Stack::Opcode::PUSH_S:
+			push(get(i));
+			break;
+		case Stack::Opcode::PUSH2_S: {
+			Value const a = get(i);
+			Value const b = get(j);
+			push(a);
+			push(b);
+			break;
+		}
+		case Stack::Opcode::PUSH3_S: {
+			Value const a = get(i);
+			Value const b = get(j);
+			Value const c = get(k);
+			push(a);
+			push(b);
+			push(c);
+			break;
+		}
+		case Stack::Opcode::BLKSWAP: {
+			std::vector<Value> values = top(i + j);
+			std::rotate(values.begin(), values.begin() + j, values.end());
+			replaceTop(i + j, values);
+			break;
+		}
+		case Stack::Opcode::REVERSE: {
+			std::vector<Value> values = top(i + j);
+			std::reverse(values.begin() + j, values.end());
+			replaceTop(i + j, values);
+			break;
+		}
+		case Stack::Opcode::XCHG: {
+			std::vector<Value> values = top(std::max(i, j) + 1);
+			std::swap(values.at(i), values.at(j));
+			replaceTop(std::max(i, j) + 1, values);
+			break;
+		}
+		default:
+			applyCompound(_node);
+			break;
+		}
+	}
+
+private:
+	int size() const { return m_values.size(); }
+
+	// top n values, s0 is the first
+	std::vector<Value> top(int n) const {
+		std::vector<Value> values;
+		for (int i = 0; i < n; ++i)
+			values.emplace_back(get(i));
+		return values;
+	}
+
+	void replaceTop(int n, std::vector<Value> const& values) {
+		pop(n);
+		for (auto it = values.rbegin(); it != values.rend(); ++it)
+			push(*it);
+	}
+
+	// Compound opcodes are applied to a window of the stack by the model of the stack opcode squasher
+	void applyCompound(Stack const& _node) {
+		int const window = std::max({_node.i(), _node.j(), _node.k()}) + 2;
+		if (window + MAX_NEW_OPCODES > StackState::MAX_STACK_DEPTH) {
+			clear();
+			return;
+		}
+		StackState state{window};
+		if (!state.apply(_node.command())) {
+			clear();
+			return;
+		}
+		std::vector<Value> const old = top(window);
+		std::vector<Value> values;
+		for (int i = 0; i < state.size(); ++i)
+			values.emplace_back(old.at(state.values().at(i)));
+		replaceTop(window, values);
+	}
+
+private:
+	std::vector<Value> m_values; // the last one is s0
+};
+
+bigint floorDiv(bigint const& a, bigint const& b) {
+	bigint q = a / b;
+	if (q * b != a && (a < 0) != (b < 0))
+		--q;
+	return q;
+}
+
+bigint boolValue(bool value) {
+	return value ? -1 : 0;
+}
+
+// Evaluates the opcode on known arguments, `args[0]` is s0.
+// Returns nullopt if the opcode isn't supported or it throws an exception.
+Value evaluate(StackOpcode const& _op, std::vector<bigint> const& args) {
+	std::string const& op = _op.opcode();
+	Value res;
+	if (args.size() == 1) {
+		bigint const& x = args.at(0);
+		if (op == "INC") res = x + 1;
+		else if (op == "DEC") res = x - 1;
+		else if (op == "NEGATE") res = -x;
+		else if (op == "ABS") res = x < 0 ? -x : x;
+		else if (op == "SGN") res = x < 0 ? -1 : (x > 0 ? 1 : 0);
+		else if (op == "NOT") res = -x - 1;
+		else if (op == "ISNEG") res = boolValue(x < 0);
+		else if (op == "ISPOS") res = boolValue(x > 0);
+		else if (op == "ISNNEG") res = boolValue(x >= 0);
+		else if (op == "ISNPOS") res = boolValue(x <= 0);
+		else if (_op.intArg()) {
+			bigint const& c = *_op.intArg();
+			if (op == "ADDCONST") res = x + c;
+			else if (op == "MULCONST") res = x * c;
+			else if (op == "EQINT") res = boolValue(x == c);
+			else if (op == "NEQINT") res = boolValue(x != c);
+			else if (op == "LESSINT") res = boolValue(x < c);
+			else if (op == "GTINT") res = boolValue(x > c);
+		}
+	} else if (args.size() == 2) {
+		bigint const& a = args.at(1);
+		bigint const& b = args.at(0);
+		if (op == "ADD") res = a + b;
+		else if (op == "SUB") res = a - b;
+		else if (op == "SUBR") res = b - a;
+		else if (op == "MUL") res = a * b;
+		else if (op == "DIV" && b != 0) res = floorDiv(a, b);
+		else if (op == "MOD" && b != 0) res = a - floorDiv(a, b) * b;
+		else if (op == "MIN") res = std::min(a, b);
+		else if (op == "MAX") res = std::max(a, b);
+		else if (op == "EQUAL") res = boolValue(a == b);
+		else if (op == "NEQ") res = boolValue(a != b);
+		else if (op == "LESS") res = boolValue(a < b);
+		else if (op == "LEQ") res = boolValue(a <= b);
+		else if (op == "GREATER") res = boolValue(a > b);
+		else if (op == "GEQ") res = boolValue(a >= b);
+		else if (op == "CMP") res = a < b ? -1 : (a > b ? 1 : 0);
+		// bitwise operations on negative numbers are left to TVM
+		else if (a >= 0 && b >= 0) {
+			if (op == "AND") res = a & b;
+			else if (op == "OR") res = a | b;
+			else if (op == "XOR") res = a ^ b;
+		}
+	}
+	// integer overflow throws an exception
+	if (res && !isInRange257(*res))
+		return std::nullopt;
+	return res;
+}
+
+} // end anonymous namespace
+
+void ConstantPropagator::endVisit(CodeBlock &_node) {
+	std::deque<Pointer<TvmAstNode>> input{_node.instructions().begin(), _node.instructions().end()};
+	std::vector<Pointer<TvmAstNode>> output;
+	KnownStack stack;
+	bool changed = false;
+
+	while (!input.empty()) {
+		Pointer<TvmAstNode> const op = input.front();
+		input.pop_front();
+
+		if (to<Loc>(op.get())) {
+			output.emplace_back(op);
+		} else if (auto st = to<Stack>(op.get())) {
+			stack.apply(*st);
+			output.emplace_back(op);
+		} else if (auto opcode = to<StackOpcode>(op.get())) {
+			Value const pushed = opcode->pushedInt();
+			Value res;
+			if (!pushed && opcode->ret() == 1 && 1 <= opcode->take() && opcode->take() <= 2) {
+				std::vector<bigint> args;
+				for (int i = 0; i < opcode->take(); ++i)
+					if (Value const value = stack.get(i))
+						args.emplace_back(*value);
+				if (int(args.size()) == opcode->take())
+					res = evaluate(*opcode, args);
+			}
+			if (pushed) {
+				stack.push(pushed);
+				output.emplace_back(op);
+			} else if (res) {
+				output.emplace_back(makeDROP(opcode->take()));
+				output.emplace_back(gen("PUSHINT " + toString(*res)));
+				stack.pop(opcode->take());
+				stack.push(res);
+				++m_foldedInstructions;
+				changed = true;
+			} else {
+				stack.pop(opcode->take());
+				for (int i = 0; i < opcode->ret(); ++i)
+					stack.push(std::nullopt);
+				output.emplace_back(op);
+			}
+		} else if (auto glob = to<Glob>(op.get())) {
+			stack.pop(glob->take());
+			for (int i = 0; i < glob->ret(); ++i)
+				stack.push(std::nullopt);
+			output.emplace_back(op);
+		} else if (to<PushCellOrSlice>(op.get()) || to<DeclRetFlag>(op.get())) {
+			stack.push(std::nullopt);
+			output.emplace_back(op);
+		} else if (auto exc = to<TvmException>(op.get());
+			exc && exc->withIf() && !exc->withArg() && !exc->withAny() && stack.get(0)
+		) {
+			// THROWIF N / THROWIFNOT N
+			bool const throws = (*stack.get(0) != 0) != exc->withNot();
+			output.emplace_back(makeDROP());
+			stack.pop(1);
+			if (throws) {
+				output.emplace_back(makeTHROW("THROW " + exc->arg()));
+				stack.clear();
+			}
+			++m_foldedInstructions;
+			changed = true;
+		} else if (auto ret = to<TvmReturn>(op.get()); ret && ret->withIf() && stack.get(0)) {
+			// IFRET / IFNOTRET / IFRETALT / IFNOTRETALT
+			bool const returns = (*stack.get(0) != 0) != ret->withNot();
+			output.emplace_back(makeDROP());
+			stack.pop(1);
+			if (returns) {
+				output.emplace_back(createNode<TvmReturn>(false, false, ret->withAlt()));
+				stack.clear();
+			}
+			++m_foldedInstructions;
+			changed = true;
+		} else if (auto ifElse = to<TvmIfElse>(op.get());
+			ifElse && stack.get(0) && !(ifElse->withJmp() && ifElse->falseBody() != nullptr)
+		) {
+			bool const cond = (*stack.get(0) != 0) != ifElse->withNot();
+			Pointer<CodeBlock> const& body = cond ? ifElse->trueBody() : ifElse->falseBody();
+			output.emplace_back(makeDROP());
+			stack.pop(1);
+			if (body != nullptr) {
+				ContinuationExitChecker checker{[](std::string const&) { return false; }};
+				for (Pointer<TvmAstNode> const& i : body->instructions())
+					i->accept(checker);
+				if (ifElse->withJmp() || checker.canExit()) {
+					output.emplace_back(createNode<SubProgram>(0, ifElse->ret(), ifElse->withJmp(), body, false));
+					stack.clear();
+				} else {
+					// the body is analyzed as a part of the current block
+					input.insert(input.begin(), body->instructions().begin(), body->instructions().end());
+				}
+			}
+			++m_removedBranches;
+			changed = true;
+		} else {
+			if (auto exc = to<TvmException>(op.get()); exc && exc->withIf())
+				stack.pop(exc->take());
+			else if (auto ret = to<TvmReturn>(op.get()); ret && ret->withIf())
+				stack.pop(1);
+			else
+				// values below can be changed by nested blocks, assembly and so on
+				stack.clear();
+			output.emplace_back(op);
+		}
+	}
+
+	if (changed) {
+		_node.upd(output);
+		m_didSome = true;
+	}
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Constant propagation and folding
+ */
+
+#pragma once
+
+#include <libsolidity/codegen/TvmAstVisitor.hpp>
+
+namespace solidity::frontend {
+
+// Tracks integers that are pushed by PUSHINT/TRUE/FALSE through stack manipulations of a code block and
+// folds arithmetic, comparisons, conditional exceptions and returns on known values, e.g.
+//   PUSHINT 2           PUSHINT 2
+//   PUSH S2             PUSH S2
+//   SWAP            =>  SWAP
+//   INC                 DROP
+//                       PUSHINT 3
+// Then the stack optimizer removes values that aren't used anymore. `if` with a known condition is replaced
+// by its live branch or removed.
+// Each code block is analyzed with unknown values on the stack at its start, so shared blocks
+// (e.g. bodies of inline functions) are folded in the same way for all places where they are used.
+class ConstantPropagator : public TvmAstVisitor {
+public:
+	void endVisit(CodeBlock &_node) override;
+	bool didSome() const { return m_didSome; }
+	int foldedInstructions() const { return m_foldedInstructions; }
+	int removedBranches() const { return m_removedBranches; }
+private:
+	int m_foldedInstructions{};
+	int m_removedBranches{};
+	bool m_didSome{};
+};
+
+} // end solidity::frontend
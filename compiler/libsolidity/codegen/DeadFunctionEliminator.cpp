@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Removes functions that can't be reached from the entry points of a contract
+ */
+
+#include <limits>
+
+#include <boost/algorithm/string.hpp>
+
+#include <libsolidity/codegen/DeadFunctionEliminator.hpp>
+#include <libsolidity/codegen/SizeOptimizer.hpp>
+#include <libsolidity/codegen/TvmAst.hpp>
+
+using namespace solidity;
+using namespace solidity::frontend;
+
+namespace {
+
+// Collects functions that are referenced by a piece of code
+class FunctionReferenceCollector : public TvmAstVisitor {
+public:
+	bool visit(StackOpcode &_node) override {
+		if (_node.opcode() == ".inline") {
+			m_names.insert(_node.arg());
+		} else if (_node.opcode() == "CALL" && _node.intArg()) {
+			m_ints.insert(*_node.intArg());
+		} else if (std::optional<bigint> value = _node.pushedInt(); value && _node.symbol() == Opcodes::PUSHINT()) {
+			// id of a private function, e.g. a function pointer or an argument of CALLX with c3
+			m_ints.insert(*value);
+		}
+		return false;
+	}
+
+	bool visit(PushCellOrSlice &_node) override {
+		if (_node.type() == PushCellOrSlice::Type::PUSHREF_COMPUTE ||
+			_node.type() == PushCellOrSlice::Type::PUSHREFSLICE_COMPUTE
+		)
+			m_names.insert(_node.blob());
+		return false;
+	}
+
+	bool visit(HardCode &_node) override {
+		for (std::string const& line : _node.code()) {
+			std::string const code = boost::trim_copy(line);
+			if (boost::starts_with(code, ".inline ")) {
+				m_names.insert(boost::trim_copy(code.substr(std::string{".inline "}.size())));
+			} else if (boost::starts_with(code, "x") && boost::ends_with(code, ",") && code.find(" = ") != std::string::npos) {
+				// entry of DICTPUSHCONST, e.g. the public function selector: `x<key> = name,`
+				std::string const name = code.substr(code.find(" = ") + 3);
+				m_names.insert(boost::trim_copy(name.substr(0, name.size() - 1)));
+			} else if (boost::starts_with(code, "PUSHINT ")) {
+				// any pushed integer can be the id of a private function, as in StackOpcode
+				StackOpcode const opcode{boost::trim_copy(code.substr(0, code.find(';'))), 0, 1};
+				if (std::optional<bigint> value = opcode.pushedInt())
+					m_ints.insert(*value);
+			} else if (
+				boost::starts_with(code, "CALL ") || boost::starts_with(code, "CALLDICT") ||
+				boost::starts_with(code, "JMP ") || boost::starts_with(code, "JMPDICT") ||
+				boost::starts_with(code, "PREPARE")
+			) {
+				// assembly code can call any private function
+				m_callsAnyPrivateFunction = true;
+			}
+		}
+		return false;
+	}
+
+	std::set<std::string> const& names() const { return m_names; }
+	std::set<bigint> const& ints() const { return m_ints; }
+	bool callsAnyPrivateFunction() const { return m_callsAnyPrivateFunction; }
+private:
+	std::set<std::string> m_names;
+	std::set<bigint> m_ints;
+	bool m_callsAnyPrivateFunction{};
+};
+
+} // end anonymous namespace
+
+void DeadFunctionEliminator::eliminate(Pointer<Contract>& c) {
+	if (c->contractType() != Contract::ContractType::Contract)
+		return;
+
+	std::map<std::string, Pointer<Function>> functions;
+	for (Pointer<Function> const& f : c->functions())
+		functions.emplace(f->name(), f);
+	std::map<uint32_t, std::string> const& privateFunctions = c->privateFunctions();
+
+	std::set<std::string> reachable;
+	std::vector<Pointer<Function>> worklist;
+	auto reach = [&](std::string const& name) {
+		auto it = functions.find(name);
+		if (it != functions.end() && reachable.insert(name).second)
+			worklist.emplace_back(it->second);
+	};
+
+	// entry points of the code dictionary and the data cell, see Printer::visit(Contract&),
+	// and functions that are called by messages
+	for (std::string const& name : m_entryPoints)
+		reach(name);
+	for (Pointer<Function> const& f : c->functions()) {
+		switch (f->type()) {
+		case Function::FunctionType::MainInternal:
+		case Function::FunctionType::MainExternal:
+		case Function::FunctionType::OnCodeUpgrade:
+		case Function::FunctionType::OnTickTock:
+		case Function::FunctionType::PublicStateVariableGetter:
+			reach(f->name());
+			break;
+		default:
+			if (c->saveAllFunction() && f->functionId().has_value())
+				reach(f->name());
+			break;
+		}
+	}
+	for (auto const& [id, name] : c->getters())
+		reach(name);
+	reach("default_data_cell");
+
+	std::set<uint32_t> usedIds;
+	bool keepAllPrivateFunctions = c->saveAllFunction();
+	auto usePrivateFunction = [&](uint32_t id, std::string const& name) {
+		usedIds.insert(id);
+		reach(name);
+	};
+	while (!worklist.empty()) {
+		Pointer<Function> f = worklist.back();
+		worklist.pop_back();
+
+		FunctionReferenceCollector collector;
+		f->accept(collector);
+		for (std::string const& name : collector.names())
+			reach(name);
+		for (bigint const& value : collector.ints()) {
+			if (value < 0 || value > std::numeric_limits<uint32_t>::max())
+				continue;
+			auto const id = static_cast<uint32_t>(value);
+			if (auto it = privateFunctions.find(id); it != privateFunctions.end())
+				usePrivateFunction(id, it->second);
+		}
+		if (collector.callsAnyPrivateFunction() && !keepAllPrivateFunctions) {
+			keepAllPrivateFunctions = true;
+			for (auto const& [id, name] : privateFunctions)
+				usePrivateFunction(id, name);
+		}
+	}
+
+	std::map<uint32_t, std::string> newPrivateFunctions;
+	for (auto const& [id, name] : privateFunctions) {
+		if (keepAllPrivateFunctions || usedIds.count(id)) {
+			newPrivateFunctions.emplace(id, name);
+		} else {
+			++m_removedPrivateFunctions;
+			if (auto it = functions.find(name); it != functions.end())
+				m_removedBits += codeSizeInBits(*it->second);
+		}
+	}
+
+	std::vector<Pointer<Function>> newFunctions;
+	for (Pointer<Function> const& f : c->functions()) {
+		if (reachable.count(f->name()))
+			newFunctions.emplace_back(f);
+		else
+			++m_removedFunctions;
+	}
+
+	c->updFunctions(std::move(newFunctions));
+	c->updPrivateFunctions(std::move(newPrivateFunctions));
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Removes functions that can't be reached from the entry points of a contract
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+
+#include <libsolidity/codegen/TvmAstVisitor.hpp>
+
+namespace solidity::frontend {
+
+class DeadFunctionEliminator {
+public:
+	// _entryPoints are names of functions that are called by messages: public functions, getters,
+	// receive, fallback, onBounce etc. They are kept even if no code refers to them.
+	explicit DeadFunctionEliminator(std::set<std::string> _entryPoints) : m_entryPoints{std::move(_entryPoints)} { }
+
+	// Removes unreachable functions and their entries in the dictionary of private functions.
+	// Libraries are not changed because all their functions can be called from outside.
+	void eliminate(Pointer<Contract>& c);
+
+	int removedFunctions() const { return m_removedFunctions; }
+	int removedPrivateFunctions() const { return m_removedPrivateFunctions; }
+	// estimated size of the code that is removed from the dictionary of private functions
+	int64_t removedBits() const { return m_removedBits; }
+private:
+	std::set<std::string> m_entryPoints;
+	int m_removedFunctions{};
+	int m_removedPrivateFunctions{};
+	int64_t m_removedBits{};
+};
+
+} // end solidity::frontend
@@ -0,0 +1,797 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Elimination of repeated dictionary lookups
+ */
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <libsolidity/codegen/DictLookupEliminator.hpp>
+#include <libsolidity/codegen/SlotInserter.hpp>
+#include <libsolidity/codegen/StackState.hpp>
+#include <libsolidity/codegen/TVMCommons.hpp>
+
+using namespace solidity::frontend;
+
+namespace {
+
+// Symbolic values. Equal numbers mean equal values.
+class ValueNumbers {
+public:
+	int fresh() { return m_next++; }
+
+	int of(std::string const& _key) {
+		auto [it, inserted] = m_numbers.emplace(_key, m_next);
+		if (inserted)
+			++m_next;
+		return it->second;
+	}
+
+private:
+	std::map<std::string, int> m_numbers;
+	int m_next{};
+};
+
+// Symbolic values of the stack. Values below the start of the function are named by their positions, so
+// they are numbered when they are reached.
+class ValueStack {
+public:
+	explicit ValueStack(ValueNumbers& _numbers) : m_numbers{&_numbers}, m_epoch{_numbers.fresh()} { }
+
+	int get(int i) {
+		int const pos = m_top - 1 - i;
+		materialize(pos);
+		return m_values.at(pos - m_base);
+	}
+
+	void push(int value) {
+		m_values.emplace_back(value);
+		++m_top;
+	}
+
+	void pushFresh(int n) {
+		for (int i = 0; i < n; ++i)
+			push(m_numbers->fresh());
+	}
+
+	void pop(int n) {
+		m_top -= n;
+		if (m_top < m_base) {
+			m_base = m_top;
+			m_values.clear();
+		} else
+			m_values.resize(m_top - m_base);
+	}
+
+	void apply(Stack const& _node) {
+		int const i = _node.i();
+		int const j = _node.j();
+		int const k = _node.k();
+		switch (_node.opcode()) {
+		case Stack::Opcode::DROP:
+			pop(i);
+			break;
+		case Stack::Opcode::BLKDROP2: {
+			std::vector<int> values = top(i + j);
+			values.resize(j);
+			replaceTop(i + j, values);
+			break;
+		}
+		case Stack::Opcode::POP_S: {
+			std::vector<int> values = top(i + 1);
+			values.at(i) = values.at(0);
+			values.erase(values.begin());
+			replaceTop(i + 1, values);
+			break;
+		}
+		case Stack::Opcode::BLKPUSH:
+			for (int n = 0; n < i; ++n)
+				push(get(j));
+			break;
+		case Stack::Opcode::PUSH_S:
+			push(get(i));
+			break;
+		case Stack::Opcode::PUSH2_S: {
+			int const a = get(i);
+			int const b = get(j);
+			push(a);
+			push(b);
+			break;
+		}
+		case Stack::Opcode::PUSH3_S: {
+			int const a = get(i);
+			int const b = get(j);
+			int const c = get(k);
+			push(a);
+			push(b);
+			push(c);
+			break;
+		}
+		case Stack::Opcode::BLKSWAP: {
+			std::vector<int> values = top(i + j);
+			std::rotate(values.begin(), values.begin() + j, values.end());
+			replaceTop(i + j, values);
+			break;
+		}
+		case Stack::Opcode::REVERSE: {
+			std::vector<int> values = top(i + j);
+			std::reverse(values.begin() + j, values.end());
+			replaceTop(i + j, values);
+			break;
+		}
+		case Stack::Opcode::XCHG: {
+			std::vector<int> values = top(std::max(i, j) + 1);
+			std::swap(values.at(i), values.at(j));
+			replaceTop(std::max(i, j) + 1, values);
+			break;
+		}
+		default:
+			applyCompound(_node);
+			break;
+		}
+	}
+
+	// All values may be changed
+	void invalidate() {
+		for (int& value : m_values)
+			value = m_numbers->fresh();
+		m_epoch = m_numbers->fresh();
+	}
+
+	// Keeps values that are equal in both stacks. Returns false if the stacks have different sizes.
+	bool merge(ValueStack& _other) {
+		if (m_top != _other.m_top)
+			return false;
+		int const base = std::min(m_base, _other.m_base);
+		materialize(base);
+		_other.materialize(base);
+		for (int pos = base; pos < m_top; ++pos)
+			if (m_values.at(pos - m_base) != _other.m_values.at(pos - _other.m_base))
+				m_values.at(pos - m_base) = m_numbers->fresh();
+		if (m_epoch != _other.m_epoch)
+			m_epoch = m_numbers->fresh();
+		return true;
+	}
+
+private:
+	// Numbers values from `pos` to the bottom of the tracked ones
+	void materialize(int pos) {
+		if (pos >= m_base)
+			return;
+		std::vector<int> values;
+		for (int p = pos; p < m_base; ++p)
+			values.emplace_back(m_numbers->of("outer " + std::to_string(p) + " " + std::to_string(m_epoch)));
+		m_values.insert(m_values.begin(), values.begin(), values.end());
+		m_base = pos;
+	}
+
+	// top n values, s0 is the first
+	std::vector<int> top(int n) {
+		std::vector<int> values;
+		for (int i = 0; i < n; ++i)
+			values.emplace_back(get(i));
+		return values;
+	}
+
+	void replaceTop(int n, std::vector<int> const& values) {
+		pop(n);
+		for (auto it = values.rbegin(); it != values.rend(); ++it)
+			push(*it);
+	}
+
+	// see KnownStack::applyCompound in ConstantPropagator
+	void applyCompound(Stack const& _node) {
+		int const window = std::max({_node.i(), _node.j(), _node.k()}) + 2;
+		StackState state{window};
+		if (window + MAX_NEW_OPCODES > StackState::MAX_STACK_DEPTH || !state.apply(_node.command())) {
+			invalidate();
+			return;
+		}
+		std::vector<int> const old = top(window);
+		std::vector<int> values;
+		for (int i = 0; i < state.size(); ++i)
+			values.emplace_back(old.at(state.values().at(i)));
+		replaceTop(window, values);
+	}
+
+private:
+	ValueNumbers* m_numbers;
+	std::vector<int> m_values; // m_values[0] is at the position m_base, the last one is s0
+	int m_base{}; // positions are counted from the start of the function
+	int m_top{};
+	int m_epoch{}; // changes when values below the tracked ones may be changed
+};
+
+// Name of the global variable or control register that is read or written by the node
+std::string globalName(Glob const& _glob) {
+	switch (_glob.opcode()) {
+	case Glob::Opcode::GetOrGetVar:
+	case Glob::Opcode::SetOrSetVar:
+		return "g" + std::to_string(_glob.index());
+	case Glob::Opcode::PUSHROOT:
+	case Glob::Opcode::POPROOT:
+		return "c4";
+	case Glob::Opcode::PUSH_C3:
+	case Glob::Opcode::POP_C3:
+		return "c3";
+	case Glob::Opcode::PUSH_C7:
+	case Glob::Opcode::POP_C7:
+		return "c7";
+	}
+	solUnimplemented("");
+}
+
+bool isGlobalWrite(Glob const& _glob) {
+	return isIn(_glob.opcode(), Glob::Opcode::SetOrSetVar, Glob::Opcode::POPROOT, Glob::Opcode::POP_C3,
+		Glob::Opcode::POP_C7);
+}
+
+// Symbolic values of global variables and control registers
+class GlobalValues {
+public:
+	explicit GlobalValues(ValueNumbers& _numbers) : m_numbers{&_numbers}, m_generation{_numbers.fresh()} { }
+
+	int read(std::string const& _name) const {
+		auto it = m_versions.find(_name);
+		int const version = it == m_versions.end() ? 0 : it->second;
+		return m_numbers->of("global " + _name + " " + std::to_string(m_generation) + " " + std::to_string(version));
+	}
+
+	void write(Glob const& _glob) {
+		if (_glob.opcode() == Glob::Opcode::POP_C7)
+			writeAll();
+		else {
+			write(globalName(_glob));
+			// global variables are stored in c7
+			if (_glob.opcode() == Glob::Opcode::SetOrSetVar)
+				write("c7");
+		}
+	}
+
+	void write(std::string const& _name) {
+		m_versions[_name] = m_numbers->fresh();
+	}
+
+	void writeAll() {
+		m_generation = m_numbers->fresh();
+		m_versions.clear();
+	}
+
+	void merge(GlobalValues const& _other) {
+		if (m_generation != _other.m_generation) {
+			writeAll();
+			return;
+		}
+		std::set<std::string> names;
+		for (auto const& [name, version] : m_versions)
+			names.insert(name);
+		for (auto const& [name, version] : _other.m_versions)
+			names.insert(name);
+		for (std::string const& name : names)
+			if (read(name) != _other.read(name))
+				write(name);
+	}
+
+private:
+	ValueNumbers* m_numbers;
+	int m_generation{}; // changes when all values may be changed
+	std::map<std::string, int> m_versions;
+};
+
+// Collects effects of code that isn't analyzed instruction by instruction
+class Effects : public TvmAstVisitor {
+public:
+	bool visit(Glob &_node) override {
+		if (isGlobalWrite(_node))
+			m_writes.emplace_back(&_node);
+		return false;
+	}
+	bool visit(StackOpcode &_node) override { return visitOpcode(_node); }
+	bool visit(HardCode &_node) override { return visitOpcode(_node); }
+	bool visit(TvmReturn &) override { m_leaves = true; return false; }
+	bool visit(ReturnOrBreakOrCont &) override { m_leaves = true; return false; }
+	bool visit(TvmIfElse &_node) override {
+		m_leaves |= _node.withJmp();
+		return true;
+	}
+	bool visit(SubProgram &_node) override {
+		m_leaves |= _node.isJmp();
+		return true;
+	}
+
+	// the code may return from the function or jump out of the current continuation
+	bool leaves() const { return m_leaves; }
+
+	void apply(GlobalValues& _globals) const {
+		if (m_writesAll)
+			_globals.writeAll();
+		for (Glob const* glob : m_writes)
+			_globals.write(*glob);
+	}
+
+private:
+	bool visitOpcode(TvmAstNode const& _node) {
+		m_writesAll |= isCallOrGlobalWrite(_node);
+		m_leaves |= leavesContinuation(_node);
+		return false;
+	}
+
+private:
+	std::vector<Glob const*> m_writes;
+	bool m_writesAll{};
+	bool m_leaves{};
+};
+
+// Opcodes that give equal results for equal arguments and don't throw exceptions
+bool isDeterministic(StackOpcode const& _op) {
+	static std::set<std::string> const constants{"PUSHINT", "TRUE", "FALSE", "NULL", "MYADDR", "NOW"};
+	// GASCONSUMED, RANDSEED and so on take no arguments, but give different results
+	if (_op.take() == 0)
+		return constants.count(_op.opcode()) != 0;
+	// arithmetic opcodes throw on integer overflow, but they throw on both lookups
+	static std::set<std::string> const arithmetic{"ADD", "SUB", "MUL", "INC", "DEC", "ADDCONST", "MULCONST", "NEGATE"};
+	return _op.isPure() || arithmetic.count(_op.opcode()) != 0;
+}
+
+std::vector<Pointer<TvmAstNode>> withoutLoc(std::vector<Pointer<TvmAstNode>> const& _instructions) {
+	std::vector<Pointer<TvmAstNode>> res;
+	for (Pointer<TvmAstNode> const& op : _instructions)
+		if (!to<Loc>(op.get()))
+			res.emplace_back(op);
+	return res;
+}
+
+// Opaque that is made by GetFromDict for `m[k]`, `m.fetch(k)`, `m.exists(k)` and so on
+struct Lookup {
+	std::string opcode; // DICTGET, DICTUGETREF, ...
+	bool inRef{};
+	bool isExists{};
+
+	// lookups with the same base opcode find the same value
+	std::string base() const { return inRef ? opcode.substr(0, opcode.size() - 3) : opcode; }
+};
+
+std::optional<Lookup> asLookup(TvmAstNode const& _node) {
+	auto opaque = to<Opaque>(&_node);
+	if (opaque == nullptr || opaque->take() != 3 || opaque->ret() != 1)
+		return std::nullopt;
+	std::vector<Pointer<TvmAstNode>> const code = withoutLoc(opaque->block()->instructions());
+	auto asym = code.empty() ? nullptr : to<AsymGen>(code.at(0).get());
+	static std::set<std::string> const opcodes{"DICTGET", "DICTIGET", "DICTUGET", "DICTGETREF", "DICTIGETREF", "DICTUGETREF"};
+	if (asym == nullptr || opcodes.count(asym->opcode()) == 0)
+		return std::nullopt;
+	Lookup lookup{asym->opcode(), boost::ends_with(asym->opcode(), "REF"), false};
+	// see GetFromDict::checkExist
+	if (auto check = code.size() == 2 ? to<Opaque>(code.at(1).get()) : nullptr;
+		!lookup.inRef && check != nullptr && check->take() == 1 && check->ret() == 1
+	) {
+		std::vector<Pointer<TvmAstNode>> const checkCode = withoutLoc(check->block()->instructions());
+		auto nullSwap = checkCode.size() == 2 ? to<AsymGen>(checkCode.at(0).get()) : nullptr;
+		lookup.isExists = nullSwap != nullptr && nullSwap->opcode() == "NULLSWAPIFNOT" && isPOP(checkCode.at(1)) == 1;
+	}
+	return lookup;
+}
+
+// How a later lookup is replaced with the result of an earlier one
+enum class Reuse {
+	Copy, // the same lookup
+	FoundValue, // m[k] after m.exists(k) where the key is known to exist
+	FoundExists, // m.exists(k) after m.exists(k) where the key is known to exist
+	Exists // m.exists(k) after m.exists(k)
+};
+
+struct Consumer {
+	Pointer<TvmAstNode> node;
+	int index{}; // index of the instruction of the producer's block that contains the lookup
+	std::optional<Reuse> reuse;
+	std::optional<Reuse> reuseFound; // reuse if the producer keeps the found value
+};
+
+struct Producer {
+	Pointer<CodeBlock> block;
+	int index{};
+	Pointer<TvmAstNode> node;
+	Lookup lookup;
+	std::vector<Consumer> consumers;
+};
+
+struct State {
+	explicit State(ValueNumbers& _numbers) : stack{_numbers}, globals{_numbers} { }
+
+	bool merge(State& _other) {
+		if (!stack.merge(_other.stack))
+			return false;
+		globals.merge(_other.globals);
+		for (auto it = producers.begin(); it != producers.end();)
+			if (_other.producers.count(it->first) == 0 || _other.producers.at(it->first) != it->second)
+				it = producers.erase(it);
+			else
+				++it;
+		for (auto it = found.begin(); it != found.end();)
+			if (_other.found.count(*it) == 0)
+				it = found.erase(it);
+			else
+				++it;
+		return true;
+	}
+
+	ValueStack stack;
+	GlobalValues globals;
+	std::map<std::string, int> producers; // keys of lookups => indexes of the first lookups
+	std::set<std::string> found; // keys of lookups that are known to find a value
+};
+
+enum class Flow {
+	Next, // the execution goes to the next instruction
+	Stop, // the execution doesn't go to the next instruction (THROW, RET of the function, ...)
+	Lost // the code can't be analyzed
+};
+
+// Counts nodes of the code, because the same node can be used in several places
+class NodeCounter : public TvmAstVisitor {
+public:
+	std::map<TvmAstNode const*, int> const& counts() const { return m_counts; }
+protected:
+	bool visitNode(TvmAstNode const& _node) override {
+		return ++m_counts[&_node] == 1;
+	}
+private:
+	std::map<TvmAstNode const*, int> m_counts;
+};
+
+// Finds lookups that are repeated on all paths from the first lookup
+class Analyzer {
+public:
+	explicit Analyzer(Pointer<CodeBlock> const& _body) {
+		NodeCounter counter;
+		_body->accept(counter);
+		m_occurrences = counter.counts();
+		State state{m_numbers};
+		walk(_body, state);
+	}
+
+	std::vector<Producer> const& producers() const { return m_producers; }
+
+	// Returns true if the code is changed
+	bool eliminate(Producer const& _producer, int& _eliminated) const;
+
+private:
+	Flow walk(Pointer<CodeBlock> const& _block, State& _state);
+	Flow walkNode(Pointer<TvmAstNode> const& _node, State& _state, std::optional<std::string> const& _exists);
+	std::optional<std::string> visitLookup(Pointer<TvmAstNode> const& _node, Lookup const& _lookup, State& _state);
+	Flow visitIfElse(TvmIfElse const& _node, State& _state, std::optional<std::string> const& _exists);
+	void visitGlob(Glob const& _glob, State& _state);
+	Flow visitOpcode(StackOpcode const& _op, State& _state);
+	int indexIn(Pointer<CodeBlock> const& _block) const;
+	bool isFunctionLevel() const { return m_frames.size() == 1; }
+
+private:
+	ValueNumbers m_numbers;
+	std::vector<std::pair<Pointer<CodeBlock>, int>> m_frames; // blocks and indexes of the current instructions
+	std::vector<Producer> m_producers;
+	std::map<TvmAstNode const*, int> m_occurrences; // nodes that are used in several places aren't changed
+};
+
+Flow Analyzer::walk(Pointer<CodeBlock> const& _block, State& _state) {
+	m_frames.emplace_back(_block, 0);
+	Flow flow = Flow::Next;
+	// key of the `exists` lookup whose result is on the top of the stack
+	std::optional<std::string> exists;
+	std::vector<Pointer<TvmAstNode>> const& instructions = _block->instructions();
+	for (int i = 0; i < int(instructions.size()) && flow == Flow::Next; ++i) {
+		m_frames.back().second = i;
+		Pointer<TvmAstNode> const& op = instructions.at(i);
+		if (to<Loc>(op.get()))
+			continue;
+		if (std::optional<Lookup> lookup = asLookup(*op)) {
+			exists = visitLookup(op, *lookup, _state);
+			continue;
+		}
+		flow = walkNode(op, _state, exists);
+		exists.reset();
+	}
+	m_frames.pop_back();
+	return flow;
+}
+
+Flow Analyzer::walkNode(Pointer<TvmAstNode> const& _node, State& _state, std::optional<std::string> const& _exists) {
+	TvmAstNode const* node = _node.get();
+	ValueStack& stack = _state.stack;
+	if (auto st = to<Stack>(node)) {
+		stack.apply(*st);
+		return Flow::Next;
+	}
+	if (auto glob = to<Glob>(node)) {
+		visitGlob(*glob, _state);
+		return Flow::Next;
+	}
+	if (auto op = to<StackOpcode>(node))
+		return visitOpcode(*op, _state);
+	if (to<DeclRetFlag>(node) || to<PushCellOrSlice>(node)) {
+		stack.pushFresh(1);
+		return Flow::Next;
+	}
+	if (to<HardCode>(node) || to<Opaque>(node)) {
+		// the code changes only the values it takes, see Simulator
+		auto gen = to<Gen>(node);
+		Effects effects;
+		_node->accept(effects);
+		if (effects.leaves())
+			return Flow::Lost;
+		effects.apply(_state.globals);
+		stack.pop(gen->take());
+		stack.pushFresh(gen->ret());
+		return Flow::Next;
+	}
+	if (auto exc = to<TvmException>(node)) {
+		stack.pop(exc->take());
+		if (!exc->withIf())
+			return Flow::Stop;
+		// THROWIFNOT N and THROWARGIFNOT N
+		if (_exists && exc->withNot() && !exc->withAny())
+			_state.found.insert(*_exists);
+		return Flow::Next;
+	}
+	if (auto ret = to<TvmReturn>(node)) {
+		if (!isFunctionLevel())
+			return Flow::Lost;
+		if (!ret->withIf())
+			return Flow::Stop;
+		stack.pop(1);
+		return Flow::Next;
+	}
+	if (auto ifElse = to<TvmIfElse>(node))
+		return visitIfElse(*ifElse, _state, _exists);
+	if (auto lc = to<LogCircuit>(node)) {
+		std::map<std::string, int> const producers = _state.producers;
+		stack.pop(1);
+		State body = _state;
+		if (walk(lc->body(), body) != Flow::Next || !_state.merge(body))
+			return Flow::Lost;
+		_state.producers = producers;
+		return Flow::Next;
+	}
+	if (auto sub = to<SubProgram>(node)) {
+		if (sub->isJmp())
+			return Flow::Lost;
+		// lookups of the subprogram aren't reused after it, because the value would be dropped in its block
+		std::map<std::string, int> const producers = _state.producers;
+		Flow const flow = walk(sub->block(), _state);
+		_state.producers = producers;
+		return flow;
+	}
+	if (to<TvmRepeat>(node) || to<TvmUntil>(node) || to<While>(node)) {
+		if (to<TvmRepeat>(node))
+			stack.pop(1);
+		// loop bodies aren't analyzed, so anything may be changed
+		stack.invalidate();
+		_state.globals.writeAll();
+		return Flow::Next;
+	}
+	// ReturnOrBreakOrCont, TryCatch, AsymGen
+	return Flow::Lost;
+}
+
+std::optional<std::string> Analyzer::visitLookup(Pointer<TvmAstNode> const& _node, Lookup const& _lookup, State& _state) {
+	ValueStack& stack = _state.stack;
+	// stack: key dict keyLength
+	std::string const key = _lookup.base() + " " + std::to_string(stack.get(2)) + " " +
+		std::to_string(stack.get(1)) + " " + std::to_string(stack.get(0));
+	if (auto it = _state.producers.find(key); it == _state.producers.end()) {
+		_state.producers[key] = m_producers.size();
+		m_producers.emplace_back(Producer{m_frames.back().first, m_frames.back().second, _node, _lookup, {}});
+	} else {
+		Producer& producer = m_producers.at(it->second);
+		int const index = indexIn(producer.block);
+		bool const found = _state.found.count(key) != 0;
+		std::optional<Reuse> reuse;
+		if (*producer.node == *_node)
+			reuse = Reuse::Copy;
+		std::optional<Reuse> reuseFound;
+		if (producer.lookup.isExists) {
+			if (_lookup.isExists)
+				reuseFound = found ? Reuse::FoundExists : Reuse::Exists;
+			else if (found)
+				reuseFound = Reuse::FoundValue;
+		}
+		if (index >= 0 && (reuse || reuseFound))
+			producer.consumers.emplace_back(Consumer{_node, index, reuse, reuseFound});
+	}
+	std::ostringstream result;
+	if (_lookup.isExists)
+		result << "exists";
+	else {
+		Printer printer{result};
+		_node->accept(printer);
+	}
+	stack.pop(3);
+	stack.push(m_numbers.of("lookup " + key + " " + result.str()));
+	if (_lookup.isExists)
+		return key;
+	return std::nullopt;
+}
+
+Flow Analyzer::visitIfElse(TvmIfElse const& _node, State& _state, std::optional<std::string> const& _exists) {
+	if (_node.withJmp() && _node.falseBody() != nullptr)
+		return Flow::Lost;
+	// lookups of branches aren't reused after the branches, because the value would be dropped in the branch
+	std::map<std::string, int> const producers = _state.producers;
+	_state.stack.pop(1);
+	State trueState = _state;
+	State falseState = _state;
+	if (_exists)
+		(_node.withNot() ? falseState : trueState).found.insert(*_exists);
+	Flow const trueFlow = walk(_node.trueBody(), trueState);
+	Flow const falseFlow = _node.falseBody() != nullptr ? walk(_node.falseBody(), falseState) : Flow::Next;
+	if (trueFlow == Flow::Lost || falseFlow == Flow::Lost)
+		return Flow::Lost;
+	if (_node.withJmp() || trueFlow == Flow::Stop) {
+		// IFJMP: the true body doesn't return to the next instruction
+		if (falseFlow == Flow::Stop)
+			return Flow::Stop;
+		_state = falseState;
+	} else if (falseFlow == Flow::Stop)
+		_state = trueState;
+	else {
+		_state = trueState;
+		if (!_state.merge(falseState))
+			return Flow::Lost;
+	}
+	_state.producers = producers;
+	return Flow::Next;
+}
+
+void Analyzer::visitGlob(Glob const& _glob, State& _state) {
+	if (isGlobalWrite(_glob)) {
+		_state.stack.pop(_glob.take());
+		_state.globals.write(_glob);
+	} else
+		_state.stack.push(_state.globals.read(globalName(_glob)));
+}
+
+Flow Analyzer::visitOpcode(StackOpcode const& _op, State& _state) {
+	if (leavesContinuation(_op))
+		return Flow::Lost;
+	if (isCallOrGlobalWrite(_op))
+		_state.globals.writeAll();
+	ValueStack& stack = _state.stack;
+	std::string key = "op " + _op.fullOpcode();
+	for (int i = 0; i < _op.take(); ++i)
+		key += " " + std::to_string(stack.get(i));
+	stack.pop(_op.take());
+	if (_op.ret() == 1 && isDeterministic(_op))
+		stack.push(m_numbers.of(key));
+	else
+		stack.pushFresh(_op.ret());
+	return Flow::Next;
+}
+
+int Analyzer::indexIn(Pointer<CodeBlock> const& _block) const {
+	for (auto it = m_frames.rbegin(); it != m_frames.rend(); ++it)
+		if (it->first == _block)
+			return it->second;
+	return -1;
+}
+
+// Code that takes the found value from the slot instead of the lookup
+std::vector<Pointer<TvmAstNode>> reuseCode(Reuse _reuse, TvmAstNode const& _lookup, Lookup const& _info, int _slot) {
+	// the slot is under the arguments of the lookup
+	std::vector<Pointer<TvmAstNode>> code{makeDROP(3)};
+	switch (_reuse) {
+	case Reuse::Copy:
+		code.emplace_back(makePUSH(_slot - 3));
+		break;
+	case Reuse::FoundValue: {
+		// stack: value -1, as after DICTGET that found the value
+		auto opaque = to<Opaque>(&_lookup);
+		std::vector<Pointer<TvmAstNode>> body;
+		if (_info.inRef)
+			body.emplace_back(gen("PLDREFIDX 0"));
+		body.emplace_back(gen("TRUE"));
+		std::vector<Pointer<TvmAstNode>> const& instructions = opaque->block()->instructions();
+		auto it = std::find_if(instructions.begin(), instructions.end(), [](Pointer<TvmAstNode> const& op) {
+			return to<AsymGen>(op.get()) != nullptr;
+		});
+		body.insert(body.end(), it + 1, instructions.end());
+		code.emplace_back(makePUSH(_slot - 3));
+		code.emplace_back(createNode<Opaque>(createNode<CodeBlock>(CodeBlock::Type::None, body), 1, 1, opaque->isPure()));
+		break;
+	}
+	case Reuse::FoundExists:
+		code.emplace_back(gen("TRUE"));
+		break;
+	case Reuse::Exists:
+		code.emplace_back(makePUSH(_slot - 3));
+		code.emplace_back(gen("ISNULL"));
+		code.emplace_back(gen("NOT"));
+		break;
+	}
+	return code;
+}
+
+bool Analyzer::eliminate(Producer const& _producer, int& _eliminated) const {
+	auto occurrences = [&](Pointer<TvmAstNode> const& _node) { return m_occurrences.at(_node.get()); };
+	if (occurrences(_producer.node) > 1 || m_occurrences.at(_producer.block.get()) > 1)
+		return false;
+	// `m.exists(k)` keeps the found value if it's taken later
+	bool const keepFound = std::any_of(_producer.consumers.begin(), _producer.consumers.end(), [](Consumer const& c) {
+		return c.reuseFound == Reuse::FoundValue;
+	});
+	std::map<TvmAstNode const*, std::pair<Reuse, Lookup>> reuses;
+	int last = -1;
+	for (Consumer const& c : _producer.consumers) {
+		std::optional<Reuse> const reuse = keepFound ? c.reuseFound : c.reuse;
+		if (!reuse || occurrences(c.node) > 1)
+			continue;
+		reuses.emplace(c.node.get(), std::make_pair(*reuse, *asLookup(*c.node)));
+		last = std::max(last, c.index);
+	}
+	if (reuses.empty())
+		return false;
+
+	std::vector<Pointer<TvmAstNode>> const& instructions = _producer.block->instructions();
+	std::vector<Pointer<TvmAstNode>> out{instructions.begin(), instructions.begin() + _producer.index};
+	if (keepFound) {
+		// stack: value-or-null flag
+		auto opaque = to<Opaque>(_producer.node.get());
+		std::vector<Pointer<TvmAstNode>> body{
+			createNode<AsymGen>(_producer.lookup.opcode),
+			createNode<AsymGen>("NULLSWAPIFNOT")
+		};
+		out.emplace_back(createNode<Opaque>(createNode<CodeBlock>(CodeBlock::Type::None, body), 3, 2, opaque->isPure()));
+	} else {
+		out.emplace_back(_producer.node);
+		out.emplace_back(makePUSH(0));
+	}
+	int depth = 1;
+	SlotInserter inserter{[&](TvmAstNode const& _node, int _slot) -> std::optional<std::vector<Pointer<TvmAstNode>>> {
+		auto it = reuses.find(&_node);
+		if (it == reuses.end())
+			return std::nullopt;
+		return reuseCode(it->second.first, _node, it->second.second, _slot);
+	}, false};
+	for (int i = _producer.index + 1; i <= last; ++i)
+		if (!inserter.rewrite(instructions.at(i), depth, out))
+			return false;
+	if (depth > 15)
+		return false;
+	out.emplace_back(depth == 0 ? makeDROP() : makeBLKDROP2(1, depth));
+	out.insert(out.end(), instructions.begin() + last + 1, instructions.end());
+	_producer.block->upd(out);
+	_eliminated += reuses.size();
+	return true;
+}
+
+} // end anonymous namespace
+
+bool DictLookupEliminator::visit(Function &_node) {
+	// the code is analyzed again after each change
+	for (int iter = 0; iter < 32; ++iter) {
+		Analyzer analyzer{_node.block()};
+		bool changed = false;
+		for (Producer const& producer : analyzer.producers()) {
+			if (analyzer.eliminate(producer, m_eliminatedLookups)) {
+				changed = true;
+				break;
+			}
+		}
+		if (!changed)
+			break;
+	}
+	return false;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Elimination of repeated dictionary lookups
+ */
+
+#pragma once
+
+#include <libsolidity/codegen/TvmAstVisitor.hpp>
+
+namespace solidity::frontend {
+
+// Finds dictionary lookups (DICTGET, DICTUGET, ...) that get the same key from the same dictionary as
+// an earlier lookup of the function, and reuses the result of the earlier lookup, e.g.
+//   PUSH S1               PUSH S1
+//   GETGLOB 10            GETGLOB 10
+//   PUSHINT 32            PUSHINT 32
+//   <DICTUGET ...>        <DICTUGET ...>
+//   ...              =>   DUP
+//   PUSH S2               ...
+//   GETGLOB 10            PUSH S3
+//   PUSHINT 32            ...
+//   <DICTUGET ...>        NIP
+//   ...
+// Values of the stack and global variables are numbered symbolically, so lookups are equal if their
+// dictionaries and keys are equal, regardless of how they are pushed. The result of `m.exists(k)` is kept as
+// the found value, so `m[k]` is taken from it where the key is known to exist (`if (m.exists(k))` and
+// `require(m.exists(k))`).
+class DictLookupEliminator : public TvmAstVisitor {
+public:
+	bool visit(Function &_node) override;
+	bool didSome() const { return m_eliminatedLookups > 0; }
+	int eliminatedLookups() const { return m_eliminatedLookups; }
+private:
+	int m_eliminatedLookups{};
+};
+
+} // end solidity::frontend
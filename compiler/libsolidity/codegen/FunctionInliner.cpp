@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Inliner of calls to private functions
+ */
+
+#include <libsolidity/codegen/FunctionInliner.hpp>
+#include <libsolidity/codegen/SizeOptimizer.hpp>
+#include <libsolidity/codegen/TVM.hpp>
+#include <libsolidity/codegen/TVMCommons.hpp>
+#include <libsolidity/codegen/TvmAst.hpp>
+
+using namespace solidity::frontend;
+
+namespace {
+
+// descriptors of a cell and its index in the bag of cells
+constexpr int CellOverheadBits = 16 + 16;
+// CALLREF and the reference to the cell of the callee
+constexpr int CallRefBits = 16 + 16;
+
+// Returns the name of `f` if the node is `CALLREF { .inline f }`
+std::optional<std::string> callRefFragment(TvmAstNode const& node) {
+	auto sub = to<SubProgram>(&node);
+	if (sub == nullptr || sub->isJmp() || sub->block()->type() != CodeBlock::Type::PUSHREFCONT)
+		return std::nullopt;
+	StackOpcode const* call = nullptr;
+	for (Pointer<TvmAstNode> const& op : sub->block()->instructions()) {
+		if (to<Loc>(op.get()))
+			continue;
+		auto opcode = to<StackOpcode>(op.get());
+		if (call != nullptr || opcode == nullptr || opcode->opcode() != ".inline")
+			return std::nullopt;
+		call = opcode;
+	}
+	if (call == nullptr)
+		return std::nullopt;
+	return call->arg();
+}
+
+class CallSiteCounter : public TvmAstVisitor {
+public:
+	bool visit(SubProgram &_node) override {
+		if (std::optional<std::string> name = callRefFragment(_node)) {
+			++m_callSites[*name];
+			return false;
+		}
+		return true;
+	}
+
+	std::map<std::string, int> const& callSites() const { return m_callSites; }
+private:
+	std::map<std::string, int> m_callSites;
+};
+
+// Replaces `CALLREF { .inline f }` with `.inline f` for the given functions
+class CallRefInliner : public TvmAstVisitor {
+public:
+	CallRefInliner(std::set<std::string> const& _functions, std::map<std::string, int>& _inlinedCalls) :
+		m_functions{_functions}, m_inlinedCalls{_inlinedCalls} { }
+
+	void endVisit(CodeBlock &_node) override {
+		std::vector<Pointer<TvmAstNode>> instructions;
+		bool changed = false;
+		for (Pointer<TvmAstNode> const& op : _node.instructions()) {
+			std::optional<std::string> name = callRefFragment(*op);
+			if (name && m_functions.count(*name)) {
+				std::vector<Pointer<TvmAstNode>> const& body = to<SubProgram>(op.get())->block()->instructions();
+				instructions.insert(instructions.end(), body.begin(), body.end());
+				++m_inlinedCalls[*name];
+				changed = true;
+			} else {
+				instructions.emplace_back(op);
+			}
+		}
+		if (changed)
+			_node.upd(instructions);
+	}
+private:
+	std::set<std::string> const& m_functions;
+	std::map<std::string, int>& m_inlinedCalls;
+};
+
+} // end anonymous namespace
+
+int FunctionInliner::defaultThreshold() {
+	switch (GlobalParams::g_optimizeFor) {
+	case OptimizationObjective::Size:
+		return CallRefBits; // not larger than the call itself
+	case OptimizationObjective::Balanced:
+		return 64;
+	case OptimizationObjective::Gas:
+		return 256;
+	}
+	solUnimplemented("");
+}
+
+bool FunctionInliner::isInlinable(std::string const& name) {
+	if (auto it = m_isInlinable.find(name); it != m_isInlinable.end())
+		return it->second;
+	m_isInlinable[name] = false; // fragments are not recursive, but let's be careful
+	auto it = m_functions.find(name);
+	if (it == m_functions.end() || it->second->type() != Function::FunctionType::Fragment)
+		return false;
+	ContinuationExitChecker checker{[this](std::string const& f) { return isInlinable(f); }};
+	for (Pointer<TvmAstNode> const& op : it->second->block()->instructions())
+		op->accept(checker);
+	return m_isInlinable[name] = !checker.canExit();
+}
+
+void FunctionInliner::inlineCalls(Pointer<Contract>& c) {
+	if (m_threshold == 0)
+		return;
+	for (Pointer<Function> const& f : c->functions())
+		m_functions.emplace(f->name(), f);
+
+	CallSiteCounter counter;
+	c->accept(counter);
+
+	std::set<std::string> inlined;
+	for (auto const& [name, qty] : counter.callSites()) {
+		if (!isInlinable(name))
+			continue;
+		int64_t const bits = codeSizeInBits(*m_functions.at(name)->block());
+		// if all call sites are inlined, the cell of the callee is not needed anymore
+		bool const sizeDoesNotGrow = qty * bits <= bits + CellOverheadBits + qty * CallRefBits;
+		if (qty == 1 || bits <= m_threshold || sizeDoesNotGrow)
+			inlined.insert(name);
+	}
+	if (inlined.empty())
+		return;
+
+	CallRefInliner inliner{inlined, m_inlinedCalls};
+	c->accept(inliner);
+}
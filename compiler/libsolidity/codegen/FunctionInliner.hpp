@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Inliner of calls to private functions
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <libsolidity/codegen/TvmAstVisitor.hpp>
+
+namespace solidity::frontend {
+
+// Replaces `CALLREF { .inline f }` with `.inline f`, so the code of `f` is placed into the code of the caller
+// and the call doesn't load a separate cell. A function is inlined if it has one call site or if its code
+// isn't larger than the threshold (in bits). Functions that can leave the current continuation
+// (RET, JMP, RETALT, ...) are never inlined because the inlined code would return from the caller.
+// Threshold 0 turns inlining off.
+class FunctionInliner {
+public:
+	explicit FunctionInliner(int _threshold) : m_threshold{_threshold} { }
+	void inlineCalls(Pointer<Contract>& c);
+	// the number of inlined call sites of each function
+	std::map<std::string, int> const& inlinedCalls() const { return m_inlinedCalls; }
+	// the default threshold for the current optimization objective
+	static int defaultThreshold();
+private:
+	bool isInlinable(std::string const& name);
+private:
+	int const m_threshold;
+	std::map<std::string, Pointer<Function>> m_functions;
+	std::map<std::string, bool> m_isInlinable;
+	std::map<std::string, int> m_inlinedCalls;
+};
+
+} // end solidity::frontend
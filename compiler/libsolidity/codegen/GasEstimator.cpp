@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Static gas estimator of generated TVM code
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <libsolidity/codegen/GasEstimator.hpp>
+#include <libsolidity/codegen/TvmAst.hpp>
+
+using namespace solidity::frontend;
+
+namespace {
+
+// Basic gas price of an instruction is 10 + its length in bits
+constexpr int64_t ShortInstruction = 18; // 8-bit instruction
+constexpr int64_t Instruction = 26;      // 16-bit instruction
+constexpr int64_t LongInstruction = 34;  // 24-bit instruction
+constexpr int64_t CellLoad = 100;
+constexpr int64_t CellCreate = 500;
+constexpr int64_t ImplicitRet = 5;
+
+int64_t add(int64_t a, int64_t b) {
+	if (a == GasCost::Unbounded || b == GasCost::Unbounded)
+		return GasCost::Unbounded;
+	return a + b;
+}
+
+int64_t pushIntCost(solidity::bigint const& value) {
+	if (-5 <= value && value <= 10)
+		return ShortInstruction;
+	if (-128 <= value && value < 128)
+		return Instruction;
+	if (-32768 <= value && value < 32768)
+		return LongInstruction;
+	solidity::bigint absValue = value < 0 ? solidity::bigint{-value} : value;
+	int64_t bytes = boost::multiprecision::msb(absValue) / 8 + 1;
+	return Instruction + 8 * bytes;
+}
+
+// Rough cost of an instruction that is known only by its name
+int64_t instructionCost(std::string const& opcode, std::string const& arg) {
+	if (opcode.empty() || opcode.at(0) == '.')
+		return 0; // assembler directive
+	if (opcode == "ENDC" || opcode == "ENDXC")
+		return ShortInstruction + CellCreate;
+	if (opcode == "CTOS" || opcode == "XCTOS" || opcode == "LDREFRTOS")
+		return ShortInstruction + CellLoad;
+	if (boost::starts_with(opcode, "DICT") || boost::starts_with(opcode, "PFXDICT")) {
+		// at least the root cell of the dictionary is loaded, and changed dictionaries are rebuilt
+		bool const changes =
+			opcode.find("SET") != std::string::npos ||
+			opcode.find("ADD") != std::string::npos ||
+			opcode.find("REPLACE") != std::string::npos ||
+			opcode.find("DEL") != std::string::npos;
+		return LongInstruction + CellLoad + (changes ? CellCreate : 0);
+	}
+	return arg.empty() ? ShortInstruction : Instruction;
+}
+
+int64_t instructionCost(std::string const& line) {
+	std::string const cmd = boost::trim_copy(line);
+	size_t const space = cmd.find(' ');
+	if (space == std::string::npos)
+		return instructionCost(cmd, "");
+	return instructionCost(cmd.substr(0, space), cmd.substr(space + 1));
+}
+
+} // end anonymous namespace
+
+GasCost GasCost::then(GasCost const& other) const {
+	if (!reachable || !other.reachable)
+		return unreachable();
+	return GasCost{min + other.min, typical + other.typical, add(max, other.max), true};
+}
+
+GasCost GasCost::orElse(GasCost const& other) const {
+	if (!reachable)
+		return other;
+	if (!other.reachable)
+		return *this;
+	return GasCost{std::min(min, other.min), (typical + other.typical) / 2, std::max(max, other.max), true};
+}
+
+GasCost GasCost::repeated() const {
+	if (!reachable)
+		return fixed(0);
+	return GasCost{0, typical, max == 0 ? 0 : Unbounded, true};
+}
+
+GasCost GasCost::repeatedAtLeastOnce() const {
+	if (!reachable)
+		return unreachable();
+	return GasCost{min, typical, max == 0 ? 0 : Unbounded, true};
+}
+
+GasEstimator::GasEstimator(Contract const& _contract) :
+	m_privateFunctions{_contract.privateFunctions()}
+{
+	for (Pointer<Function> const& f : _contract.functions())
+		m_functions[f->name()] = f.get();
+}
+
+GasCost GasEstimator::functionCost(std::string const& name) {
+	if (auto it = m_functionCosts.find(name); it != m_functionCosts.end())
+		return it->second;
+	auto it = m_functions.find(name);
+	if (it == m_functions.end())
+		return GasCost::fixed(0); // the function isn't a part of the contract code, e.g. it's linked later
+	if (!m_inProgress.insert(name).second)
+		return GasCost{0, 0, GasCost::Unbounded, true}; // recursion
+
+	Estimate e = estimateContinuation(*it->second->block());
+	GasCost cost = e.next.orElse(e.functionExit);
+	m_inProgress.erase(name);
+	m_functionCosts.emplace(name, cost);
+	return cost;
+}
+
+bool GasEstimator::visit(AsymGen &_node) {
+	setCost(instructionCost(_node.opcode()));
+	return false;
+}
+
+bool GasEstimator::visit(DeclRetFlag &/*_node*/) {
+	setCost(ShortInstruction); // FALSE
+	return false;
+}
+
+bool GasEstimator::visit(Opaque &_node) {
+	m_estimate = estimateBlock(*_node.block());
+	return false;
+}
+
+bool GasEstimator::visit(HardCode &_node) {
+	int64_t gas = 0;
+	for (std::string const& line : _node.code())
+		gas += instructionCost(line);
+	setCost(gas);
+	return false;
+}
+
+bool GasEstimator::visit(Loc &/*_node*/) {
+	setCost(0);
+	return false;
+}
+
+bool GasEstimator::visit(TvmReturn &_node) {
+	Estimate res;
+	res.next = _node.withIf() ? GasCost::fixed(ShortInstruction) : GasCost::unreachable();
+	if (_node.withAlt())
+		res.functionExit = GasCost::fixed(ShortInstruction);
+	else
+		res.localExit = GasCost::fixed(ShortInstruction);
+	m_estimate = res;
+	return false;
+}
+
+bool GasEstimator::visit(ReturnOrBreakOrCont &_node) {
+	m_estimate = estimateBlock(*_node.body());
+	return false;
+}
+
+bool GasEstimator::visit(TvmException &_node) {
+	Estimate res;
+	// the paths that throw an exception aren't estimated
+	res.next = _node.withIf() ? GasCost::fixed(Instruction) : GasCost::unreachable();
+	m_estimate = res;
+	return false;
+}
+
+bool GasEstimator::visit(StackOpcode &_node) {
+	if (_node.opcode() == ".inline") {
+		m_estimate = Estimate{functionCost(_node.arg())};
+	} else if (_node.opcode() == "CALL" && _node.intArg()) {
+		// CALLDICT looks up the function in the dictionary of the code
+		auto it = m_privateFunctions.find(static_cast<uint32_t>(*_node.intArg()));
+		GasCost callee = it == m_privateFunctions.end() ? GasCost::fixed(0) : functionCost(it->second);
+		m_estimate = Estimate{GasCost::fixed(Instruction + CellLoad).then(callee)};
+	} else if (std::optional<bigint> value = _node.pushedInt(); value && _node.symbol() == Opcodes::PUSHINT()) {
+		setCost(pushIntCost(*value));
+	} else {
+		setCost(instructionCost(_node.opcode(), _node.arg()));
+	}
+	return false;
+}
+
+bool GasEstimator::visit(PushCellOrSlice &_node) {
+	switch (_node.type()) {
+	case PushCellOrSlice::Type::PUSHREF_COMPUTE:
+	case PushCellOrSlice::Type::PUSHREF:
+		setCost(ShortInstruction);
+		break;
+	case PushCellOrSlice::Type::PUSHREFSLICE_COMPUTE:
+	case PushCellOrSlice::Type::PUSHREFSLICE:
+		setCost(ShortInstruction + CellLoad);
+		break;
+	case PushCellOrSlice::Type::PUSHSLICE:
+		setCost(Instruction);
+		break;
+	case PushCellOrSlice::Type::CELL:
+		setCost(0);
+		break;
+	}
+	return false;
+}
+
+bool GasEstimator::visit(Glob &_node) {
+	switch (_node.opcode()) {
+	case Glob::Opcode::GetOrGetVar:
+	case Glob::Opcode::SetOrSetVar:
+		// GETGLOB k | PUSHINT k; GETGLOBVAR
+		setCost(1 <= _node.index() && _node.index() <= 31 ? Instruction : Instruction + ShortInstruction);
+		break;
+	case Glob::Opcode::PUSHROOT:
+	case Glob::Opcode::POPROOT:
+	case Glob::Opcode::PUSH_C3:
+	case Glob::Opcode::POP_C3:
+	case Glob::Opcode::PUSH_C7:
+	case Glob::Opcode::POP_C7:
+		setCost(Instruction);
+		break;
+	}
+	return false;
+}
+
+bool GasEstimator::visit(Stack &_node) {
+	setCost(OpcodeUtils::gasCost(_node));
+	return false;
+}
+
+bool GasEstimator::visit(CodeBlock &_node) {
+	m_estimate = estimateBlock(_node);
+	return false;
+}
+
+bool GasEstimator::visit(SubProgram &_node) {
+	// CALLREF | PUSHCONT; CALLX
+	int64_t const gas = _node.block()->type() == CodeBlock::Type::PUSHREFCONT ?
+		Instruction + CellLoad :
+		Instruction + ShortInstruction;
+	Estimate body = estimateContinuation(*_node.block());
+	GasCost const cost = GasCost::fixed(gas).then(body.next);
+	Estimate res;
+	res.functionExit = GasCost::fixed(gas).then(body.functionExit);
+	if (_node.isJmp()) {
+		res.next = GasCost::unreachable();
+		res.localExit = cost;
+	} else {
+		res.next = cost;
+	}
+	m_estimate = res;
+	return false;
+}
+
+bool GasEstimator::visit(LogCircuit &_node) {
+	// PUSHCONT; IF | PUSHCONT; IFNOT
+	GasCost const base = GasCost::fixed(Instruction + ShortInstruction);
+	Estimate body = estimateContinuation(*_node.body());
+	Estimate res;
+	res.next = base.then(GasCost::fixed(0).orElse(body.next));
+	res.functionExit = base.then(body.functionExit);
+	m_estimate = res;
+	return false;
+}
+
+bool GasEstimator::visit(TvmIfElse &_node) {
+	auto branch = [&](Pointer<CodeBlock> const& body) {
+		if (!body)
+			return Estimate{GasCost::fixed(0)};
+		Estimate e = estimateContinuation(*body);
+		if (body->type() == CodeBlock::Type::PUSHREFCONT) {
+			GasCost const load = GasCost::fixed(CellLoad);
+			e.next = load.then(e.next);
+			e.functionExit = load.then(e.functionExit);
+		}
+		return e;
+	};
+	Estimate const trueBranch = branch(_node.trueBody());
+	Estimate const falseBranch = branch(_node.falseBody());
+
+	// PUSHCONT or a reference for each body and IF, IFELSE, IFJMP, ...
+	GasCost const base = GasCost::fixed(ShortInstruction + Instruction * (_node.falseBody() ? 2 : 1));
+	Estimate res;
+	res.functionExit = base.then(trueBranch.functionExit.orElse(falseBranch.functionExit));
+	if (_node.withJmp()) {
+		res.localExit = base.then(trueBranch.next);
+		res.next = base.then(falseBranch.next);
+	} else {
+		res.next = base.then(trueBranch.next.orElse(falseBranch.next));
+	}
+	m_estimate = res;
+	return false;
+}
+
+// Exits from the function inside a loop body are treated as exits from the loop,
+// because `break` is compiled in the same way.
+
+bool GasEstimator::visit(TvmRepeat &_node) {
+	GasCost const base = GasCost::fixed(Instruction + ShortInstruction); // PUSHCONT; REPEAT
+	Estimate body = estimateContinuation(*_node.body());
+	GasCost const loop = base.then(body.next.repeated());
+	m_estimate = Estimate{loop.orElse(loop.then(body.functionExit))};
+	return false;
+}
+
+bool GasEstimator::visit(TvmUntil &_node) {
+	GasCost const base = GasCost::fixed(Instruction + ShortInstruction); // PUSHCONT; UNTIL
+	Estimate body = estimateContinuation(*_node.body());
+	GasCost const loop = base.then(body.next.repeatedAtLeastOnce());
+	m_estimate = Estimate{loop.orElse(base.then(body.next.repeated()).then(body.functionExit))};
+	return false;
+}
+
+bool GasEstimator::visit(While &_node) {
+	Estimate body = estimateContinuation(*_node.body());
+	if (_node.isInfinite()) {
+		GasCost const base = GasCost::fixed(Instruction + ShortInstruction); // PUSHCONT; AGAIN
+		m_estimate = Estimate{base.then(body.next.repeated()).then(body.functionExit)};
+		return false;
+	}
+	GasCost const base = GasCost::fixed(2 * Instruction + ShortInstruction); // PUSHCONT; PUSHCONT; WHILE
+	Estimate condition = estimateContinuation(*_node.condition());
+	GasCost const iterations = base.then(condition.next.then(body.next).repeated());
+	m_estimate = Estimate{iterations.then(condition.next).orElse(iterations.then(condition.next).then(body.functionExit))};
+	return false;
+}
+
+bool GasEstimator::visit(TryCatch &_node) {
+	// PUSHCONT; PUSHCONT; TRY. The catch body is run only after an exception.
+	GasCost const base = GasCost::fixed(3 * Instruction + (_node.saveAltC2() ? Instruction : 0));
+	Estimate body = estimateContinuation(*_node.tryBody());
+	Estimate res;
+	res.next = base.then(body.next);
+	res.functionExit = base.then(body.functionExit);
+	m_estimate = res;
+	return false;
+}
+
+bool GasEstimator::visitNode(TvmAstNode const&) {
+	solUnimplemented("GasEstimator::visitNode");
+}
+
+GasEstimator::Estimate GasEstimator::estimate(TvmAstNode& node) {
+	node.accept(*this);
+	return m_estimate;
+}
+
+GasEstimator::Estimate GasEstimator::estimateBlock(CodeBlock& block) {
+	Estimate res;
+	GasCost cur = GasCost::fixed(0);
+	for (Pointer<TvmAstNode> const& inst : block.instructions()) {
+		Estimate const e = estimate(*inst);
+		res.localExit = res.localExit.orElse(cur.then(e.localExit));
+		res.functionExit = res.functionExit.orElse(cur.then(e.functionExit));
+		cur = cur.then(e.next);
+		if (!cur.reachable)
+			break;
+	}
+	res.next = cur;
+	return res;
+}
+
+GasEstimator::Estimate GasEstimator::estimateContinuation(CodeBlock& block) {
+	Estimate const e = estimateBlock(block);
+	Estimate res;
+	res.next = e.next.then(GasCost::fixed(ImplicitRet)).orElse(e.localExit);
+	res.functionExit = e.functionExit;
+	return res;
+}
+
+void GasEstimator::setCost(int64_t gas) {
+	m_estimate = Estimate{GasCost::fixed(gas)};
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Static gas estimator of generated TVM code
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+
+#include <libsolidity/codegen/TvmAstVisitor.hpp>
+
+namespace solidity::frontend {
+
+// Gas consumed by a piece of code on the paths that don't throw an exception.
+// `typical` takes every branch with equal probability and runs every loop once.
+struct GasCost {
+	static constexpr int64_t Unbounded = std::numeric_limits<int64_t>::max();
+
+	static GasCost fixed(int64_t gas) { return GasCost{gas, gas, gas, true}; }
+	static GasCost unreachable() { return GasCost{0, 0, 0, false}; }
+
+	// this code and then `other`
+	GasCost then(GasCost const& other) const;
+	// this code or `other`
+	GasCost orElse(GasCost const& other) const;
+	// this code 0 or more times
+	GasCost repeated() const;
+	// this code 1 or more times
+	GasCost repeatedAtLeastOnce() const;
+
+	int64_t min{};
+	int64_t typical{};
+	int64_t max{}; // Unbounded if it depends on data, e.g. loops and recursion
+	bool reachable{}; // false if the code always throws an exception
+};
+
+class GasEstimator : public TvmAstVisitor {
+public:
+	explicit GasEstimator(Contract const& _contract);
+	bool hasFunction(std::string const& name) const { return m_functions.count(name) != 0; }
+	GasCost functionCost(std::string const& name);
+
+	bool visit(AsymGen &_node) override;
+	bool visit(DeclRetFlag &_node) override;
+	bool visit(Opaque &_node) override;
+	bool visit(HardCode &_node) override;
+	bool visit(Loc &_node) override;
+	bool visit(TvmReturn &_node) override;
+	bool visit(ReturnOrBreakOrCont &_node) override;
+	bool visit(TvmException &_node) override;
+	bool visit(StackOpcode &_node) override;
+	bool visit(PushCellOrSlice &_node) override;
+	bool visit(Glob &_node) override;
+	bool visit(Stack &_node) override;
+	bool visit(CodeBlock &_node) override;
+	bool visit(SubProgram &_node) override;
+	bool visit(LogCircuit &_node) override;
+	bool visit(TvmIfElse &_node) override;
+	bool visit(TvmRepeat &_node) override;
+	bool visit(TvmUntil &_node) override;
+	bool visit(While &_node) override;
+	bool visit(TryCatch &_node) override;
+protected:
+	bool visitNode(TvmAstNode const&) override;
+private:
+	// Costs of the paths that go through a node:
+	//  next - paths that continue with the next instruction,
+	//  localExit - paths that leave the current continuation (RET, IFRET, IFJMP, ...),
+	//  functionExit - paths that leave the function or the loop (RETALT, ...).
+	struct Estimate {
+		GasCost next;
+		GasCost localExit = GasCost::unreachable();
+		GasCost functionExit = GasCost::unreachable();
+	};
+	Estimate estimate(TvmAstNode& node);
+	Estimate estimateBlock(CodeBlock& block);
+	Estimate estimateContinuation(CodeBlock& block);
+	void setCost(int64_t gas);
+private:
+	std::map<std::string, Function*> m_functions;
+	std::map<uint32_t, std::string> m_privateFunctions;
+	std::map<std::string, GasCost> m_functionCosts;
+	std::set<std::string> m_inProgress;
+	Estimate m_estimate;
+};
+
+} // end solidity::frontend
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Loop-invariant code motion
+ */
+
+#include <algorithm>
+#include <set>
+
+#include <libsolidity/codegen/LoopInvariantHoister.hpp>
+#include <libsolidity/codegen/SlotInserter.hpp>
+#include <libsolidity/codegen/TVM.hpp>
+#include <libsolidity/codegen/TVMCommons.hpp>
+
+using namespace solidity::frontend;
+
+namespace {
+
+// Collects reads and writes of global variables and control registers in a loop
+class LoopEffects : public TvmAstVisitor {
+public:
+	bool visit(Glob &_node) override {
+		switch (_node.opcode()) {
+		case Glob::Opcode::SetOrSetVar:
+			m_setGlobs.insert(_node.index());
+			break;
+		case Glob::Opcode::POP_C7:
+			m_popC7 = true;
+			break;
+		case Glob::Opcode::POPROOT:
+			m_popRoot = true;
+			break;
+		case Glob::Opcode::POP_C3:
+			m_popC3 = true;
+			break;
+		default:
+			if (std::find_if(m_reads.begin(), m_reads.end(), [&](Glob const* g) { return *g == _node; }) == m_reads.end())
+				m_reads.push_back(&_node);
+			break;
+		}
+		return false;
+	}
+
+	bool visit(StackOpcode &_node) override {
+		// a called function can change anything
+		m_hasCall |= isCallOrGlobalWrite(_node);
+		return false;
+	}
+
+	bool visit(HardCode &_node) override {
+		m_hasCall |= isCallOrGlobalWrite(_node);
+		return false;
+	}
+
+	// Returns reads that give the same value on each iteration of the loop
+	std::vector<Glob const*> invariantReads() const {
+		std::vector<Glob const*> res;
+		if (m_hasCall)
+			return res;
+		for (Glob const* g : m_reads) {
+			bool invariant = false;
+			switch (g->opcode()) {
+			case Glob::Opcode::GetOrGetVar:
+				invariant = !m_popC7 && m_setGlobs.count(g->index()) == 0;
+				break;
+			case Glob::Opcode::PUSH_C7:
+				invariant = !m_popC7 && m_setGlobs.empty();
+				break;
+			case Glob::Opcode::PUSHROOT:
+				invariant = !m_popRoot;
+				break;
+			case Glob::Opcode::PUSH_C3:
+				invariant = !m_popC3;
+				break;
+			default:
+				break;
+			}
+			if (invariant)
+				res.push_back(g);
+		}
+		return res;
+	}
+
+private:
+	std::vector<Glob const*> m_reads;
+	std::set<int> m_setGlobs;
+	bool m_popC7{};
+	bool m_popRoot{};
+	bool m_popC3{};
+	bool m_hasCall{};
+};
+
+// Values that are pushed before the loop and dropped after it
+struct Hoisted {
+	Pointer<TvmAstNode> loop;
+	int replaced{};
+};
+
+std::optional<Hoisted> hoist(TvmAstNode const& _loop, Glob const& _value) {
+	int replaced = 0;
+	SlotInserter inserter{[&](TvmAstNode const& _node, int _slot) -> std::optional<std::vector<Pointer<TvmAstNode>>> {
+		if (!(_node == _value))
+			return std::nullopt;
+		++replaced;
+		return std::vector<Pointer<TvmAstNode>>{makePUSH(_slot)};
+	}, true};
+	Pointer<TvmAstNode> loop;
+	if (auto repeat = to<TvmRepeat>(&_loop)) {
+		if (Pointer<CodeBlock> body = inserter.rewrite(repeat->body(), 0))
+			loop = createNode<TvmRepeat>(repeat->withBreakOrReturn(), body);
+	} else if (auto until = to<TvmUntil>(&_loop)) {
+		if (Pointer<CodeBlock> body = inserter.rewrite(until->body(), 0))
+			loop = createNode<TvmUntil>(until->withBreakOrReturn(), body);
+	} else if (auto w = to<While>(&_loop)) {
+		Pointer<CodeBlock> condition = w->isInfinite() ? w->condition() : inserter.rewrite(w->condition(), 0);
+		Pointer<CodeBlock> body = inserter.rewrite(w->body(), 0);
+		if (condition != nullptr && body != nullptr)
+			loop = createNode<While>(w->isInfinite(), w->withBreakOrReturn(), condition, body);
+	}
+	if (loop == nullptr)
+		return std::nullopt;
+	return Hoisted{loop, replaced};
+}
+
+bool withBreakOrReturn(TvmAstNode const& _node) {
+	if (auto repeat = to<TvmRepeat>(&_node))
+		return repeat->withBreakOrReturn();
+	if (auto until = to<TvmUntil>(&_node))
+		return until->withBreakOrReturn();
+	if (auto w = to<While>(&_node))
+		return w->withBreakOrReturn();
+	solUnimplemented("");
+}
+
+} // end anonymous namespace
+
+void LoopInvariantHoister::endVisit(CodeBlock &_node) {
+	std::vector<Pointer<TvmAstNode>> instructions;
+	bool changed = false;
+	for (Pointer<TvmAstNode> const& op : _node.instructions()) {
+		bool const isLoop = to<TvmRepeat>(op.get()) || to<TvmUntil>(op.get()) || to<While>(op.get());
+		// RETALT of break and return drops the values under the loop body
+		if (!isLoop || withBreakOrReturn(*op)) {
+			instructions.emplace_back(op);
+			continue;
+		}
+
+		LoopEffects effects;
+		op->accept(effects);
+		Pointer<TvmAstNode> loop = op;
+		std::vector<Pointer<TvmAstNode>> before;
+		int hoisted = 0;
+		for (Glob const* value : effects.invariantReads()) {
+			std::optional<Hoisted> res = hoist(*loop, *value);
+			if (!res)
+				continue;
+			// PUSH Si is cheaper than the read, but the value is read once more and dropped after the loop.
+			// GETGLOB and PUSH C7 take 16 bits, PUSH Si takes 8 bits.
+			if (GlobalParams::g_optimizeFor == OptimizationObjective::Size && res->replaced * 8 < 16 + 8)
+				continue;
+			before.emplace_back(createNode<Glob>(value->opcode(), value->index()));
+			// the counter of REPEAT is on the top of the stack
+			if (to<TvmRepeat>(loop.get()))
+				before.emplace_back(makeBLKSWAP(1, 1));
+			loop = res->loop;
+			++hoisted;
+		}
+		instructions.insert(instructions.end(), before.begin(), before.end());
+		instructions.emplace_back(loop);
+		if (hoisted > 0) {
+			instructions.emplace_back(makeDROP(hoisted));
+			m_hoistedValues += hoisted;
+			changed = true;
+		}
+	}
+	if (changed) {
+		_node.upd(instructions);
+		m_didSome = true;
+	}
+}
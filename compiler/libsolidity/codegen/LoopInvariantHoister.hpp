@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Loop-invariant code motion
+ */
+
+#pragma once
+
+#include <libsolidity/codegen/TvmAstVisitor.hpp>
+
+namespace solidity::frontend {
+
+// Moves reads of global variables and control registers (GETGLOB, PUSH C7, PUSHROOT, PUSH C3) out of
+// WHILE, REPEAT and UNTIL loops if the loop doesn't change them, e.g.
+//   PUSHCONT {          GETGLOB 10
+//     GETGLOB 10        PUSHCONT {
+//     ...          =>     PUSH S0
+//   }                     ...
+//   UNTIL               }
+//                       UNTIL
+//                       DROP
+// The value is kept on the stack under the values of the loop body and the stack opcodes of the body are
+// shifted. Loops with break or return, and loops that call functions are not changed.
+class LoopInvariantHoister : public TvmAstVisitor {
+public:
+	void endVisit(CodeBlock &_node) override;
+	bool didSome() const { return m_didSome; }
+	int hoistedValues() const { return m_hoistedValues; }
+private:
+	int m_hoistedValues{};
+	bool m_didSome{};
+};
+
+} // end solidity::frontend
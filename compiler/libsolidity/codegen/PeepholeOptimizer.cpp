@@ -14,6 +14,8 @@
  * Peephole optimizer
  */
 
+#include <limits>
+
 #include <boost/format.hpp>
 
 #include <libsolidity/ast/TypeProvider.h>
@@ -56,6 +58,7 @@ public:
 	{
 	}
 	vector<Pointer<TvmAstNode>> const &instructions() const { return m_instructions; }
+	vector<Pointer<TvmAstNode>> releaseInstructions() { return std::move(m_instructions); }
 
 	int nextCommandLine(int idx) const;
 	static int nextCommandLine(int idx, std::vector<Pointer<TvmAstNode>> const& instructions);
@@ -259,17 +262,24 @@ std::optional<Result> PrivatePeepholeOptimizer::optimizeAt1(Pointer<TvmAstNode>
 	auto cmd1IfElse = to<TvmIfElse>(cmd1.get());
 	auto cmd1Sub = to<SubProgram>(cmd1.get());
 
-	if (cmd1GenOpcode && isIn(cmd1GenOpcode->fullOpcode(), "ADDCONST 0", "MULCONST 1")) {
-		return Result{1};
-	}
-	if (cmd1GenOpcode && cmd1GenOpcode->fullOpcode() == "ADDCONST 1") {
-		return Result{1, gen("INC")};
-	}
-	if (cmd1GenOpcode && cmd1GenOpcode->fullOpcode() == "ADDCONST -1") {
-		return Result{1, gen("DEC")};
-	}
-	if (cmd1GenOpcode && cmd1GenOpcode->fullOpcode() == "MULCONST -1") {
-		return Result{1, gen("NEGATE")};
+	if (
+		cmd1GenOpcode && cmd1GenOpcode->comment().empty() && cmd1GenOpcode->intArg() &&
+		isIn(cmd1GenOpcode->symbol(), Opcodes::ADDCONST(), Opcodes::MULCONST())
+	) {
+		bool isAdd = cmd1GenOpcode->symbol() == Opcodes::ADDCONST();
+		bigint const& value = *cmd1GenOpcode->intArg();
+		if (value == (isAdd ? 0 : 1)) {
+			return Result{1};
+		}
+		if (isAdd && value == 1) {
+			return Result{1, gen("INC")};
+		}
+		if (isAdd && value == -1) {
+			return Result{1, gen("DEC")};
+		}
+		if (!isAdd && value == -1) {
+			return Result{1, gen("NEGATE")};
+		}
 	}
 	// PUSHCONT {} IF/IFNOT => DROP
 	if (
@@ -2141,6 +2151,8 @@ std::optional<Result> PrivatePeepholeOptimizer::optimizeAtInf(int idx1) const {
 			int bestOpcodeQty = 0;
 		};
 		std::optional<BestResult> bestResult;
+		// the longest run that fits the tables
+		int tabledOpcodeQty = 0;
 
 		for (int startStackSize = 0; startStackSize <= StackState::MAX_STACK_DEPTH; ++startStackSize)
 		{
@@ -2154,7 +2166,7 @@ std::optional<Result> PrivatePeepholeOptimizer::optimizeAtInf(int idx1) const {
 				auto stack = to<Stack>(get(i).get());
 				if (!stack)
 					break;
-				if (!state.apply(*stack)) {
+				if (!state.apply(stack->command())) {
 					break;
 				}
 
@@ -2167,6 +2179,7 @@ std::optional<Result> PrivatePeepholeOptimizer::optimizeAtInf(int idx1) const {
 
 				i = nextCommandLine(i);
 			}
+			tabledOpcodeQty = std::max(tabledOpcodeQty, opcodeQty);
 		}
 
 		if (bestResult.has_value()) {
@@ -2175,6 +2188,60 @@ std::optional<Result> PrivatePeepholeOptimizer::optimizeAtInf(int idx1) const {
 														   m_flags.test(OptFlags::UseCompoundOpcodes));
 			return Result{bestResult.value().bestOpcodeQty, newOpcodes};
 		}
+
+		// Runs that need deeper stacks are squashed by the search. Each run is searched once
+		// with the smallest stack that it fits. The search is the slowest part of the peephole
+		// optimizer, so it's done only for `--optimize-for gas`.
+		constexpr int MaxSearchedOpcodeQty = 8;
+		std::optional<std::pair<int, std::vector<StackCommand>>> searchResult;
+		int searchedOpcodeQty = tabledOpcodeQty;
+		int const maxSearchedStackSize = GlobalParams::g_optimizeFor == OptimizationObjective::Gas ? StackState::MAX_SEARCH_DEPTH : 0;
+		for (int startStackSize = StackState::MAX_STACK_DEPTH + 1; startStackSize <= maxSearchedStackSize; ++startStackSize) {
+			StackState state{startStackSize, StackState::MAX_SEARCH_DEPTH};
+			int gasCost = 0;
+			int opcodeQty = 0;
+			for (int i = idx1; i != -1 && opcodeQty < MaxSearchedOpcodeQty; i = nextCommandLine(i)) {
+				auto stack = to<Stack>(get(i).get());
+				if (!stack || !state.apply(stack->command()))
+					break;
+				++opcodeQty;
+				gasCost += OpcodeUtils::gasCost(*stack);
+				if (opcodeQty <= searchedOpcodeQty)
+					continue;
+				searchedOpcodeQty = opcodeQty;
+				if (opcodeQty < 2)
+					continue;
+				auto commands = StackOpcodeSquasher::search(startStackSize, state, m_flags.test(OptFlags::UseCompoundOpcodes));
+				if (!commands)
+					continue;
+				int newGasCost = 0;
+				for (StackCommand const& command : *commands)
+					newGasCost += command.gasCost();
+				if (newGasCost < gasCost)
+					searchResult = {opcodeQty, *commands};
+			}
+		}
+
+		if (searchResult.has_value()) {
+			std::vector<Pointer<TvmAstNode>> newOpcodes;
+			for (StackCommand const& command : searchResult->second)
+				newOpcodes.push_back(createNode<Stack>(command.opcode, command.i, command.j, command.k));
+			return Result{searchResult->first, newOpcodes};
+		}
+	}
+
+	// squash stack opcodes that reach values deeper than the tables of the squasher
+	{
+		std::vector<StackCommand> commands;
+		for (int i = idx1; i != -1; i = nextCommandLine(i)) {
+			auto stack = to<Stack>(get(i).get());
+			if (!stack)
+				break;
+			commands.emplace_back(stack->command());
+		}
+		if (commands.size() >= 2)
+			if (auto res = StackOpcodeSquasher::squashDeep(commands))
+				return Result{res->first, res->second};
 	}
 
 	// squash permutation of pure operations
@@ -2535,13 +2602,18 @@ std::optional<std::pair<int, int>> PrivatePeepholeOptimizer::isBLKDROP2(Pointer<
 }
 
 bigint PrivatePeepholeOptimizer::pushintValue(Pointer<TvmAstNode> const& node) {
-	solAssert(is(node, "PUSHINT"), "");
-	auto g = dynamic_pointer_cast<StackOpcode>(node);
+	auto g = to<StackOpcode>(node.get());
+	solAssert(g && g->symbol() == Opcodes::PUSHINT(), "");
+	if (g->intArg())
+		return *g->intArg();
 	return bigint{g->arg()};
 }
 
 int PrivatePeepholeOptimizer::fetchInt(Pointer<TvmAstNode> const& node) {
-	auto g = dynamic_pointer_cast<StackOpcode>(node);
+	auto g = to<StackOpcode>(node.get());
+	std::optional<bigint> const& value = g->intArg();
+	if (value && *value >= std::numeric_limits<int>::min() && *value <= std::numeric_limits<int>::max())
+		return static_cast<int>(*value);
 	return strToInt(g->arg());
 }
 
@@ -2578,21 +2650,21 @@ bool PrivatePeepholeOptimizer::isExc(Pointer<TvmAstNode> const& node, Args&&...
 
 bool PrivatePeepholeOptimizer::isConstAdd(Pointer<TvmAstNode> const& node) {
 	auto gen = to<StackOpcode>(node.get());
-	return gen && isIn(gen->opcode(), "INC", "DEC", "ADDCONST");
+	return gen && isIn(gen->symbol(), Opcodes::INC(), Opcodes::DEC(), Opcodes::ADDCONST());
 }
 
 int PrivatePeepholeOptimizer::getAddNum(Pointer<TvmAstNode> const& node) {
 	solAssert(isConstAdd(node), "");
 	auto gen = to<StackOpcode>(node.get());
 	solAssert(gen, "");
-	if (gen->opcode() == "INC") {
+	if (gen->symbol() == Opcodes::INC()) {
 		return +1;
 	}
-	if (gen->opcode() == "DEC") {
+	if (gen->symbol() == Opcodes::DEC()) {
 		return -1;
 	}
-	if (gen->opcode() == "ADDCONST") {
-		return strToInt(gen->arg());
+	if (gen->symbol() == Opcodes::ADDCONST()) {
+		return fetchInt(node);
 	}
 	solUnimplemented("");
 }
@@ -2612,22 +2684,23 @@ bool PrivatePeepholeOptimizer::isSimpleCommand(Pointer<TvmAstNode> const& node)
 }
 
 bool PrivatePeepholeOptimizer::isAddOrSub(Pointer<TvmAstNode> const& node) {
-	return is(node, "ADD") || is(node, "SUB");
+	auto g = to<StackOpcode>(node.get());
+	return g && isIn(g->symbol(), Opcodes::ADD(), Opcodes::SUB());
 }
 
 bool PrivatePeepholeOptimizer::isCommutative(Pointer<TvmAstNode> const& node) {
-	auto g = dynamic_pointer_cast<StackOpcode>(node);
-	return g && isIn(g->fullOpcode(),
-					 "ADD",
-					 "AND",
-					 "EQUAL",
-					 "MAX",
-					 "MIN",
-					 "MUL",
-					 "NEQ",
-					 "OR",
-					 "SDEQ",
-					 "XOR"
+	auto g = to<StackOpcode>(node.get());
+	return g && g->arg().empty() && g->comment().empty() && isIn(g->symbol(),
+					 Opcodes::ADD(),
+					 Opcodes::AND(),
+					 Opcodes::EQUAL(),
+					 Opcodes::MAX(),
+					 Opcodes::MIN(),
+					 Opcodes::MUL(),
+					 Opcodes::NEQ(),
+					 Opcodes::OR(),
+					 Opcodes::SDEQ(),
+					 Opcodes::XOR()
 	);
 }
 
@@ -2645,33 +2718,34 @@ void PeepholeOptimizer::endVisit(CodeBlock &_node) {
 	optimizeBlock(_node);
 }
 
-void PeepholeOptimizer::optimizeBlock(CodeBlock &_node) const {
+void PeepholeOptimizer::optimizeBlock(CodeBlock &_node) {
 	{
 		std::optional<Result> r = PrivatePeepholeOptimizer{{}, m_flags}.optimizeAt1(_node.shared_from_this());
 		if (r && r.value().commands.size() == 1) {
 			auto newBlock = to<CodeBlock>(r.value().commands.at(0).get());
 			_node.upd(newBlock->instructions());
 			_node.updType(newBlock->type());
+			m_didSome = true;
 		}
 	}
 
-	std::vector<Pointer<TvmAstNode>> instructions = _node.instructions();
-
-	PrivatePeepholeOptimizer optimizer{instructions, m_flags};
-	optimizer.optimize([&](int index){
+	PrivatePeepholeOptimizer optimizer{_node.instructions(), m_flags};
+	m_didSome |= optimizer.optimize([&](int index){
 		return optimizer.unsquash(m_flags.test(OptFlags::UnpackOpaque), index);
 	});
 
 	if (m_flags.test(OptFlags::OptimizeSlice))
 		while (optimizer.optimize([&optimizer](int index){ return optimizer.optimizeSlice(index); })){
+			m_didSome = true;
 		}
 	else
 		while (optimizer.optimize([&optimizer](int index){ return optimizer.optimizeAt(index); })) {
+			m_didSome = true;
 		}
 
 	if (m_flags.test(OptFlags::UseCompoundOpcodes))
-		optimizer.optimize([&optimizer](int index){ return optimizer.squash(index);});
-	_node.upd(optimizer.instructions());
+		m_didSome |= optimizer.optimize([&optimizer](int index){ return optimizer.squash(index);});
+	_node.upd(optimizer.releaseInstructions());
 }
 
 } // end solidity::frontend
@@ -32,10 +32,12 @@ public:
 	bool visit(CodeBlock &_node) override;
 	bool visit(Function &_node) override;
 	void endVisit(CodeBlock &_node) override;
+	bool didSome() const { return m_didSome; }
 private:
-	void optimizeBlock(CodeBlock &_node) const;
+	void optimizeBlock(CodeBlock &_node);
 private:
 	std::bitset<3> m_flags;
+	bool m_didSome{};
 };
 } // end solidity::frontend
 
@@ -14,53 +14,825 @@
  * Size optimizer
  */
 
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <set>
+#include <unordered_set>
+
+#include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/range/adaptor/map.hpp>
 
 #include <libsolidity/codegen/SizeOptimizer.hpp>
+#include <libsolidity/codegen/TVM.hpp>
+#include <libsolidity/codegen/TVMCommons.hpp>
 
 using namespace std;
 using namespace solidity::util;
 using namespace solidity::frontend;
 
+namespace {
+
+// Layout of code in cells: the assembler puts the code of a continuation into a cell and moves
+// the rest of the code into the next cell if it doesn't fit into 1023 bits and 4 references.
+constexpr int CellBits = 1023;
+constexpr int CellRefs = 4;
+// descriptors of a cell and its index in the bag of cells
+constexpr int CellOverheadBits = 16 + 16;
+// reference to a cell in the bag of cells
+constexpr int RefBits = 16;
+
+constexpr int ShortInstruction = 18;
+constexpr int Instruction = 26;
+constexpr int CellLoad = 100;
+constexpr int ImplicitJmp = 10;
+
+// CALLREF with a reference to the cell of an outlined fragment
+constexpr int CallRefBits = 16;
+constexpr int MinOutlinedLength = 2;
+
+struct CodeSize {
+	int bits{};
+	int refs{};
+
+	// the number of cells in the chain, one reference of each cell but the last one is
+	// used for the next cell of the chain
+	int cells() const {
+		int n = std::max(1, (bits + CellBits - 1) / CellBits);
+		while (n * (CellRefs - 1) + 1 < refs)
+			++n;
+		return n;
+	}
+
+	int serializedBits() const {
+		int const n = cells();
+		return n * CellOverheadBits + bits + (refs + n - 1) * RefBits;
+	}
+};
+
+// PUSHSLICE with the short or the long encoding, the data is padded with a completion tag
+int pushSliceBits(int bitSize) {
+	int data = 4;
+	while (data < bitSize + 1)
+		data += 8;
+	if (data <= 124)
+		return 12 + data;
+	data = 6;
+	while (data < bitSize + 1)
+		data += 8;
+	return 24 + data;
+}
+
+int pushIntBits(solidity::bigint const& value) {
+	if (-5 <= value && value <= 10)
+		return 8;
+	if (-128 <= value && value < 128)
+		return 16;
+	if (-32768 <= value && value < 32768)
+		return 24;
+	solidity::bigint absValue = value < 0 ? solidity::bigint{-value} : value;
+	return 16 + 8 * static_cast<int>(boost::multiprecision::msb(absValue) / 8 + 1);
+}
+
+// Suffix array of `text` built by prefix doubling
+std::vector<int> suffixArray(std::vector<int> const& text) {
+	int const n = text.size();
+	std::vector<int> sa(n);
+	std::iota(sa.begin(), sa.end(), 0);
+	if (n == 0)
+		return sa;
+	std::vector<int> rank = text;
+	std::vector<int> newRank(n);
+	for (int k = 1; ; k *= 2) {
+		auto key = [&](int i) {
+			return std::make_pair(rank[i], i + k < n ? rank[i + k] : std::numeric_limits<int>::min());
+		};
+		std::sort(sa.begin(), sa.end(), [&](int a, int b) { return key(a) < key(b); });
+		newRank[sa[0]] = 0;
+		for (int i = 1; i < n; ++i)
+			newRank[sa[i]] = newRank[sa[i - 1]] + (key(sa[i - 1]) < key(sa[i]) ? 1 : 0);
+		rank = newRank;
+		if (rank[sa[n - 1]] == n - 1)
+			break;
+	}
+	return sa;
+}
+
+// lcp[i] is the length of the common prefix of suffixes sa[i - 1] and sa[i] (Kasai's algorithm)
+std::vector<int> lcpArray(std::vector<int> const& text, std::vector<int> const& sa) {
+	int const n = text.size();
+	std::vector<int> rank(n);
+	std::vector<int> lcp(n);
+	for (int i = 0; i < n; ++i)
+		rank[sa[i]] = i;
+	int h = 0;
+	for (int i = 0; i < n; ++i) {
+		if (rank[i] == 0) {
+			h = 0;
+			continue;
+		}
+		int const j = sa[rank[i] - 1];
+		while (i + h < n && j + h < n && text[i + h] == text[j + h])
+			++h;
+		lcp[rank[i]] = h;
+		if (h > 0)
+			--h;
+	}
+	return lcp;
+}
+
 struct SPtrNodeLess {
 	bool operator()(const Pointer<PushCellOrSlice> &first, const Pointer<PushCellOrSlice> &second) const {
 		return *first < *second;
 	}
 };
 
+} // end anonymous namespace
+
+// Collects PUSHSLICE instructions with the same data and estimates the size of code trees.
+// A code tree starts at a function or at a continuation that is stored in a separate cell.
 class SizeOptimizerPrivate : public TvmAstVisitor {
 public:
+	bool visit(AsymGen &_node) override;
+	bool visit(DeclRetFlag &_node) override;
+	bool visit(HardCode &_node) override;
+	bool visit(TvmReturn &_node) override;
+	bool visit(TvmException &_node) override;
+	bool visit(StackOpcode &_node) override;
 	bool visit(PushCellOrSlice &_node) override;
+	bool visit(Glob &_node) override;
+	bool visit(Stack &_node) override;
+	bool visit(CodeBlock &_node) override;
+	bool visit(SubProgram &_node) override;
+	bool visit(LogCircuit &_node) override;
+	bool visit(TvmIfElse &_node) override;
+	bool visit(TvmRepeat &_node) override;
+	bool visit(TvmUntil &_node) override;
+	bool visit(While &_node) override;
+	bool visit(TryCatch &_node) override;
+	bool visit(Function &_node) override;
+	void endVisit(CodeBlock &_node) override;
 	void upd();
+	std::vector<CodeSize> const& trees() const { return m_trees; }
+	std::map<CodeBlock const*, int> const& blockTree() const { return m_blockTree; }
+	// size of the node in the code tree where it's placed, continuations in separate cells are counted as references
+	static CodeSize sizeOf(TvmAstNode& node);
+	// size of the node and all continuations in separate cells
+	static int64_t totalBits(TvmAstNode& node);
+private:
+	bool isProfitable(std::vector<Pointer<PushCellOrSlice>> const& slices, std::map<int, CodeSize> const& newTrees) const;
+	void addBits(int bits) { m_trees.at(m_currentTree.back()).bits += bits; }
+	void addRef() { ++m_trees.at(m_currentTree.back()).refs; }
+	void startTree();
 private:
 	std::map<Pointer<PushCellOrSlice>, std::vector<Pointer<PushCellOrSlice>>, SPtrNodeLess> m_qty;
+	std::vector<CodeSize> m_trees;
+	std::vector<int> m_currentTree;
+	std::map<PushCellOrSlice const*, int> m_sliceTree;
+	std::map<CodeBlock const*, int> m_blockTree;
 };
 
+bool SizeOptimizerPrivate::visit(AsymGen &/*_node*/) {
+	addBits(16);
+	return false;
+}
+
+bool SizeOptimizerPrivate::visit(DeclRetFlag &/*_node*/) {
+	addBits(8);
+	return false;
+}
+
+bool SizeOptimizerPrivate::visit(HardCode &_node) {
+	addBits(16 * _node.code().size());
+	return false;
+}
+
+bool SizeOptimizerPrivate::visit(TvmReturn &/*_node*/) {
+	addBits(8);
+	return false;
+}
+
+bool SizeOptimizerPrivate::visit(TvmException &/*_node*/) {
+	addBits(16);
+	return false;
+}
+
+bool SizeOptimizerPrivate::visit(StackOpcode &_node) {
+	if (!_node.opcode().empty() && _node.opcode().at(0) == '.')
+		return false; // assembler directive, e.g. `.inline`
+	if (_node.symbol() == Opcodes::PUSHINT() && _node.intArg())
+		addBits(pushIntBits(*_node.intArg()));
+	else
+		addBits(_node.arg().empty() ? 8 : 16);
+	return false;
+}
+
 bool SizeOptimizerPrivate::visit(PushCellOrSlice &_node) {
-	if (_node.type() == PushCellOrSlice::Type::PUSHSLICE) {
+	switch (_node.type()) {
+	case PushCellOrSlice::Type::PUSHSLICE: {
 		auto slice = dynamic_pointer_cast<PushCellOrSlice>(_node.shared_from_this());
 		m_qty[slice].push_back(slice);
+		m_sliceTree[&_node] = m_currentTree.back();
+		addBits(pushSliceBits(getRootBitSize(_node)));
+		break;
+	}
+	case PushCellOrSlice::Type::PUSHREF_COMPUTE:
+	case PushCellOrSlice::Type::PUSHREFSLICE_COMPUTE:
+	case PushCellOrSlice::Type::PUSHREF:
+	case PushCellOrSlice::Type::PUSHREFSLICE:
+		addBits(8);
+		addRef();
+		break;
+	case PushCellOrSlice::Type::CELL:
+		break;
 	}
 	return false;
 }
 
-void SizeOptimizerPrivate::upd() {
-	for (std::vector<Pointer<PushCellOrSlice>> & arr : m_qty | boost::adaptors::map_values) {
-		int qty = arr.size();
-		int bitSize = getRootBitSize(*arr.at(0));
+bool SizeOptimizerPrivate::visit(Glob &/*_node*/) {
+	addBits(16);
+	return false;
+}
+
+bool SizeOptimizerPrivate::visit(Stack &_node) {
+	addBits(OpcodeUtils::gasCost(_node) - 10);
+	return false;
+}
+
+bool SizeOptimizerPrivate::visit(CodeBlock &_node) {
+	switch (_node.type()) {
+	case CodeBlock::Type::None:
+		break;
+	case CodeBlock::Type::PUSHCONT:
+		addBits(16);
+		break;
+	case CodeBlock::Type::PUSHREFCONT:
+		addRef();
+		startTree();
+		break;
+	}
+	m_blockTree.emplace(&_node, m_currentTree.back());
+	return true;
+}
+
+void SizeOptimizerPrivate::endVisit(CodeBlock &_node) {
+	if (_node.type() == CodeBlock::Type::PUSHREFCONT)
+		m_currentTree.pop_back();
+}
+
+bool SizeOptimizerPrivate::visit(SubProgram &/*_node*/) {
+	addBits(16); // CALLX, JMPX, CALLREF, JMPREF
+	return true;
+}
+
+bool SizeOptimizerPrivate::visit(LogCircuit &/*_node*/) {
+	addBits(8);
+	return true;
+}
+
+bool SizeOptimizerPrivate::visit(TvmIfElse &/*_node*/) {
+	addBits(16);
+	return true;
+}
+
+bool SizeOptimizerPrivate::visit(TvmRepeat &/*_node*/) {
+	addBits(8);
+	return true;
+}
+
+bool SizeOptimizerPrivate::visit(TvmUntil &/*_node*/) {
+	addBits(8);
+	return true;
+}
+
+bool SizeOptimizerPrivate::visit(While &/*_node*/) {
+	addBits(8);
+	return true;
+}
+
+bool SizeOptimizerPrivate::visit(TryCatch &/*_node*/) {
+	addBits(8);
+	return true;
+}
+
+bool SizeOptimizerPrivate::visit(Function &_node) {
+	startTree();
+	_node.block()->accept(*this);
+	m_currentTree.pop_back();
+	return false;
+}
+
+CodeSize SizeOptimizerPrivate::sizeOf(TvmAstNode& node) {
+	SizeOptimizerPrivate sp;
+	sp.startTree();
+	node.accept(sp);
+	return sp.m_trees.at(0);
+}
+
+int64_t SizeOptimizerPrivate::totalBits(TvmAstNode& node) {
+	SizeOptimizerPrivate sp;
+	sp.startTree();
+	node.accept(sp);
+	int64_t bits = 0;
+	for (CodeSize const& tree : sp.m_trees)
+		bits += tree.bits;
+	return bits;
+}
+
+void SizeOptimizerPrivate::startTree() {
+	m_currentTree.emplace_back(m_trees.size());
+	m_trees.emplace_back();
+}
+
+// Checks whether replacing of `slices` with PUSHREFSLICE to one shared cell is profitable.
+// `newTrees` are sizes of changed code trees after the replacement.
+bool SizeOptimizerPrivate::isProfitable(
+	std::vector<Pointer<PushCellOrSlice>> const& slices,
+	std::map<int, CodeSize> const& newTrees
+) const {
+	int const qty = slices.size();
+	int const bitSize = getRootBitSize(*slices.at(0));
+
+	int codeBitsDelta = 0;
+	int codeCellsDelta = 0;
+	for (auto const& [tree, size] : newTrees) {
+		codeBitsDelta += size.serializedBits() - m_trees.at(tree).serializedBits();
+		codeCellsDelta += size.cells() - m_trees.at(tree).cells();
+	}
+
+	switch (GlobalParams::g_optimizeFor) {
+	case OptimizationObjective::Size: {
+		// the cell with data is stored once in the bag of cells
+		int const dataCellBits = CellOverheadBits + bitSize;
+		return codeBitsDelta + dataCellBits < 0;
+	}
+	case OptimizationObjective::Gas: {
+		// PUSHREFSLICE loads the cell on each execution, but less code cells can be loaded
+		int const gasDelta = qty * (ShortInstruction + CellLoad - Instruction) + codeCellsDelta * (CellLoad + ImplicitJmp);
+		return gasDelta < 0;
+	}
+	case OptimizationObjective::Balanced: {
+		// replace only if it saves a lot of code
 		double oldSize = (12 + bitSize) * qty;
 		double newSize = 8 * qty + bitSize;
 		double coef = 1.7;
-		if (oldSize >= 500 && oldSize >= coef * newSize) {
+		return oldSize >= 500 && oldSize >= coef * newSize;
+	}
+	}
+	solUnimplemented("");
+}
+
+void SizeOptimizerPrivate::upd() {
+	for (std::vector<Pointer<PushCellOrSlice>> & arr : m_qty | boost::adaptors::map_values) {
+		int const bitDelta = 8 - pushSliceBits(getRootBitSize(*arr.at(0)));
+		std::map<int, CodeSize> newTrees;
+		for (Pointer<PushCellOrSlice> const& node : arr) {
+			int const tree = m_sliceTree.at(node.get());
+			auto it = newTrees.emplace(tree, m_trees.at(tree)).first;
+			it->second.bits += bitDelta;
+			++it->second.refs;
+		}
+		if (isProfitable(arr, newTrees)) {
 			for (Pointer<PushCellOrSlice> & node : arr) {
 				node->updToRef();
 			}
+			for (auto const& [tree, size] : newTrees)
+				m_trees.at(tree) = size;
+		}
+	}
+}
+
+// Moves repeated instruction sequences to fragments that are called by `CALLREF { .inline name }`.
+// All cells of CALLREF with the same fragment are stored once in the bag of cells, so each replaced
+// sequence costs only one CALLREF.
+class CodeOutliner {
+public:
+	explicit CodeOutliner(Contract& _contract) : m_contract{_contract} { }
+	void optimize();
+private:
+	struct Repeat {
+		int length{};
+		std::vector<int> positions;
+	};
+	struct Position {
+		CodeBlock* block{};
+		int index{};
+		int tree{};
+		int function{};
+	};
+	struct Replacement {
+		int begin{};
+		int length{};
+		std::vector<Pointer<TvmAstNode>> nodes;
+	};
+
+	bool isOutlinable(TvmAstNode const& node);
+	void collect(CodeBlock& block, int function);
+	int intern(Pointer<TvmAstNode> const& node);
+	std::vector<Repeat> findRepeats() const;
+	bool tryOutline(Repeat const& repeat);
+	void apply();
+private:
+	Contract& m_contract;
+	std::map<std::string, Function const*> m_functions;
+	std::map<TvmAstNode const*, bool> m_outlinable;
+	std::map<std::size_t, std::vector<std::pair<Pointer<TvmAstNode>, int>>> m_ids;
+	int m_idQty{};
+	std::set<CodeBlock const*> m_visitedBlocks;
+	// ids of outlinable instructions, each other instruction and the end of each block is a unique negative separator.
+	// Locations are skipped: they don't belong to the shared code, so they stay in the callers.
+	std::vector<int> m_text;
+	std::vector<Position> m_positions;
+	std::vector<CodeSize> m_sizes;
+	std::vector<bool> m_used;
+	std::vector<CodeSize> m_trees;
+	std::map<CodeBlock const*, int> m_blockTree;
+	std::map<CodeBlock*, std::vector<Replacement>> m_replacements;
+	// outlined fragments are defined before the first function that uses them
+	std::map<int, std::vector<Pointer<Function>>> m_fragments;
+	int m_fragmentQty{};
+};
+
+namespace {
+
+std::size_t shallowHash(TvmAstNode const& node) {
+	std::size_t hash = typeid(node).hash_code();
+	if (auto stack = to<Stack>(&node)) {
+		boost::hash_combine(hash, static_cast<int>(stack->opcode()));
+		boost::hash_combine(hash, stack->i());
+		boost::hash_combine(hash, stack->j());
+		boost::hash_combine(hash, stack->k());
+	} else if (auto glob = to<Glob>(&node)) {
+		boost::hash_combine(hash, static_cast<int>(glob->opcode()));
+		boost::hash_combine(hash, glob->index());
+	} else if (auto opcode = to<StackOpcode>(&node)) {
+		// TRUE is equal to PUSHINT -1 and FALSE is equal to PUSHINT 0
+		if (std::optional<solidity::bigint> value = opcode->pushedInt())
+			boost::hash_combine(hash, value->str());
+		else {
+			boost::hash_combine(hash, opcode->opcode());
+			boost::hash_combine(hash, opcode->arg());
+		}
+	} else if (auto slice = to<PushCellOrSlice>(&node)) {
+		boost::hash_combine(hash, slice->blob());
+	} else if (auto loc = to<Loc>(&node)) {
+		boost::hash_combine(hash, loc->line());
+	} else if (auto block = to<CodeBlock>(&node)) {
+		boost::hash_combine(hash, block->instructions().size());
+	}
+	return hash;
+}
+
+// Stack effect of an instruction. Only the net change is taken into account for stack manipulation
+// instructions, because the outlined code works with the whole stack of the caller.
+std::pair<int, int> stackEffect(TvmAstNode const& node) {
+	if (auto gen = to<Gen>(&node))
+		return {gen->take(), gen->ret()};
+	if (auto ex = to<TvmException>(&node))
+		return {ex->take(), 0};
+	if (to<CodeBlock>(&node))
+		return {0, 1};
+	if (to<LogCircuit>(&node))
+		return {2, 1};
+	if (auto stack = to<Stack>(&node)) {
+		int delta{};
+		switch (stack->opcode()) {
+		case Stack::Opcode::BLKPUSH:
+			delta = stack->i();
+			break;
+		case Stack::Opcode::DROP:
+		case Stack::Opcode::BLKDROP2:
+			delta = -stack->i();
+			break;
+		case Stack::Opcode::POP_S:
+			delta = -1;
+			break;
+		case Stack::Opcode::BLKSWAP:
+		case Stack::Opcode::REVERSE:
+		case Stack::Opcode::XCHG:
+		case Stack::Opcode::XCHG2:
+		case Stack::Opcode::XCHG3:
+			break;
+		case Stack::Opcode::PUXC:
+		case Stack::Opcode::XCPU:
+		case Stack::Opcode::XC2PU:
+		case Stack::Opcode::PUXC2:
+		case Stack::Opcode::XCPUXC:
+		case Stack::Opcode::PUSH_S:
+			delta = 1;
+			break;
+		case Stack::Opcode::PUSH2_S:
+		case Stack::Opcode::XCPU2:
+		case Stack::Opcode::PUXCPU:
+		case Stack::Opcode::PU2XC:
+			delta = 2;
+			break;
+		case Stack::Opcode::PUSH3_S:
+			delta = 3;
+			break;
+		}
+		return delta >= 0 ? std::make_pair(0, delta) : std::make_pair(-delta, 0);
+	}
+	return {0, 0};
+}
+
+// Instructions that use c0 or pass control out of the current continuation work differently
+// in the outlined code
+bool changesControlFlow(StackOpcode const& opcode) {
+	static std::unordered_set<std::string> const opcodes{
+		"RET", "RETALT", "RETBOOL", "RETARGS", "RETVARARGS", "RETDATA", "RETURNARGS", "RETURNVARARGS",
+		"IFRET", "IFNOTRET", "IFRETALT", "IFNOTRETALT", "THENRET", "THENRETALT",
+		"JMPX", "JMPXARGS", "JMPXDATA", "JMPXVARARGS", "JMPREF", "JMPREFDATA", "JMPDICT",
+		"CALLCC", "CALLCCARGS", "CALLCCVARARGS",
+		"IF", "IFNOT", "IFJMP", "IFNOTJMP", "IFELSE", "IFREF", "IFNOTREF", "IFJMPREF", "IFNOTJMPREF",
+		"IFREFELSE", "IFELSEREF", "IFREFELSEREF", "IFBITJMP", "IFNBITJMP", "IFBITJMPREF", "IFNBITJMPREF",
+		"BRANCH", "BOOLEVAL", "INVERT",
+		"REPEAT", "REPEATEND", "REPEATBRK", "REPEATENDBRK", "UNTIL", "UNTILEND", "UNTILBRK", "UNTILENDBRK",
+		"WHILE", "WHILEEND", "WHILEBRK", "WHILEENDBRK", "AGAIN", "AGAINEND", "AGAINBRK", "AGAINENDBRK",
+		"SETCONTARGS", "SETCONTVARARGS", "SETNUMVARARGS", "SETCONTCTR", "SETCONTCTRX", "SETRETCTR", "SETALTCTR",
+		"PUSHCTR", "PUSHCTRX", "POPCTR", "POPCTRX", "POPSAVE", "SAVE", "SAVEALT", "SAVEBOTH",
+		"SAMEALT", "SAMEALTSAVE", "COMPOS", "COMPOSALT", "COMPOSBOTH", "ATEXIT", "ATEXITALT", "SETEXITALT",
+		"TRY", "TRYARGS"
+	};
+	if (opcodes.count(boost::algorithm::to_upper_copy(opcode.opcode())))
+		return true;
+	// e.g. PUSH c0 or POP c1
+	std::string const arg = boost::algorithm::to_upper_copy(opcode.arg());
+	return arg == "C0" || arg == "C1";
+}
+
+} // end anonymous namespace
+
+bool CodeOutliner::isOutlinable(TvmAstNode const& node) {
+	if (auto it = m_outlinable.find(&node); it != m_outlinable.end())
+		return it->second;
+
+	auto blockIsOutlinable = [&](Pointer<CodeBlock> const& block) {
+		return block == nullptr || std::all_of(block->instructions().begin(), block->instructions().end(),
+			[&](Pointer<TvmAstNode> const& i) { return isOutlinable(*i); });
+	};
+
+	bool res = false;
+	if (to<Loc>(&node) || to<Stack>(&node) || to<Glob>(&node) || to<PushCellOrSlice>(&node) || to<TvmException>(&node)) {
+		res = true;
+	} else if (auto opcode = to<StackOpcode>(&node)) {
+		if (opcode->opcode() == ".inline") {
+			auto it = m_functions.find(opcode->arg());
+			res = it != m_functions.end() && blockIsOutlinable(it->second->block());
+		} else {
+			res = !boost::starts_with(opcode->opcode(), ".") && !changesControlFlow(*opcode);
 		}
+	} else if (auto block = to<CodeBlock>(&node)) {
+		res = std::all_of(block->instructions().begin(), block->instructions().end(),
+			[&](Pointer<TvmAstNode> const& i) { return isOutlinable(*i); });
+	} else if (auto sub = to<SubProgram>(&node)) {
+		res = !sub->isJmp() && blockIsOutlinable(sub->block());
+	} else if (auto lc = to<LogCircuit>(&node)) {
+		res = blockIsOutlinable(lc->body());
 	}
+	// AsymGen, HardCode and Opaque have unknown stack effect. TvmIfElse is opaque too: its bodies may
+	// work with stack entries below the condition, which `stackEffect` doesn't see.
+	// Loops, returns and try-catch are not compared.
+	m_outlinable[&node] = res;
+	return res;
+}
+
+int CodeOutliner::intern(Pointer<TvmAstNode> const& node) {
+	std::vector<std::pair<Pointer<TvmAstNode>, int>>& bucket = m_ids[shallowHash(*node)];
+	for (auto const& [other, id] : bucket)
+		if (*other == *node)
+			return id;
+	bucket.emplace_back(node, m_idQty);
+	return m_idQty++;
+}
+
+void CodeOutliner::collect(CodeBlock& block, int function) {
+	if (!m_visitedBlocks.insert(&block).second)
+		return; // the block is shared, so it can't be changed in one place
+	int const tree = m_blockTree.at(&block);
+	auto addSeparator = [&]() {
+		m_text.emplace_back(-static_cast<int>(m_text.size()) - 1);
+		m_positions.emplace_back();
+		m_sizes.emplace_back();
+	};
+	std::vector<Pointer<TvmAstNode>> const& instructions = block.instructions();
+	for (size_t i = 0; i < instructions.size(); ++i) {
+		Pointer<TvmAstNode> const& node = instructions[i];
+		if (to<Loc>(node.get()))
+			continue;
+		if (isOutlinable(*node)) {
+			m_text.emplace_back(intern(node));
+			m_positions.emplace_back(Position{&block, static_cast<int>(i), tree, function});
+			m_sizes.emplace_back(SizeOptimizerPrivate::sizeOf(*node));
+			continue;
+		}
+		addSeparator();
+		std::vector<Pointer<CodeBlock>> nested;
+		if (to<CodeBlock>(node.get()))
+			nested = {dynamic_pointer_cast<CodeBlock>(node)};
+		else if (auto sub = to<SubProgram>(node.get()))
+			nested = {sub->block()};
+		else if (auto op = to<Opaque>(node.get()))
+			nested = {op->block()};
+		else if (auto r = to<ReturnOrBreakOrCont>(node.get()))
+			nested = {r->body()};
+		else if (auto lc = to<LogCircuit>(node.get()))
+			nested = {lc->body()};
+		else if (auto ifElse = to<TvmIfElse>(node.get()))
+			nested = {ifElse->trueBody(), ifElse->falseBody()};
+		else if (auto repeat = to<TvmRepeat>(node.get()))
+			nested = {repeat->body()};
+		else if (auto until = to<TvmUntil>(node.get()))
+			nested = {until->body()};
+		else if (auto w = to<While>(node.get()))
+			nested = {w->condition(), w->body()};
+		else if (auto tc = to<TryCatch>(node.get()))
+			nested = {tc->tryBody(), tc->catchBody()};
+		for (Pointer<CodeBlock> const& b : nested)
+			if (b != nullptr)
+				collect(*b, function);
+	}
+	addSeparator();
+}
+
+std::vector<CodeOutliner::Repeat> CodeOutliner::findRepeats() const {
+	std::vector<int> const sa = suffixArray(m_text);
+	std::vector<int> const lcp = lcpArray(m_text, sa);
+	int const n = m_text.size();
+
+	// each lcp-interval of the suffix array is a sequence that occurs at least twice
+	std::vector<Repeat> repeats;
+	std::vector<std::pair<int, int>> intervals{{0, 0}}; // common prefix length, left bound
+	for (int i = 1; i <= n; ++i) {
+		int const len = i < n ? lcp[i] : 0;
+		int left = i - 1;
+		while (intervals.back().first > len) {
+			auto const [length, bound] = intervals.back();
+			intervals.pop_back();
+			if (length >= MinOutlinedLength) {
+				Repeat& r = repeats.emplace_back(Repeat{length, {sa.begin() + bound, sa.begin() + i}});
+				std::sort(r.positions.begin(), r.positions.end());
+			}
+			left = bound;
+		}
+		if (intervals.back().first < len)
+			intervals.emplace_back(len, left);
+	}
+	return repeats;
+}
+
+bool CodeOutliner::tryOutline(Repeat const& repeat) {
+	int const length = repeat.length;
+	std::vector<int> positions;
+	for (int pos : repeat.positions) {
+		if (!positions.empty() && pos < positions.back() + length)
+			continue;
+		if (std::any_of(m_used.begin() + pos, m_used.begin() + pos + length, [](bool used) { return used; }))
+			continue;
+		positions.emplace_back(pos);
+	}
+	if (positions.size() < 2)
+		return false;
+
+	CodeSize fragment;
+	for (int i = 0; i < length; ++i) {
+		fragment.bits += m_sizes.at(positions.at(0) + i).bits;
+		fragment.refs += m_sizes.at(positions.at(0) + i).refs;
+	}
+	std::map<int, CodeSize> newTrees;
+	for (int pos : positions) {
+		int const tree = m_positions.at(pos).tree;
+		auto it = newTrees.emplace(tree, m_trees.at(tree)).first;
+		it->second.bits += CallRefBits - fragment.bits;
+		it->second.refs += 1 - fragment.refs;
+	}
+	int bitsDelta = fragment.serializedBits();
+	for (auto const& [tree, size] : newTrees)
+		bitsDelta += size.serializedBits() - m_trees.at(tree).serializedBits();
+	if (bitsDelta >= 0)
+		return false;
+
+	// an occurrence ends after its last outlinable instruction, locations inside it are not outlined
+	auto endOf = [&](int pos) { return m_positions.at(pos + length - 1).index + 1; };
+	auto isLoc = [](Pointer<TvmAstNode> const& node) { return to<Loc>(node.get()) != nullptr; };
+
+	Position const& first = m_positions.at(positions.at(0));
+	std::vector<Pointer<TvmAstNode>> const& instructions = first.block->instructions();
+	std::vector<Pointer<TvmAstNode>> body;
+	std::remove_copy_if(instructions.begin() + first.index, instructions.begin() + endOf(positions.at(0)),
+		std::back_inserter(body), isLoc);
+	int height = 0;
+	int minHeight = 0;
+	for (Pointer<TvmAstNode> const& node : body) {
+		auto const [take, ret] = stackEffect(*node);
+		minHeight = std::min(minHeight, height - take);
+		height += ret - take;
+	}
+	int const take = -minHeight;
+	int const ret = height - minHeight;
+
+	std::string name;
+	do {
+		name = "__outlined" + std::to_string(m_fragmentQty++);
+	} while (m_functions.count(name) != 0);
+	auto f = createNode<Function>(take, ret, name, std::nullopt, Function::FunctionType::Fragment,
+		createNode<CodeBlock>(CodeBlock::Type::None, body));
+
+	int firstFunction = first.function;
+	for (int pos : positions) {
+		Position const& p = m_positions.at(pos);
+		firstFunction = std::min(firstFunction, p.function);
+		auto call = createNode<StackOpcode>(".inline " + name, take, ret);
+		auto block = createNode<CodeBlock>(CodeBlock::Type::PUSHREFCONT, std::vector<Pointer<TvmAstNode>>{call});
+		// the locations stay in the caller before the call
+		std::vector<Pointer<TvmAstNode>> const& code = p.block->instructions();
+		std::vector<Pointer<TvmAstNode>> nodes;
+		std::copy_if(code.begin() + p.index, code.begin() + endOf(pos), std::back_inserter(nodes), isLoc);
+		nodes.emplace_back(createNode<SubProgram>(take, ret, false, block, false));
+		m_replacements[p.block].emplace_back(Replacement{p.index, endOf(pos) - p.index, nodes});
+		std::fill(m_used.begin() + pos, m_used.begin() + pos + length, true);
+	}
+	m_fragments[firstFunction].emplace_back(f);
+	for (auto const& [tree, size] : newTrees)
+		m_trees.at(tree) = size;
+	return true;
+}
+
+void CodeOutliner::apply() {
+	for (auto& [block, replacements] : m_replacements) {
+		std::sort(replacements.begin(), replacements.end(), [](Replacement const& a, Replacement const& b) {
+			return a.begin < b.begin;
+		});
+		std::vector<Pointer<TvmAstNode>> const& instructions = block->instructions();
+		std::vector<Pointer<TvmAstNode>> newInstructions;
+		int i = 0;
+		for (Replacement const& r : replacements) {
+			newInstructions.insert(newInstructions.end(), instructions.begin() + i, instructions.begin() + r.begin);
+			newInstructions.insert(newInstructions.end(), r.nodes.begin(), r.nodes.end());
+			i = r.begin + r.length;
+		}
+		newInstructions.insert(newInstructions.end(), instructions.begin() + i, instructions.end());
+		block->upd(newInstructions);
+	}
+
+	std::vector<Pointer<Function>> functions;
+	for (size_t i = 0; i < m_contract.functions().size(); ++i) {
+		if (auto it = m_fragments.find(static_cast<int>(i)); it != m_fragments.end())
+			functions.insert(functions.end(), it->second.begin(), it->second.end());
+		functions.emplace_back(m_contract.functions().at(i));
+	}
+	m_contract.updFunctions(functions);
+}
+
+void CodeOutliner::optimize() {
+	SizeOptimizerPrivate sp;
+	m_contract.accept(sp);
+	m_trees = sp.trees();
+	m_blockTree = sp.blockTree();
+
+	for (Pointer<Function> const& f : m_contract.functions())
+		m_functions.emplace(f->name(), f.get());
+	for (size_t i = 0; i < m_contract.functions().size(); ++i)
+		collect(*m_contract.functions().at(i)->block(), i);
+	m_used.assign(m_text.size(), false);
+
+	std::vector<Repeat> repeats = findRepeats();
+	// outline sequences that save more code first
+	auto estimate = [&](Repeat const& r) {
+		int bits = 0;
+		for (int i = 0; i < r.length; ++i)
+			bits += m_sizes.at(r.positions.at(0) + i).bits;
+		int const qty = r.positions.size();
+		return (qty - 1) * bits - qty * (CallRefBits + RefBits) - CellOverheadBits;
+	};
+	std::vector<std::pair<int, size_t>> order;
+	for (size_t i = 0; i < repeats.size(); ++i) {
+		int const saving = estimate(repeats[i]);
+		if (saving > 0)
+			order.emplace_back(-saving, i);
+	}
+	std::sort(order.begin(), order.end());
+
+	bool changed = false;
+	for (auto const& [saving, i] : order)
+		changed |= tryOutline(repeats.at(i));
+	if (changed)
+		apply();
+}
+
+int64_t solidity::frontend::codeSizeInBits(TvmAstNode& node) {
+	return SizeOptimizerPrivate::totalBits(node);
 }
 
 void SizeOptimizer::optimize(Pointer<Contract>& c){
+	if (GlobalParams::g_optimizeFor == OptimizationObjective::Size) {
+		// each call of an outlined fragment loads a cell, so outlining is not used for gas
+		CodeOutliner outliner{*c};
+		outliner.optimize();
+	}
+
 	SizeOptimizerPrivate sp;
 	c->accept(sp);
 	sp.upd();
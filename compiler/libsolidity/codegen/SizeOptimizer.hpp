@@ -23,5 +23,8 @@ namespace solidity::frontend {
 	public:
 		void optimize(Pointer<Contract>& c);
 	};
+
+	// Estimated size of the code in bits, including continuations that are stored in separate cells
+	int64_t codeSizeInBits(TvmAstNode& node);
 } // end solidity::frontend
 
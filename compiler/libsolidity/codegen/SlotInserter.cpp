@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Insertion of a value into the stack of generated code
+ */
+
+#include <algorithm>
+
+#include <libsolidity/codegen/SlotInserter.hpp>
+#include <libsolidity/codegen/TVMCommons.hpp>
+
+using namespace solidity::frontend;
+
+SlotInserter::SlotInserter(Replacer _replacer, bool _inLoop) :
+	m_replacer{std::move(_replacer)},
+	m_loopDepth{_inLoop ? 1 : 0}
+{
+}
+
+Pointer<CodeBlock> SlotInserter::rewrite(Pointer<CodeBlock> const& _block, int depth) {
+	std::vector<Pointer<TvmAstNode>> instructions;
+	for (Pointer<TvmAstNode> const& op : _block->instructions())
+		if (!rewrite(op, depth, instructions))
+			return nullptr;
+	return createNode<CodeBlock>(_block->type(), instructions);
+}
+
+bool SlotInserter::rewrite(Pointer<TvmAstNode> const& _node, int& depth, std::vector<Pointer<TvmAstNode>>& _out) {
+	// the inserted value can't be reached by stack opcodes
+	if (depth > 255)
+		return false;
+	if (std::optional<std::vector<Pointer<TvmAstNode>>> code = m_replacer(*_node, depth)) {
+		auto gen = to<Gen>(_node.get());
+		solAssert(gen != nullptr, "");
+		if (gen->take() > depth)
+			return false;
+		_out.insert(_out.end(), code->begin(), code->end());
+		depth += gen->ret() - gen->take();
+		return true;
+	}
+	Pointer<TvmAstNode> op = rewriteNode(_node, depth);
+	if (op == nullptr)
+		return false;
+	_out.emplace_back(op);
+	return true;
+}
+
+Pointer<CodeBlock> SlotInserter::rewriteLoopBody(Pointer<CodeBlock> const& _block, int depth) {
+	++m_loopDepth;
+	Pointer<CodeBlock> block = rewrite(_block, depth);
+	--m_loopDepth;
+	return block;
+}
+
+Pointer<TvmAstNode> SlotInserter::rewriteNode(Pointer<TvmAstNode> const& _op, int& depth) {
+	TvmAstNode const* op = _op.get();
+	if (to<Loc>(op))
+		return _op;
+	if (auto stack = to<Stack>(op))
+		return rewriteStack(*stack, _op, depth);
+	if (to<DeclRetFlag>(op) || to<PushCellOrSlice>(op)) {
+		++depth;
+		return _op;
+	}
+	if (to<Glob>(op) || to<StackOpcode>(op) || to<HardCode>(op)) {
+		auto gen = to<Gen>(op);
+		if (gen->take() > depth || (!mayLeave() && leavesContinuation(*op)))
+			return nullptr;
+		depth += gen->ret() - gen->take();
+		return _op;
+	}
+	if (auto opaque = to<Opaque>(op)) {
+		if (opaque->take() > depth)
+			return nullptr;
+		Pointer<CodeBlock> block = rewrite(opaque->block(), depth);
+		if (block == nullptr)
+			return nullptr;
+		depth += opaque->ret() - opaque->take();
+		return createNode<Opaque>(block, opaque->take(), opaque->ret(), opaque->isPure());
+	}
+	if (auto sub = to<SubProgram>(op)) {
+		if (sub->take() > depth || (sub->isJmp() && !mayLeave()))
+			return nullptr;
+		Pointer<CodeBlock> block = rewrite(sub->block(), depth);
+		if (block == nullptr)
+			return nullptr;
+		depth += sub->ret() - sub->take();
+		return createNode<SubProgram>(sub->take(), sub->ret(), sub->isJmp(), block, sub->isPure());
+	}
+	if (auto ifElse = to<TvmIfElse>(op)) {
+		if (depth < 1 || (ifElse->withJmp() && !mayLeave()))
+			return nullptr;
+		--depth;
+		Pointer<CodeBlock> trueBody = rewrite(ifElse->trueBody(), depth);
+		Pointer<CodeBlock> falseBody;
+		if (ifElse->falseBody() != nullptr)
+			falseBody = rewrite(ifElse->falseBody(), depth);
+		if (trueBody == nullptr || (ifElse->falseBody() != nullptr && falseBody == nullptr))
+			return nullptr;
+		depth += ifElse->ret();
+		return createNode<TvmIfElse>(ifElse->withNot(), ifElse->withJmp(), trueBody, falseBody, ifElse->ret());
+	}
+	if (auto lc = to<LogCircuit>(op)) {
+		// see Simulator::visit(LogCircuit&)
+		if (depth < 2)
+			return nullptr;
+		--depth;
+		Pointer<CodeBlock> body = rewrite(lc->body(), depth);
+		if (body == nullptr)
+			return nullptr;
+		return createNode<LogCircuit>(lc->type(), body);
+	}
+	if (auto repeat = to<TvmRepeat>(op)) {
+		if (depth < 1 || (repeat->withBreakOrReturn() && !mayLeave()))
+			return nullptr;
+		--depth;
+		Pointer<CodeBlock> body = rewriteLoopBody(repeat->body(), depth);
+		if (body == nullptr)
+			return nullptr;
+		return createNode<TvmRepeat>(repeat->withBreakOrReturn(), body);
+	}
+	if (auto until = to<TvmUntil>(op)) {
+		if (until->withBreakOrReturn() && !mayLeave())
+			return nullptr;
+		Pointer<CodeBlock> body = rewriteLoopBody(until->body(), depth);
+		if (body == nullptr)
+			return nullptr;
+		return createNode<TvmUntil>(until->withBreakOrReturn(), body);
+	}
+	if (auto loop = to<While>(op)) {
+		if (loop->withBreakOrReturn() && !mayLeave())
+			return nullptr;
+		// the condition of an infinite loop isn't executed
+		Pointer<CodeBlock> condition = loop->isInfinite() ? loop->condition() : rewriteLoopBody(loop->condition(), depth);
+		Pointer<CodeBlock> body = rewriteLoopBody(loop->body(), depth);
+		if (condition == nullptr || body == nullptr)
+			return nullptr;
+		return createNode<While>(loop->isInfinite(), loop->withBreakOrReturn(), condition, body);
+	}
+	if (auto ret = to<ReturnOrBreakOrCont>(op)) {
+		if (ret->take() > depth || !mayLeave())
+			return nullptr;
+		int bodyDepth = depth;
+		Pointer<CodeBlock> body = rewrite(ret->body(), bodyDepth);
+		if (body == nullptr)
+			return nullptr;
+		return createNode<ReturnOrBreakOrCont>(ret->take(), body);
+	}
+	if (auto exc = to<TvmException>(op)) {
+		if (exc->take() > depth)
+			return nullptr;
+		depth -= exc->take();
+		return _op;
+	}
+	if (auto ret = to<TvmReturn>(op)) {
+		if (!mayLeave())
+			return nullptr;
+		if (ret->withIf()) {
+			if (depth < 1)
+				return nullptr;
+			--depth;
+		}
+		return _op;
+	}
+	// TryCatch, AsymGen
+	return nullptr;
+}
+
+Pointer<TvmAstNode> SlotInserter::rewriteStack(Stack const& _node, Pointer<TvmAstNode> const& _op, int& depth) {
+	int const i = _node.i();
+	int const j = _node.j();
+	int const k = _node.k();
+	// index of a value after the insertion
+	auto shift = [&](int index) { return index >= depth ? index + 1 : index; };
+	int const si = shift(i);
+	int const sj = shift(j);
+	int const sk = shift(k);
+	// short forms of opcodes take indexes up to 15, long ones take indexes up to 255
+	int const maxIndex = std::max({si, sj, sk});
+	bool const isShortForm = isIn(_node.opcode(), Stack::Opcode::PUSH2_S, Stack::Opcode::PUSH3_S,
+		Stack::Opcode::BLKPUSH, Stack::Opcode::REVERSE) || (_node.opcode() == Stack::Opcode::XCHG && si != 0);
+	if (maxIndex > (isShortForm ? 15 : 255))
+		return nullptr;
+	switch (_node.opcode()) {
+	case Stack::Opcode::PUSH_S:
+		++depth;
+		return makePUSH(si);
+	case Stack::Opcode::PUSH2_S:
+		depth += 2;
+		return makePUSH2(si, sj);
+	case Stack::Opcode::PUSH3_S:
+		depth += 3;
+		return makePUSH3(si, sj, sk);
+	case Stack::Opcode::POP_S:
+		if (depth < 1)
+			return nullptr;
+		--depth;
+		return makePOP(si);
+	case Stack::Opcode::XCHG:
+		return makeXCH_S_S(si, sj);
+	case Stack::Opcode::DROP:
+		if (i > depth)
+			return nullptr;
+		depth -= i;
+		return _op;
+	case Stack::Opcode::BLKDROP2:
+		if (i + j > depth)
+			return nullptr;
+		depth -= i;
+		return _op;
+	case Stack::Opcode::BLKSWAP:
+		if (i + j > depth)
+			return nullptr;
+		return _op;
+	case Stack::Opcode::BLKPUSH:
+		// copies s[j]...s[j-i+1]
+		if (j - i + 1 < depth && depth <= j)
+			return nullptr;
+		depth += i;
+		return makeBLKPUSH(i, sj);
+	case Stack::Opcode::REVERSE:
+		// reverses s[j]...s[j+i-1]
+		if (j < depth && depth <= j + i - 1)
+			return nullptr;
+		return makeREVERSE(i, sj);
+	default: {
+		// compound opcodes are changed only if they don't reach the inserted value
+		int const window = std::max({i, j, k, 1}) + 2;
+		if (window > depth || window > StackState::MAX_SEARCH_DEPTH)
+			return nullptr;
+		StackState state{window, StackState::MAX_SEARCH_DEPTH};
+		if (!state.apply(_node.command()))
+			return nullptr;
+		depth += state.size() - window;
+		return _op;
+	}
+	}
+}
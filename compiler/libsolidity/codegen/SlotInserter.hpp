@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Insertion of a value into the stack of generated code
+ */
+
+#pragma once
+
+#include <functional>
+#include <optional>
+
+#include <libsolidity/codegen/TvmAst.hpp>
+
+namespace solidity::frontend {
+
+// Rewrites code as if a new value was inserted into the stack under the top `depth` values.
+// Stack opcodes are re-indexed, nodes chosen by the replacer are replaced with code that reads the inserted value.
+// Fails if the code takes, drops or moves the inserted value.
+class SlotInserter {
+public:
+	// Returns the code that replaces `_node`, or nullopt if the node isn't replaced. `_slot` is the index of
+	// the inserted value before `_node`. The code must have the same stack effect as the node.
+	using Replacer = std::function<std::optional<std::vector<Pointer<TvmAstNode>>>(TvmAstNode const& _node, int _slot)>;
+
+	// If `_inLoop` is false, the code must not leave the current continuation (e.g. by RET or IFJMP) outside of
+	// loops, because the inserted value is dropped after the code.
+	SlotInserter(Replacer _replacer, bool _inLoop);
+
+	// Returns nullptr on failure
+	Pointer<CodeBlock> rewrite(Pointer<CodeBlock> const& _block, int depth);
+	// Appends the rewritten node to `_out`, returns false on failure
+	bool rewrite(Pointer<TvmAstNode> const& _node, int& depth, std::vector<Pointer<TvmAstNode>>& _out);
+
+private:
+	Pointer<TvmAstNode> rewriteNode(Pointer<TvmAstNode> const& _op, int& depth);
+	Pointer<TvmAstNode> rewriteStack(Stack const& _node, Pointer<TvmAstNode> const& _op, int& depth);
+	Pointer<CodeBlock> rewriteLoopBody(Pointer<CodeBlock> const& _block, int depth);
+	bool mayLeave() const { return m_loopDepth > 0; }
+
+private:
+	Replacer m_replacer;
+	int m_loopDepth{};
+};
+
+} // end solidity::frontend
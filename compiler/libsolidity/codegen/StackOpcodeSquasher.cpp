@@ -11,447 +11,526 @@
  * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
  */
 
-#include <chrono>
-#include <deque>
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <unordered_map>
 
 #include <libsolidity/codegen/StackOpcodeSquasher.hpp>
 
+#ifdef SOL_PRECOMPUTED_SQUASHER_TABLES
+#include <libsquasher/tables.h>
+#endif
+
 using namespace solidity::frontend;
 using namespace std;
 
-StackState::StackState(int _size) {
-	m_size = _size;
-	for (int8_t i = 0; i < m_size; ++i) {
-		m_values[i] = i;
-	}
-	updHash();
-}
+namespace {
 
-bool StackState::apply(Stack const &opcode) {
-	auto execPUSHS = [this](int index) -> bool {
-		if (index < m_size && m_size + 1 <= StackState::MAX_STACK_DEPTH) {
-			int8_t val = m_values[index];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 1] = m_values[i];
-			m_values[0] = val;
-			++m_size;
-			return true;
-		}
-		return false;
-	};
-	auto execPUXC = [this](int index, int j) -> bool {
-		if (j + 1 < m_size && index < m_size && m_size + 1 <= StackState::MAX_STACK_DEPTH) {
-			int8_t val = m_values[index];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 1] = m_values[i];
-			m_values[0] = val;
-			std::swap(m_values[0], m_values[1]);
-			std::swap(m_values[0], m_values[j + 1]);
-			++m_size;
-			return true;
-		}
-		return false;
-	};
+// values that are deeper than any stack opcode can reach
+constexpr int DeepStackSize = 256 + 16;
 
-	bool ok = false;
-	int const index0 = opcode.i();
-	int const index1 = opcode.j();
-	int const index2 = opcode.k();
-	switch (opcode.opcode()) {
-	case Stack::Opcode::BLKSWAP: {
-		int down = opcode.i();
-		int up = opcode.j();
-		if (down + up > m_size) {
-			break;
-		}
-		ok = true;
-		std::reverse(m_values.begin(), m_values.begin() + up);
-		std::reverse(m_values.begin() + up, m_values.begin() + up + down);
-		std::reverse(m_values.begin(), m_values.begin() + up + down);
-		break;
-	}
-	case Stack::Opcode::REVERSE: {
-		int qty = opcode.i();
-		int index = opcode.j();
-		if (index + qty <= m_size) {
-			// [index..index+qty-1]
-			std::reverse(m_values.begin() + index, m_values.begin() + index + qty);
-			ok = true;
-		}
+// Gas cost of the opcode. Opcodes with big arguments take them from the stack, see Printer::visit(Stack&).
+int deepGasCost(StackCommand const& _command) {
+	int const pushInt = 18;
+	switch (_command.opcode) {
+	case StackCommand::Opcode::BLKSWAP:
+		if (_command.i > 16 || _command.j > 16) // ROLLX / ROLLREVX / BLKSWX
+			return (_command.i == 1 || _command.j == 1 ? pushInt : 2 * pushInt) + 26;
 		break;
-	}
-	case Stack::Opcode::XCHG: {
-		int i = opcode.i();
-		int j = opcode.j();
-		if (i >= m_size || j >= m_size) {
-			break;
-		}
-		solAssert(i != -1, "");
-		solAssert(j != -1, "");
-		std::swap(m_values[i], m_values[j]);
-		ok = true;
+	case StackCommand::Opcode::REVERSE:
+		if (_command.i > 17 || _command.j > 15) // REVX
+			return 2 * pushInt + 26;
 		break;
-	}
-	case Stack::Opcode::DROP: {
-		int n = opcode.i();
-		if (n < m_size) {
-			for (int i = n; i < m_size; ++i)
-				m_values[i - n] = m_values[i];
-			m_size -= n;
-			ok = true;
-		}
+	case StackCommand::Opcode::BLKDROP2:
+		if (_command.i > 15 || _command.j > 15) // BLKSWX + DROPX
+			return 2 * pushInt + 26 + StackCommand{StackCommand::Opcode::DROP, _command.i}.gasCost();
 		break;
-	}
-	case Stack::Opcode::BLKDROP2: {
-		int const down = opcode.i();
-		int const top = opcode.j();
-		if (down + top <= m_size) {
-			for (int i = top + down; i < m_size; ++i) {
-				m_values[i - down] = m_values[i];
-			}
-			m_size -= down;
-			ok = true;
-		}
+	default:
 		break;
 	}
-	case Stack::Opcode::POP_S: {
-		if (opcode.i() < m_size) {
-			m_values[opcode.i()] = m_values[0];
-			for (int i = 1; i < m_size; ++i)
-				m_values[i - 1] = m_values[i];
-			--m_size;
-			ok = true;
-		}
-		break;
+	return _command.gasCost();
+}
+
+// Applies the opcode to the stack of value labels (`values[0]` is s0).
+// Returns false if the opcode copies values or it isn't supported.
+bool applyDeep(std::vector<int>& values, StackCommand const& _command) {
+	int const i = _command.i;
+	int const j = _command.j;
+	int const n = values.size();
+	switch (_command.opcode) {
+	case StackCommand::Opcode::DROP:
+		if (i > n)
+			return false;
+		values.erase(values.begin(), values.begin() + i);
+		return true;
+	case StackCommand::Opcode::BLKDROP2:
+		if (i + j > n)
+			return false;
+		values.erase(values.begin() + j, values.begin() + j + i);
+		return true;
+	case StackCommand::Opcode::POP_S:
+		if (i >= n)
+			return false;
+		values.at(i) = values.at(0);
+		values.erase(values.begin());
+		return true;
+	case StackCommand::Opcode::BLKSWAP:
+		if (i + j > n)
+			return false;
+		std::rotate(values.begin(), values.begin() + j, values.begin() + j + i);
+		return true;
+	case StackCommand::Opcode::REVERSE:
+		if (i + j > n)
+			return false;
+		std::reverse(values.begin() + j, values.begin() + j + i);
+		return true;
+	case StackCommand::Opcode::XCHG:
+		if (std::max(i, j) >= n)
+			return false;
+		std::swap(values.at(i), values.at(j));
+		return true;
+	default:
+		return false;
 	}
-	case Stack::Opcode::BLKPUSH: {
-		int const qty = opcode.i();
-		int const index = opcode.j();
-		if (m_size + qty <= StackState::MAX_STACK_DEPTH && index < m_size) {
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + qty] = m_values[i];
-			for (int i = qty - 1, j = index + qty; 0 <= i; --i, --j)
-				m_values[i] = m_values[j];
-			m_size += qty;
-			ok = true;
-		}
-		break;
+}
+
+// The index of the deepest value that is reached by the opcode
+int deepestIndex(StackCommand const& _command) {
+	switch (_command.opcode) {
+	case StackCommand::Opcode::DROP:
+		return _command.i - 1;
+	case StackCommand::Opcode::BLKDROP2:
+	case StackCommand::Opcode::BLKSWAP:
+	case StackCommand::Opcode::REVERSE:
+		return _command.i + _command.j - 1;
+	default:
+		return std::max({_command.i, _command.j, _command.k});
 	}
-	case Stack::Opcode::PUSH_S: {
-		int const index = opcode.i();
-		if (execPUSHS(index)) {
-			ok = true;
+}
+
+// Opcodes that turn the top `window` values of the stack into `target`, which consists of distinct labels.
+// Values are put in place by XCHG S0, Si and values that aren't in `target` are dropped by BLKDROP2 in the end.
+// `keptOnTop` is the second argument of that BLKDROP2.
+std::optional<std::vector<StackCommand>> synthesize(int window, std::vector<int> const& target, int keptOnTop) {
+	int const dropped = window - int(target.size());
+	if (dropped > 15 && keptOnTop > 0)
+		return std::nullopt;
+	// position of each label after XCHGs, the dropped values are placed in [keptOnTop, keptOnTop + dropped)
+	std::vector<int> position(window, -1);
+	for (int k = 0; k < int(target.size()); ++k)
+		position.at(target.at(k)) = k < keptOnTop ? k : k + dropped;
+	auto isPlaced = [&](std::vector<int> const& values, int k) {
+		int const pos = position.at(values.at(k));
+		return pos == -1 ? keptOnTop <= k && k < keptOnTop + dropped : pos == k;
+	};
+
+	std::vector<StackCommand> commands;
+	std::vector<int> values(window);
+	for (int k = 0; k < window; ++k)
+		values.at(k) = k;
+	while (window > 0) {
+		int const pos = position.at(values.at(0));
+		int next = -1;
+		if (pos > 0) {
+			next = pos;
+		} else if (!isPlaced(values, 0)) {
+			// a dropped value is moved to the place of a kept value in the dropped range
+			for (int k = keptOnTop; k < keptOnTop + dropped && next == -1; ++k)
+				if (position.at(values.at(k)) != -1)
+					next = k;
+		} else {
+			for (int k = 1; k < window && next == -1; ++k)
+				if (!isPlaced(values, k))
+					next = k;
 		}
-		break;
+		if (next == -1)
+			break;
+		commands.push_back(StackCommand{StackCommand::Opcode::XCHG, 0, next});
+		std::swap(values.at(0), values.at(next));
 	}
-	case Stack::Opcode::PUSH2_S: {
-		if (std::max(index0, index1) < m_size && m_size + 2 <= StackState::MAX_STACK_DEPTH) {
-			int8_t val0 = m_values[index0];
-			int8_t val1 = m_values[index1];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 2] = m_values[i];
-			m_values[1] = val0;
-			m_values[0] = val1;
-			m_size += 2;
-			ok = true;
-		}
-		break;
+
+	if (dropped > 0) {
+		if (keptOnTop == 0)
+			commands.push_back(StackCommand{StackCommand::Opcode::DROP, dropped});
+		else if (keptOnTop == 1 && dropped == 1)
+			commands.push_back(StackCommand{StackCommand::Opcode::POP_S, 1});
+		else
+			commands.push_back(StackCommand{StackCommand::Opcode::BLKDROP2, dropped, keptOnTop});
 	}
-	case Stack::Opcode::PUSH3_S: {
-		if (std::max(std::max(index0, index1), index2) < m_size && m_size + 3 <= StackState::MAX_STACK_DEPTH) {
-			int8_t val0 = m_values[index0];
-			int8_t val1 = m_values[index1];
-			int8_t val2 = m_values[index2];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 3] = m_values[i];
-			m_values[2] = val0;
-			m_values[1] = val1;
-			m_values[0] = val2;
-			m_size += 3;
-			ok = true;
-		}
-		break;
+	return commands;
+}
+
+int totalGasCost(std::vector<StackCommand> const& _commands) {
+	int gas = 0;
+	for (StackCommand const& command : _commands)
+		gas += deepGasCost(command);
+	return gas;
+}
+
+// The search is stopped if the opcodes are more expensive or too many states are visited,
+// so a long run of stack opcodes doesn't slow down the compilation.
+constexpr int MaxSearchGas = 4 * 26;
+constexpr int MaxSearchNodes = 50'000;
+constexpr size_t SearchCacheSize = 4096;
+// the cheapest stack opcode
+constexpr int MinGasCost = 18;
+
+// Lower bound of gas that is needed to get the target stack. It's admissible for the opcodes of the search:
+//  - each opcode costs at least MinGasCost;
+//  - opcodes that push values don't drop values and vice versa;
+//  - each opcode makes at most 4 new pairs of neighbour values, e.g. XCHG Si, Sj. Pairs are unordered,
+//    because REVERSE only flips the pairs inside the reversed block.
+class SearchHeuristic {
+public:
+	explicit SearchHeuristic(StackState const& _target) : m_target{_target} {
+		count(_target, m_targetValues, m_targetPairs);
 	}
-	case Stack::Opcode::XC2PU: {
-		if (std::max({index0, index1, index2, 1}) < m_size && m_size + 1 <= StackState::MAX_STACK_DEPTH) {
-			std::swap(m_values[1], m_values[index0]);
-			std::swap(m_values[0], m_values[index1]);
-			int8_t value = m_values[index2];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 1] = m_values[i];
-			m_values[0] = value;
-			++m_size;
-			ok = true;
+
+	int operator()(StackState const& _state) const {
+		if (_state == m_target)
+			return 0;
+		Counts values{};
+		Pairs pairs{};
+		count(_state, values, pairs);
+		bool hasSurplus = false; // some values must be dropped
+		bool hasDeficit = false; // some values must be copied
+		for (int v = 0; v < StackState::MAX_SEARCH_DEPTH; ++v) {
+			hasSurplus |= values[v] > m_targetValues[v];
+			hasDeficit |= values[v] < m_targetValues[v];
 		}
-		break;
+		int missingPairs = 0;
+		for (int a = 0; a <= Bottom; ++a)
+			for (int b = a; b <= Bottom; ++b)
+				missingPairs += std::max(0, m_targetPairs[a][b] - pairs[a][b]);
+		int const opcodes = std::max({1, int(hasSurplus) + int(hasDeficit), (missingPairs + 3) / 4});
+		return opcodes * MinGasCost;
 	}
-	case Stack::Opcode::XCPU: {
-		if (std::max(index0, index1) < m_size && m_size + 1 <= StackState::MAX_STACK_DEPTH) {
-			std::swap(m_values[0], m_values[index0]);
-			int8_t value = m_values[index1];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 1] = m_values[i];
-			m_values[0] = value;
-			++m_size;
-			ok = true;
+
+private:
+	// label of the values below the stack, they are never changed
+	constexpr static int Bottom = StackState::MAX_SEARCH_DEPTH;
+	using Counts = std::array<int8_t, StackState::MAX_SEARCH_DEPTH>;
+	using Pairs = std::array<std::array<int8_t, Bottom + 1>, Bottom + 1>;
+
+	static void count(StackState const& _state, Counts& values, Pairs& pairs) {
+		for (int i = 0; i < _state.size(); ++i) {
+			int const a = _state.values()[i];
+			int const b = i + 1 < _state.size() ? _state.values()[i + 1] : Bottom;
+			++values[a];
+			++pairs[std::min(a, b)][std::max(a, b)];
 		}
-		break;
 	}
-	case Stack::Opcode::PUXC: {
-		int const index = opcode.i();
-		int const j = opcode.j();
-		if (execPUXC(index, j)) {
-			ok = true;
+
+private:
+	StackState const m_target;
+	Counts m_targetValues{};
+	Pairs m_targetPairs{};
+};
+
+// XCHG and REVERSE with the same arguments cancel each other
+bool isUndone(StackCommand const& _prev, StackCommand const& _command) {
+	return (_command.opcode == StackCommand::Opcode::XCHG || _command.opcode == StackCommand::Opcode::REVERSE) &&
+		_prev.opcode == _command.opcode && _prev.i == _command.i && _prev.j == _command.j;
+}
+
+struct SearchEdge {
+	StackCommand command;
+	int gas{};
+};
+
+// Opcodes of the search. Compound opcodes other than PUSH2 aren't used, because they break the heuristic.
+std::vector<SearchEdge> const& searchEdges(bool _withCompoundOpcodes) {
+	static std::array<std::vector<SearchEdge>, 2> const edges = []() {
+		std::array<std::vector<SearchEdge>, 2> res;
+		int const depth = StackState::MAX_SEARCH_DEPTH;
+		for (int withCompound = 0; withCompound <= 1; ++withCompound) {
+			std::vector<SearchEdge>& e = res[withCompound];
+			auto add = [&](StackCommand::Opcode opcode, int i, int j = -1) {
+				StackCommand command{opcode, i, j};
+				e.emplace_back(SearchEdge{command, command.gasCost()});
+			};
+			for (int i = 0; i < depth; ++i)
+				for (int j = i + 1; j < depth; ++j)
+					add(StackCommand::Opcode::XCHG, i, j);
+			for (int down = 1; down < depth; ++down)
+				for (int up = 1; down + up <= depth; ++up)
+					add(StackCommand::Opcode::BLKSWAP, down, up);
+			for (int i = 0; i < depth; ++i)
+				for (int n = 2; i + n <= depth; ++n)
+					add(StackCommand::Opcode::REVERSE, n, i);
+			for (int n = 1; n <= depth; ++n)
+				add(StackCommand::Opcode::DROP, n);
+			for (int down = 1; down < depth; ++down)
+				for (int up = 1; down + up <= depth; ++up)
+					add(StackCommand::Opcode::BLKDROP2, down, up);
+			for (int i = 1; i < depth; ++i)
+				add(StackCommand::Opcode::POP_S, i);
+			for (int i = 0; i < depth; ++i)
+				add(StackCommand::Opcode::PUSH_S, i);
+			if (withCompound)
+				for (int i = 0; i < depth; ++i)
+					for (int j = 0; j < depth; ++j)
+						add(StackCommand::Opcode::PUSH2_S, i, j);
+			// cheap opcodes are tried first
+			std::stable_sort(e.begin(), e.end(), [](SearchEdge const& a, SearchEdge const& b) {
+				return a.gas < b.gas;
+			});
 		}
-		break;
-	}
-	case Stack::Opcode::XCHG2: {
-		int const i = opcode.i();
-		int const j = opcode.j();
-		if (std::max(i, j) < m_size) {
-			std::swap(m_values[1], m_values[i]);
-			std::swap(m_values[0], m_values[j]);
-			ok = true;
+		return res;
+	}();
+	return edges.at(_withCompoundOpcodes);
+}
+
+// Iterative deepening A*: depth-first search that is limited by the estimated gas of the opcodes.
+// The limit is raised to the smallest estimate that exceeded it, so the first found opcodes are the cheapest ones.
+// It keeps only the current path in memory.
+class IdaStarSearch {
+public:
+	IdaStarSearch(StackState const& _target, bool _withCompoundOpcodes) :
+		m_target{_target},
+		m_heuristic{_target},
+		m_edges{searchEdges(_withCompoundOpcodes)} { }
+
+	std::optional<std::vector<StackCommand>> run(StackState const& _start) {
+		int threshold = m_heuristic(_start);
+		while (threshold <= MaxSearchGas && m_nodes <= MaxSearchNodes) {
+			int nextThreshold = std::numeric_limits<int>::max();
+			if (dfs(_start, 0, threshold, nextThreshold))
+				return m_path;
+			threshold = nextThreshold;
 		}
-		break;
+		return std::nullopt;
 	}
-	case Stack::Opcode::XCHG3: {
-		int const i = opcode.i();
-		int const j = opcode.j();
-		int const k = opcode.k();
-		if (std::max(std::max(2, i), std::max(j, k)) < m_size) {
-			std::swap(m_values[2], m_values[i]);
-			std::swap(m_values[1], m_values[j]);
-			std::swap(m_values[0], m_values[k]);
-			ok = true;
+
+private:
+	bool dfs(StackState const& _state, int gas, int threshold, int& nextThreshold) {
+		int const estimate = gas + m_heuristic(_state);
+		if (estimate > threshold) {
+			nextThreshold = std::min(nextThreshold, estimate);
+			return false;
 		}
-		break;
-	}
-	case Stack::Opcode::PU2XC: {
-		if (execPUSHS(index0)) {
-			std::swap(m_values[0], m_values[1]);
-			if (execPUXC(index1 + 1, index2 + 1)) {
-				ok = true;
+		if (_state == m_target)
+			return true;
+		for (SearchEdge const& e : m_edges) {
+			// the edges are sorted by gas, the rest ones exceed the threshold too
+			if (gas + e.gas > threshold) {
+				nextThreshold = std::min(nextThreshold, gas + e.gas);
+				break;
 			}
+			if (!m_path.empty() && isUndone(m_path.back(), e.command))
+				continue;
+			StackState next = _state;
+			if (!next.apply(e.command))
+				continue;
+			if (++m_nodes > MaxSearchNodes)
+				return false;
+			m_path.push_back(e.command);
+			if (dfs(next, gas + e.gas, threshold, nextThreshold))
+				return true;
+			m_path.pop_back();
 		}
-		break;
+		return false;
 	}
-	case Stack::Opcode::PUXCPU: {
-		if (execPUXC(index0, index1) && execPUSHS(index2 + 1)) {
-			ok = true;
-		}
-		break;
+
+private:
+	StackState const m_target;
+	SearchHeuristic const m_heuristic;
+	std::vector<SearchEdge> const& m_edges;
+	std::vector<StackCommand> m_path;
+	int m_nodes{};
+};
+
+// Results of the search for recently seen stacks. Peephole optimizer runs several times over the same code,
+// so the same stacks are searched again and again.
+class SearchCache {
+public:
+	using Value = std::optional<std::vector<StackCommand>>;
+
+	Value const* find(int startStackSize, StackState const& _target, bool _withCompoundOpcodes) {
+		auto it = m_index.find(Key{startStackSize, _withCompoundOpcodes, _target});
+		if (it == m_index.end())
+			return nullptr;
+		m_items.splice(m_items.begin(), m_items, it->second);
+		return &it->second->second;
 	}
-	case Stack::Opcode::XCPUXC: {
-		if (std::max(index0, 1) < m_size) {
-			std::swap(m_values[1], m_values[index0]);
-			if (execPUXC(index1, index2)) {
-				ok = true;
-			}
+
+	void insert(int startStackSize, StackState const& _target, bool _withCompoundOpcodes, Value _value) {
+		Key key{startStackSize, _withCompoundOpcodes, _target};
+		m_items.emplace_front(key, std::move(_value));
+		m_index[key] = m_items.begin();
+		if (m_items.size() > SearchCacheSize) {
+			m_index.erase(m_items.back().first);
+			m_items.pop_back();
 		}
-		break;
 	}
-	case Stack::Opcode::PUXC2: {
-		if (std::max(std::max(1, index0), std::max(index1, index2)) < m_size && m_size + 1 <= StackState::MAX_STACK_DEPTH) {
-			int8_t val = m_values[index0];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 1] = m_values[i];
-			m_values[0] = val;
-			++m_size;
-			std::swap(m_values[2], m_values[0]);
-			std::swap(m_values[1], m_values[index1 + 1]);
-			std::swap(m_values[0], m_values[index2 + 1]);
-			ok = true;
+
+private:
+	struct Key {
+		int startStackSize{};
+		bool withCompoundOpcodes{};
+		StackState target;
+		bool operator==(Key const& _other) const {
+			return startStackSize == _other.startStackSize &&
+				withCompoundOpcodes == _other.withCompoundOpcodes &&
+				target == _other.target;
 		}
-		break;
-	}
-	case Stack::Opcode::XCPU2: {
-		if (std::max(index0, std::max(index1, index2)) < m_size && m_size + 2 <= StackState::MAX_STACK_DEPTH) {
-			std::swap(m_values[0], m_values[index0]);
-			int8_t val1 = m_values[index1];
-			int8_t val2 = m_values[index2];
-			for (int i = m_size - 1; 0 <= i; --i)
-				m_values[i + 2] = m_values[i];
-			m_values[1] = val1;
-			m_values[0] = val2;
-			m_size += 2;
-			ok = true;
+	};
+	struct KeyHash {
+		std::size_t operator()(Key const& _key) const {
+			return (_key.target.getHash() * 31 + _key.startStackSize) * 2 + _key.withCompoundOpcodes;
 		}
-		break;
-	}
-	}
+	};
+	std::list<std::pair<Key, Value>> m_items; // the most recently used item is the first one
+	std::unordered_map<Key, std::list<std::pair<Key, Value>>::iterator, KeyHash> m_index;
+};
 
-	if (ok)
-		updHash();
-	return ok;
+} // end anonymous namespace
+
+StackOpcodeSquasher::Table const& StackOpcodeSquasher::table(int startStackSize, bool _withCompoundOpcodes) {
+	using Tables = std::array<std::array<Table, StackState::MAX_STACK_DEPTH + 1>, 2>;
+#ifdef SOL_PRECOMPUTED_SQUASHER_TABLES
+	// the tables are generated at build time, see libsquasher/CMakeLists.txt
+	static Tables const tables = []() {
+		Tables res;
+		for (int withCompound = 0; withCompound <= 1; ++withCompound)
+			for (int size = 0; size <= StackState::MAX_STACK_DEPTH; ++size) {
+				squasher::TableRef const& ref = squasher::tables[withCompound][size];
+				res[withCompound][size] = Table{ref.data, ref.data + ref.size};
+			}
+		return res;
+	}();
+#else
+	static std::array<std::array<std::vector<uint64_t>, StackState::MAX_STACK_DEPTH + 1>, 2> storage;
+	static Tables const tables = []() {
+		Tables res;
+		for (int withCompound = 0; withCompound <= 1; ++withCompound)
+			for (int size = 0; size <= StackState::MAX_STACK_DEPTH; ++size) {
+				std::vector<uint64_t>& t = storage[withCompound][size];
+				t = buildStackDpTable(size, withCompound);
+				res[withCompound][size] = Table{t.data(), t.data() + t.size()};
+			}
+		return res;
+	}();
+#endif
+	return tables.at(_withCompoundOpcodes).at(startStackSize);
 }
 
-void StackState::updHash() {
-	m_hash = m_size;
-	for (int i = 0; i < m_size; ++i) {
-		m_hash = m_hash * 31 + m_values[i];
-	}
+std::optional<uint32_t> StackOpcodeSquasher::find(Table const& _table, uint32_t _state) {
+	uint64_t const* it = std::lower_bound(_table.begin, _table.end, _state, [](uint64_t entry, uint32_t state){
+		return StackDpEntry::state(entry) < state;
+	});
+	if (it == _table.end || StackDpEntry::state(*it) != _state)
+		return std::nullopt;
+	return it - _table.begin;
 }
 
 std::optional<int> StackOpcodeSquasher::gasCost(int startStackSize, StackState const& _state, bool _withCompoundOpcodes) {
-	if (m_dp[_withCompoundOpcodes][StackState::MAX_STACK_DEPTH].empty()) {
-		init();
-	}
-	auto it = m_dp[_withCompoundOpcodes][startStackSize].find(_state);
-	if (it == m_dp[_withCompoundOpcodes][startStackSize].end()) {
+	Table const& t = table(startStackSize, _withCompoundOpcodes);
+	std::optional<uint32_t> index = find(t, _state.pack());
+	if (!index) {
 		return std::nullopt;
 	}
-	return it->second.gasCost;
+	uint32_t const start = StackState{startStackSize}.pack();
+	int gas = 0;
+	for (uint64_t entry = t.begin[*index]; StackDpEntry::state(entry) != start; entry = t.begin[StackDpEntry::prevIndex(entry)])
+		gas += StackDpEntry::command(entry).gasCost();
+	return gas;
 }
 
-std::array<std::array<std::unordered_map<StackState, StackOpcodeSquasher::DpState>, StackState::MAX_STACK_DEPTH + 1>, 2> StackOpcodeSquasher::m_dp {};
-
-void StackOpcodeSquasher::init() {
-	for (int _withCompoundOpcodes = 0; _withCompoundOpcodes <= 1; ++_withCompoundOpcodes) {
-		struct Edge {
-			Pointer<Stack> opcode;
-			int gas{};
-		};
-		std::vector<Edge> edges;
-		auto addEdge = [&](auto const& opcode){
-			edges.emplace_back(Edge{opcode, OpcodeUtils::gasCost(*opcode)});
-		};
-
-		for (int i = 1; i < StackState::MAX_STACK_DEPTH; ++i)
-			addEdge(std::make_shared<Stack>(Stack::Opcode::POP_S, i));
-		for (int down = 1; down <= StackState::MAX_STACK_DEPTH; ++down)
-			for (int up = 1; down + up <= StackState::MAX_STACK_DEPTH; ++up)
-				addEdge(std::make_shared<Stack>(Stack::Opcode::BLKDROP2, down, up));
-		for (int n = 1; n <= StackState::MAX_STACK_DEPTH; ++n)
-			addEdge(std::make_shared<Stack>(Stack::Opcode::DROP, n));
-		for (int down = 1; down < StackState::MAX_STACK_DEPTH; ++down)
-			for (int up = 1; down + up < StackState::MAX_STACK_DEPTH; ++up)
-				addEdge(std::make_shared<Stack>(Stack::Opcode::BLKSWAP, down, up));
-		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-			for (int j = i + 1; j < StackState::MAX_STACK_DEPTH; ++j)
-				addEdge(std::make_shared<Stack>(Stack::Opcode::XCHG, i, j));
-		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-			for (int n = 2; i + n <= StackState::MAX_STACK_DEPTH; ++n)
-				addEdge(std::make_shared<Stack>(Stack::Opcode::REVERSE, n, i));
-		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-			addEdge(std::make_shared<Stack>(Stack::Opcode::PUSH_S, i));
-
-		if (_withCompoundOpcodes)
-		{
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int qty = 2; i + 1 + qty <= StackState::MAX_STACK_DEPTH; ++qty)
-					addEdge(std::make_shared<Stack>(Stack::Opcode::BLKPUSH, qty, i));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
-					addEdge(std::make_shared<Stack>(Stack::Opcode::PUSH2_S, i, j));
-			for (int i = 1; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
-					addEdge(std::make_shared<Stack>(Stack::Opcode::XCPU, i, j));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = -1; j < StackState::MAX_STACK_DEPTH; ++j)
-					addEdge(std::make_shared<Stack>(Stack::Opcode::PUXC, i, j));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
-					addEdge(std::make_shared<Stack>(Stack::Opcode::XCHG2, i, j));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
-					for (int k = 0; k < StackState::MAX_STACK_DEPTH; ++k) {
-						addEdge(std::make_shared<Stack>(Stack::Opcode::XC2PU, i, j, k));
-						addEdge(std::make_shared<Stack>(Stack::Opcode::XCPU2, i, j, k));
-						addEdge(std::make_shared<Stack>(Stack::Opcode::XCHG3, i, j, k));
-					}
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = -1; j + 1 < StackState::MAX_STACK_DEPTH; ++j)
-					for (int k = -1; k + 1 < StackState::MAX_STACK_DEPTH; ++k)
-						addEdge(std::make_shared<Stack>(Stack::Opcode::PUXC2, i, j, k));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
-					for (int k = -1; k + 1 < StackState::MAX_STACK_DEPTH; ++k)
-						addEdge(std::make_shared<Stack>(Stack::Opcode::XCPUXC, i, j, k));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = -1; j + 1 < StackState::MAX_STACK_DEPTH; ++j)
-					for (int k = -1; k + 1 < StackState::MAX_STACK_DEPTH; ++k)
-						addEdge(std::make_shared<Stack>(Stack::Opcode::PUXCPU, i, j, k));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = -1; j + 1 < StackState::MAX_STACK_DEPTH; ++j)
-					for (int k = -2; k + 2 < StackState::MAX_STACK_DEPTH; ++k)
-						addEdge(std::make_shared<Stack>(Stack::Opcode::PU2XC, i, j, k));
-			for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
-				for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
-					for (int k = 0; k < StackState::MAX_STACK_DEPTH; ++k)
-						addEdge(std::make_shared<Stack>(Stack::Opcode::PUSH3_S, i, j, k));
-		}
+std::vector<Pointer<TvmAstNode>> StackOpcodeSquasher::recover(int startStackSize, StackState state, bool _withCompoundOpcodes) {
+	std::vector<Pointer<TvmAstNode>> res;
+	Table const& t = table(startStackSize, _withCompoundOpcodes);
+	std::optional<uint32_t> index = find(t, state.pack());
+	solAssert(index.has_value(), "");
+	uint32_t const start = StackState{startStackSize}.pack();
+	for (uint64_t entry = t.begin[*index]; StackDpEntry::state(entry) != start; entry = t.begin[StackDpEntry::prevIndex(entry)]) {
+		StackCommand const command = StackDpEntry::command(entry);
+		res.push_back(createNode<Stack>(command.opcode, command.i, command.j, command.k));
+	}
+	std::reverse(res.begin(), res.end());
+	return res;
+}
 
-		std::stable_sort(edges.begin(), edges.end(), [](Edge const &a, Edge const &b){
-			return a.gas < b.gas;
-		});
-
-		int const MAX_DEPTH = _withCompoundOpcodes ? 2 : MAX_NEW_OPCODES;
-		using namespace std::chrono;
-		//auto begin = high_resolution_clock::now();
-		for (int stackSize = 0; stackSize <= StackState::MAX_STACK_DEPTH; ++stackSize) {
-			struct QData {
-				StackState state;
-				int gas{};
-				int8_t opcodeQty{};
-			};
-			std::unordered_map<StackState, DpState> dp;
-			auto comp = [](QData const& x, QData const& y){
-				if (x.gas != y.gas)
-					return x.gas < y.gas;
-				return x.state.getHash() < y.state.getHash();
-			};
-			auto q = std::set<QData, decltype(comp)>(comp);
-			{
-				StackState state{stackSize};
-				dp.emplace(state, DpState{0, StackState{stackSize}, nullptr});
-				q.emplace(QData{state, 0, 0});
-			}
-			while (!q.empty()) {
-				auto front = q.begin();
-				StackState const state = front->state;
-				int8_t const nextOpcodeQty = front->opcodeQty + 1;
-				int const gas = front->gas;
-				q.erase(front);
-				for (Edge const &e: edges) {
-					StackState nextState = state;
-					if (nextState.apply(*e.opcode)) {
-						auto it = dp.find(nextState);
-						int nextGasCost = gas + e.gas;
-						if (it == dp.end()) {
-							dp.emplace(nextState, DpState{nextGasCost, state, e.opcode});
-							if (nextOpcodeQty < MAX_DEPTH)
-								q.emplace(QData{nextState, nextGasCost, nextOpcodeQty});
-						} else if (it->second.gasCost > nextGasCost) {
-							q.erase(QData{nextState, it->second.gasCost});
-							dp.erase(it);
-							dp.emplace(nextState, DpState{nextGasCost, state, e.opcode});
-							if (nextOpcodeQty < MAX_DEPTH) {
-								q.emplace(QData{nextState, nextGasCost, nextOpcodeQty});
-							}
-						}
-					}
-				}
+std::optional<std::pair<int, std::vector<Pointer<TvmAstNode>>>> StackOpcodeSquasher::squashDeep(
+	std::vector<StackCommand> const& _commands
+) {
+	std::vector<int> values(DeepStackSize);
+	for (int k = 0; k < DeepStackSize; ++k)
+		values.at(k) = k;
+
+	std::optional<std::pair<int, std::vector<StackCommand>>> best;
+	int bestProfit = 0;
+	int originalGas = 0;
+	int depth = 0; // the number of values that are reached by the opcodes
+	for (int qty = 1; qty <= int(_commands.size()); ++qty) {
+		StackCommand const& command = _commands.at(qty - 1);
+		int const sizeBefore = values.size();
+		if (!applyDeep(values, command))
+			break;
+		originalGas += deepGasCost(command);
+		depth = std::max(depth, DeepStackSize - sizeBefore + deepestIndex(command) + 1);
+		if (qty == 1 || depth <= StackState::MAX_STACK_DEPTH)
+			continue; // the tables of the squasher are used for small depths
+
+		// the top `window` values are changed, the rest ones are only shifted by `dropped`
+		int const dropped = DeepStackSize - int(values.size());
+		int size = values.size();
+		while (size > 0 && values.at(size - 1) == size - 1 + dropped)
+			--size;
+		int const window = size + dropped;
+		if (window > 256)
+			continue;
+
+		std::vector<int> const target(values.begin(), values.begin() + size);
+		for (int keptOnTop = 0; keptOnTop <= std::min(size, 15); ++keptOnTop) {
+			if (dropped == 0 && keptOnTop > 0)
+				break;
+			std::optional<std::vector<StackCommand>> commands = synthesize(window, target, keptOnTop);
+			if (!commands)
+				continue;
+			int const profit = originalGas - totalGasCost(*commands);
+			if (profit > bestProfit) {
+				std::vector<int> check(DeepStackSize);
+				for (int k = 0; k < DeepStackSize; ++k)
+					check.at(k) = k;
+				for (StackCommand const& c : *commands)
+					solAssert(applyDeep(check, c), "");
+				solAssert(check == values, "");
+				bestProfit = profit;
+				best = {qty, *commands};
 			}
-			m_dp[_withCompoundOpcodes][stackSize] = dp;
 		}
-		//auto end = high_resolution_clock::now();
-		//auto duration = duration_cast<std::chrono::milliseconds>(end - begin);
-		//std::cerr << "Time difference = " << duration.count() << "[ms]" << std::endl;
-		//double size = m_dp.at(_withCompoundOpcodes).at(StackState::MAX_STACK_DEPTH).size();
-		//std::cerr << "dp.size() = " << size << ": " << (size * 20) / (1024 * 1024) << " MB" << std::endl;
 	}
-}
 
-std::vector<Pointer<TvmAstNode>> StackOpcodeSquasher::recover(int startStackSize, StackState state, bool _withCompoundOpcodes) {
+	if (!best)
+		return std::nullopt;
+
 	std::vector<Pointer<TvmAstNode>> res;
-	StackState start{startStackSize};
-	auto const& prev = m_dp.at(_withCompoundOpcodes).at(startStackSize);
-	while (state != start) {
-		auto const& it = prev.at(state);
-		state = it.prevState;
-		res.push_back(it.opcode);
+	for (StackCommand const& command : best->second)
+		res.push_back(createNode<Stack>(command.opcode, command.i, command.j, command.k));
+	return std::make_pair(best->first, res);
+}
+
+std::optional<std::vector<StackCommand>> StackOpcodeSquasher::search(
+	int startStackSize,
+	StackState const& _target,
+	bool _withCompoundOpcodes
+) {
+	solAssert(startStackSize <= StackState::MAX_SEARCH_DEPTH, "");
+	// functions are optimized in several threads (see --jobs), so each thread has its own cache
+	thread_local SearchCache cache;
+	if (SearchCache::Value const* value = cache.find(startStackSize, _target, _withCompoundOpcodes))
+		return *value;
+	IdaStarSearch ida{_target, _withCompoundOpcodes};
+	SearchCache::Value res = ida.run(StackState{startStackSize, StackState::MAX_SEARCH_DEPTH});
+	if (res) {
+		// the found opcodes must have the same stack effect as the original ones
+		StackState check{startStackSize, StackState::MAX_SEARCH_DEPTH};
+		for (StackCommand const& command : *res)
+			solAssert(check.apply(command), "");
+		solAssert(check == _target, "");
 	}
-	std::reverse(res.begin(), res.end());
+	cache.insert(startStackSize, _target, _withCompoundOpcodes, res);
 	return res;
 }
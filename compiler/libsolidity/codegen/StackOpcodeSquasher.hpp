@@ -13,70 +13,29 @@
 
 #pragma once
 
+#include <libsolidity/codegen/StackState.hpp>
 #include <libsolidity/codegen/TvmAst.hpp>
-#include <map>
-#include <unordered_map>
 
 namespace solidity::frontend {
 
-constexpr static int MAX_NEW_OPCODES = 3;
-
-class StackState {
-public:
-	constexpr static int MAX_STACK_DEPTH = 8;
-
-	explicit StackState(int _size);
-	explicit StackState(int8_t _size, std::array<int8_t, MAX_STACK_DEPTH> _values) : m_size{_size}, m_values{_values} {
-		updHash();
-	}
-	bool apply(Stack const& opcode);
-	bool operator==(const StackState &other) const {
-		if (m_size != other.m_size)
-			return false;
-		for (int i = 0; i < m_size; ++i)
-			if (m_values[i] != other.m_values[i])
-				return false;
-		return true;
-	}
-	bool operator!=(const StackState &other) const {
-		return !operator==(other);
-	}
-	std::size_t getHash() const { return m_hash; }
-	int8_t size() const { return m_size; }
-	std::array<int8_t, MAX_STACK_DEPTH> const& values() const { return m_values; }
-private:
-	void updHash();
-private:
-	std::size_t m_hash{};
-	int8_t m_size;
-	std::array<int8_t, MAX_STACK_DEPTH> m_values{};
-};
-
 class StackOpcodeSquasher {
 public:
 	static std::optional<int> gasCost(int startStackSize, StackState const& _state, bool _withCompoundOpcodes);
-private:
-	static void init();
-public:
 	static std::vector<Pointer<TvmAstNode>> recover(int startStackSize, StackState state, bool _withCompoundOpcodes);
-	struct DpState {
-		int gasCost;
-		StackState prevState;
-		Pointer<Stack> opcode;
-	};
+	// The tables cover only MAX_STACK_DEPTH values on the top of the stack. Functions with many local variables
+	// permute and drop values deeper in the stack. Finds a prefix of `_commands` that only permutes and drops values
+	// and can be replaced with cheaper opcodes. Returns the length of the prefix and the new opcodes.
+	static std::optional<std::pair<int, std::vector<Pointer<TvmAstNode>>>> squashDeep(std::vector<StackCommand> const& _commands);
+	// Finds the cheapest opcodes that turn the stack of size `startStackSize` into `_target` by IDA* search.
+	// It's used for stacks that are deeper than the tables, up to MAX_SEARCH_DEPTH values.
+	// Returns nullopt if the opcodes aren't found within the limits of the search.
+	static std::optional<std::vector<StackCommand>> search(int startStackSize, StackState const& _target, bool _withCompoundOpcodes);
 private:
-	static std::array<std::array<std::unordered_map<StackState, DpState>, StackState::MAX_STACK_DEPTH + 1>, 2> m_dp;
+	struct Table {
+		uint64_t const* begin{};
+		uint64_t const* end{};
+	};
+	static Table const& table(int startStackSize, bool _withCompoundOpcodes);
+	static std::optional<uint32_t> find(Table const& _table, uint32_t _state);
 };
 } // end solidity::frontend
-
-namespace std {
-
-template <>
-struct hash<solidity::frontend::StackState> {
-std::size_t operator()(const solidity::frontend::StackState& k) const {
-	return k.getHash();
-}
-};
-
-}
-
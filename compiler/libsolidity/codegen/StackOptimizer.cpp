@@ -14,6 +14,8 @@
  * Stack optimizer
  */
 
+#include <limits>
+
 #include <boost/format.hpp>
 
 #include <libsolidity/codegen/TvmAst.hpp>
@@ -139,8 +141,20 @@ bool StackOptimizer::visit(Stack &_node) {
 bool StackOptimizer::visit(CodeBlock &_node) {
 	std::vector<Pointer<TvmAstNode>> instructions = _node.instructions();
 
+	// A block that is visited twice (e.g. shared inline function body) can be changed from
+	// another place, so simulations of blocks containing it can't be reused.
+	if (!m_visitedBlocks.insert(&_node).second)
+		m_sharedBlocks = true;
+	SimulationCache cache;
+	if (auto it = m_simulations.find(&_node); it != m_simulations.end()) {
+		BlockSimulations& saved = it->second;
+		if (!m_sharedBlocks && saved.block.lock().get() == &_node && saved.instructions == instructions)
+			cache = std::move(saved.simulations);
+		m_simulations.erase(it);
+	}
+
 	for (size_t i = 0; i < instructions.size(); ) {
-		if (successfullyUpdate(i, instructions)) {
+		if (successfullyUpdate(i, instructions, cache)) {
 			m_didSome = true;
 
 			//Printer p{std::cout};
@@ -157,11 +171,18 @@ bool StackOptimizer::visit(CodeBlock &_node) {
 			// do nothing
 		} else {
 			Pointer<TvmAstNode> const& op = instructions.at(i);
+			int const updates = m_updates;
 			op->accept(*this);
+			if (updates != m_updates) {
+				// nested code of the op is changed
+				forgetSimulations(cache, instructions.size() - i - 1);
+			}
 			++i;
 		}
 	}
 	_node.upd(instructions);
+	if (!m_sharedBlocks)
+		m_simulations[&_node] = BlockSimulations{_node.weak_from_this(), instructions, std::move(cache)};
 	return false;
 }
 
@@ -274,14 +295,21 @@ bool StackOptimizer::visit(Function &f) {
 	case Function::FunctionType::Fragment:
 	case Function::FunctionType::OnCodeUpgrade:
 	case Function::FunctionType::OnTickTock: {
+		m_simulations.clear();
+		m_sharedBlocks = false;
 		for (int iter = 0; iter < TvmConst::IterStackOptQty; ++iter) {
 			m_didSome = false;
 			m_stackSize.clear();
+			m_visitedBlocks.clear();
 			initStack(f.take());
 			f.block()->accept(*this);
+			if (m_sharedBlocks)
+				m_simulations.clear();
 			if (!m_didSome)
 				break;
+			m_didSomeInTotal = true;
 		}
+		m_simulations.clear();
 		break;
 	}
 
@@ -312,7 +340,36 @@ void StackOptimizer::endVisitNode(TvmAstNode const&) {
 	solUnimplemented("StackOptimizer::endVisitNode");
 }
 
-bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNode>>& instructions) {
+StackOptimizer::SimulationResult const& StackOptimizer::simulate(
+	SimulationCache& cache,
+	std::vector<Pointer<TvmAstNode>> const& instructions,
+	size_t begin,
+	int stackSize,
+	int segment,
+	bool stopSimulationIfSet,
+	bool stopSimulationIfMoved
+) {
+	SimulationKey key{instructions.size() - begin, stackSize, segment, stopSimulationIfSet, stopSimulationIfMoved};
+	auto it = cache.find(key);
+	if (it == cache.end()) {
+		Simulator sim{instructions.begin() + begin, instructions.end(), stackSize, segment,
+			stopSimulationIfSet, stopSimulationIfMoved};
+		it = cache.emplace(key, SimulationResult{sim.success(), sim.wasSet(), sim.wasMoved(), sim.wasCall(),
+			sim.setGlobIndexes()}).first;
+	}
+	return it->second;
+}
+
+void StackOptimizer::forgetSimulations(SimulationCache& cache, size_t maxSuffixLength) {
+	int const minInt = std::numeric_limits<int>::min();
+	cache.erase(cache.lower_bound(SimulationKey{maxSuffixLength + 1, minInt, minInt, false, false}), cache.end());
+}
+
+bool StackOptimizer::successfullyUpdate(
+	int index,
+	std::vector<Pointer<TvmAstNode>>& instructions,
+	SimulationCache& cache
+) {
 	Pointer<TvmAstNode> const& op = instructions.at(index);
 	if (to<Loc>(op.get()))
 		return false;
@@ -334,18 +391,19 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 	if (auto gen = to<Gen>(op.get());
 		gen && gen->isPure() && std::make_pair(gen->take(), gen->ret()) == std::make_pair(0, 1)
 	) {
-		Simulator sim{instructions.begin() + index + 1, instructions.end(), 1, 1, false, true};
+		SimulationResult const& res = simulate(cache, instructions, index + 1, 1, 1, false, true);
 		bool good = true;
 		{
 			auto glob = to<Glob>(op.get());
 			if (glob) {
 				good = glob->opcode() == Glob::Opcode::GetOrGetVar &&
-						sim.setGlobIndexes().count(glob->index()) == 0 &&
-						!sim.wasCall();
+						res.setGlobIndexes.count(glob->index()) == 0 &&
+						!res.wasCall;
 			}
 		}
-		if (good && sim.wasMoved() && !sim.wasSet()) {
+		if (good && res.wasMoved && !res.wasSet) {
 			ok = true;
+			Simulator sim{instructions.begin() + index + 1, instructions.end(), 1, 1, false, true};
 			commands.insert(commands.end(), sim.commands().begin(), sim.commands().end()); // TODO!!!!!
 			commands.emplace_back(op);
 			for (auto iter = sim.getIter();
@@ -364,9 +422,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 	// ...
 	// BLKSWAP i-1, 1
 	if (!ok && isPUSH(op) && isPUSH(op).value() == 0) {
-		Simulator sim{instructions.begin() + index + 1, instructions.end(), 2, 1, true};
-		if (sim.wasSet()) {
+		SimulationResult const& res = simulate(cache, instructions, index + 1, 2, 1, true);
+		if (res.wasSet) {
 			ok = true;
+			Simulator sim{instructions.begin() + index + 1, instructions.end(), 2, 1, true};
 			commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 			auto iter = sim.getIter();
 			auto popSi = isPOP(*iter);
@@ -389,9 +448,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 	if (!ok && isBLKSWAP(op)) {
 		auto [bottom, top] = isBLKSWAP(op).value();
 		if (top == 1) {
-			Simulator sim{instructions.begin() + index + 1, instructions.end(), bottom + 1, 1, true};
-			if (sim.wasSet()) {
+			SimulationResult const& res = simulate(cache, instructions, index + 1, bottom + 1, 1, true);
+			if (res.wasSet) {
 				ok = true;
+				Simulator sim{instructions.begin() + index + 1, instructions.end(), bottom + 1, 1, true};
 				commands.emplace_back(makeDROP());
 				commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 				auto iter = sim.getIter();
@@ -413,9 +473,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 	// ...
 	// BLKSWAP 1, i-1
 	if (!ok && isPureGen01(*op)) {
-		Simulator sim{instructions.begin() + index + 1, instructions.end(), 1, 1, true};
-		if (sim.wasSet()) {
+		SimulationResult const& res = simulate(cache, instructions, index + 1, 1, 1, true);
+		if (res.wasSet) {
 			ok = true;
+			Simulator sim{instructions.begin() + index + 1, instructions.end(), 1, 1, true};
 			commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 			auto iter = sim.getIter();
 			auto popSi = isPOP(*iter);
@@ -440,9 +501,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 		if (index2 != instructions.size()) {
 			auto pushS = isPUSH(instructions.at(index2));
 			if (pushS && pushS.value() == n) {
-				Simulator sim{instructions.begin() + index2 + 1, instructions.end(), n + 2, 1, true};
-				if (sim.wasSet()) {
+				SimulationResult const& res = simulate(cache, instructions, index2 + 1, n + 2, 1, true);
+				if (res.wasSet) {
 					ok = true;
+					Simulator sim{instructions.begin() + index2 + 1, instructions.end(), n + 2, 1, true};
 					commands.insert(commands.end(), instructions.begin() + index + 1, instructions.begin() + index2);
 					commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 					auto iter = sim.getIter();
@@ -469,8 +531,8 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 		if (index2 != instructions.size()) {
 			auto pushS = isPUSH(instructions.at(index2));
 			if (pushS && *pushS + 1 == *isPOP(op)) {
-				Simulator sim{instructions.begin() + index2 + 1, instructions.end(), *isPOP(op) + 1, 1, true};
-				if (sim.wasSet()) {
+				SimulationResult const& res = simulate(cache, instructions, index2 + 1, *isPOP(op) + 1, 1, true);
+				if (res.wasSet) {
 					ok = true;
 					// we take original commands because we don't remove value from stack
 					commands.insert(commands.end(), instructions.begin() + index + 1, instructions.begin() + index2);
@@ -485,8 +547,8 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 	// DROP
 	if (!ok && isPOP(op)) {
 		int startStackSize = isPOP(op).value();
-		Simulator sim{instructions.begin() + index + 1, instructions.end(), startStackSize, 1};
-		if (sim.wasSet() || sim.success()) {
+		SimulationResult const& res = simulate(cache, instructions, index + 1, startStackSize, 1);
+		if (res.wasSet || res.success) {
 			ok = true;
 			commands.emplace_back(makeDROP());
 			commands.insert(commands.end(), instructions.begin() + index + 1, instructions.end());
@@ -510,17 +572,18 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 
 		// try to just ignore this opcode
 		{
-			Simulator sim{instructions.begin() + index + 1, instructions.end(), len, len};
-			if (sim.success()) {
+			SimulationResult const& res = simulate(cache, instructions, index + 1, len, len);
+			if (res.success) {
 				ok = true;
 				commands.insert(commands.end(), instructions.begin() + index + 1, instructions.end());
 			}
 		}
 		if (!ok && isSWAP(op)) {
 			int startStackSize = 2;
-			Simulator sim{instructions.begin() + index + 1, instructions.end(), startStackSize, 1};
-			if (sim.success()) {
+			SimulationResult const& res = simulate(cache, instructions, index + 1, startStackSize, 1);
+			if (res.success) {
 				ok = true;
+				Simulator sim{instructions.begin() + index + 1, instructions.end(), startStackSize, 1};
 				commands.emplace_back(makeDROP());
 				commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 			}
@@ -537,9 +600,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 		// PUSH S0
 		// ...
 		if (Si <= scopeSize() && Si > 0) {
-			Simulator sim{instructions.begin() + index + 1, instructions.end(), Si + 1, Si};
-			if (sim.success()) {
+			SimulationResult const& res = simulate(cache, instructions, index + 1, Si + 1, Si);
+			if (res.success) {
 				ok = true;
+				Simulator sim{instructions.begin() + index + 1, instructions.end(), Si + 1, Si};
 				commands.emplace_back(makeDROP(Si));
 				commands.emplace_back(makePUSH(0));
 				commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
@@ -553,9 +617,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 		// ...
 		if (!ok) {
 			int startStackSize = Si + 2;
-			Simulator sim{instructions.begin() + index + 1, instructions.end(), startStackSize, 1};
-			if (sim.success()) {
+			SimulationResult const& res = simulate(cache, instructions, index + 1, startStackSize, 1);
+			if (res.success) {
 				ok = true;
+				Simulator sim{instructions.begin() + index + 1, instructions.end(), startStackSize, 1};
 				if (Si >= 1)
 					commands.emplace_back(makeBLKSWAP(1, Si));
 				commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
@@ -569,9 +634,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 	// ...
 	if (!ok && isPureGen01(*op)) {
 		int startStackSize = 1;
-		Simulator sim{instructions.begin() + index + 1, instructions.end(), startStackSize, 1};
-		if (sim.success()) {
+		SimulationResult const& res = simulate(cache, instructions, index + 1, startStackSize, 1);
+		if (res.success) {
 			ok = true;
+			Simulator sim{instructions.begin() + index + 1, instructions.end(), startStackSize, 1};
 			commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 		}
 	}
@@ -589,9 +655,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 		}
 		if (scopeSize() >= 1 && !isPrevFlag) {
 			auto beg = instructions.begin() + index;
-			Simulator sim{beg, instructions.end(), 1, 1};
-			if (sim.success()) {
+			SimulationResult const& res = simulate(cache, instructions, index, 1, 1);
+			if (res.success) {
 				ok = true;
+				Simulator sim{beg, instructions.end(), 1, 1};
 				commands.emplace_back(makeDROP());
 				commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 			}
@@ -627,9 +694,10 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 		if (beg != instructions.end() &&
 			scopeSize() >= n + 1
 		) {
-			Simulator sim{beg, instructions.end(), 1, 1};
-			if (sim.success()) {
+			SimulationResult const& res = simulate(cache, instructions, index + 1, 1, 1);
+			if (res.success) {
 				ok = true;
+				Simulator sim{beg, instructions.end(), 1, 1};
 				commands.emplace_back(makeDROP(n + 1));
 				commands.insert(commands.end(), sim.commands().begin(), sim.commands().end());
 			}
@@ -641,6 +709,15 @@ bool StackOptimizer::successfullyUpdate(int index, std::vector<Pointer<TvmAstNod
 		return false;
 	}
 
+	// simulations over the unchanged tail of instructions remain valid
+	size_t unchanged = 0;
+	while (unchanged < commands.size() && unchanged < instructions.size() - index &&
+		commands.at(commands.size() - 1 - unchanged) == instructions.at(instructions.size() - 1 - unchanged)
+	)
+		++unchanged;
+	forgetSimulations(cache, unchanged);
+	++m_updates;
+
 	instructions.erase(instructions.begin() + index, instructions.end());
 	instructions.insert(instructions.end(), commands.begin(), commands.end());
 	return true;
@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include <map>
+#include <set>
+#include <tuple>
+
 #include <libsolidity/codegen/TvmAstVisitor.hpp>
 
 namespace solidity::frontend {
@@ -43,11 +47,39 @@ public:
 	bool visit(Function &_node) override;
 	bool visit(Contract &_node) override;
 	void endVisit(CodeBlock &_node) override;
+	bool didSome() const { return m_didSomeInTotal; }
 protected:
 	bool visitNode(TvmAstNode const&) override;
 	void endVisitNode(TvmAstNode const&) override;
 private:
-	bool successfullyUpdate(int index, std::vector<Pointer<TvmAstNode>>& instructions);
+	// Outcome of a Simulator run over a suffix of a code block
+	struct SimulationResult {
+		bool success{};
+		bool wasSet{};
+		bool wasMoved{};
+		bool wasCall{};
+		std::set<int> setGlobIndexes;
+	};
+	// (suffix length, start stack size, segment, stopSimulationIfSet, stopSimulationIfMoved)
+	using SimulationKey = std::tuple<size_t, int, int, bool, bool>;
+	using SimulationCache = std::map<SimulationKey, SimulationResult>;
+	struct BlockSimulations {
+		std::weak_ptr<TvmAstNode> block;
+		std::vector<Pointer<TvmAstNode>> instructions;
+		SimulationCache simulations;
+	};
+
+	bool successfullyUpdate(int index, std::vector<Pointer<TvmAstNode>>& instructions, SimulationCache& cache);
+	SimulationResult const& simulate(
+		SimulationCache& cache,
+		std::vector<Pointer<TvmAstNode>> const& instructions,
+		size_t begin,
+		int stackSize,
+		int segment,
+		bool stopSimulationIfSet = false,
+		bool stopSimulationIfMoved = false
+	);
+	static void forgetSimulations(SimulationCache& cache, size_t maxSuffixLength);
 	void initStack(int size);
 	void delta(int delta);
 	int size();
@@ -56,7 +88,13 @@ private:
 	void endScope();
 private:
 	bool m_didSome{};
+	bool m_didSomeInTotal{};
 	std::vector<int> m_stackSize;
+	// Simulations of code blocks are reused between iterations over the same function
+	std::map<CodeBlock const*, BlockSimulations> m_simulations;
+	std::set<CodeBlock const*> m_visitedBlocks;
+	bool m_sharedBlocks{};
+	int m_updates{};
 };
 } // end solidity::frontend
 
@@ -0,0 +1,580 @@
+/*
+ * Copyright (C) 2021-2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Stack state model used by the stack opcode squasher.
+ */
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+#include <liblangutil/Exceptions.h>
+
+#include <libsolidity/codegen/StackState.hpp>
+
+using namespace solidity::frontend;
+using namespace std;
+
+StackState::StackState(int _size, int _maxSize) {
+	solAssert(_size <= _maxSize && _maxSize <= MAX_SEARCH_DEPTH, "");
+	m_size = _size;
+	m_maxSize = _maxSize;
+	for (int8_t i = 0; i < m_size; ++i) {
+		m_values[i] = i;
+	}
+	updHash();
+}
+
+bool StackState::apply(StackCommand const& command) {
+	auto execPUSHS = [this](int index) -> bool {
+		if (index < m_size && m_size + 1 <= m_maxSize) {
+			int8_t val = m_values[index];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 1] = m_values[i];
+			m_values[0] = val;
+			++m_size;
+			return true;
+		}
+		return false;
+	};
+	auto execPUXC = [this](int index, int j) -> bool {
+		if (j + 1 < m_size && index < m_size && m_size + 1 <= m_maxSize) {
+			int8_t val = m_values[index];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 1] = m_values[i];
+			m_values[0] = val;
+			std::swap(m_values[0], m_values[1]);
+			std::swap(m_values[0], m_values[j + 1]);
+			++m_size;
+			return true;
+		}
+		return false;
+	};
+
+	bool ok = false;
+	int const index0 = command.i;
+	int const index1 = command.j;
+	int const index2 = command.k;
+	switch (command.opcode) {
+	case StackCommand::Opcode::BLKSWAP: {
+		int down = command.i;
+		int up = command.j;
+		if (down + up > m_size) {
+			break;
+		}
+		ok = true;
+		std::reverse(m_values.begin(), m_values.begin() + up);
+		std::reverse(m_values.begin() + up, m_values.begin() + up + down);
+		std::reverse(m_values.begin(), m_values.begin() + up + down);
+		break;
+	}
+	case StackCommand::Opcode::REVERSE: {
+		int qty = command.i;
+		int index = command.j;
+		if (index + qty <= m_size) {
+			// [index..index+qty-1]
+			std::reverse(m_values.begin() + index, m_values.begin() + index + qty);
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::XCHG: {
+		int i = command.i;
+		int j = command.j;
+		if (i >= m_size || j >= m_size) {
+			break;
+		}
+		solAssert(i != -1, "");
+		solAssert(j != -1, "");
+		std::swap(m_values[i], m_values[j]);
+		ok = true;
+		break;
+	}
+	case StackCommand::Opcode::DROP: {
+		int n = command.i;
+		if (n < m_size) {
+			for (int i = n; i < m_size; ++i)
+				m_values[i - n] = m_values[i];
+			m_size -= n;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::BLKDROP2: {
+		int const down = command.i;
+		int const top = command.j;
+		if (down + top <= m_size) {
+			for (int i = top + down; i < m_size; ++i) {
+				m_values[i - down] = m_values[i];
+			}
+			m_size -= down;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::POP_S: {
+		if (command.i < m_size) {
+			m_values[command.i] = m_values[0];
+			for (int i = 1; i < m_size; ++i)
+				m_values[i - 1] = m_values[i];
+			--m_size;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::BLKPUSH: {
+		int const qty = command.i;
+		int const index = command.j;
+		if (m_size + qty <= m_maxSize && index < m_size) {
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + qty] = m_values[i];
+			for (int i = qty - 1, j = index + qty; 0 <= i; --i, --j)
+				m_values[i] = m_values[j];
+			m_size += qty;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::PUSH_S: {
+		int const index = command.i;
+		if (execPUSHS(index)) {
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::PUSH2_S: {
+		if (std::max(index0, index1) < m_size && m_size + 2 <= m_maxSize) {
+			int8_t val0 = m_values[index0];
+			int8_t val1 = m_values[index1];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 2] = m_values[i];
+			m_values[1] = val0;
+			m_values[0] = val1;
+			m_size += 2;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::PUSH3_S: {
+		if (std::max(std::max(index0, index1), index2) < m_size && m_size + 3 <= m_maxSize) {
+			int8_t val0 = m_values[index0];
+			int8_t val1 = m_values[index1];
+			int8_t val2 = m_values[index2];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 3] = m_values[i];
+			m_values[2] = val0;
+			m_values[1] = val1;
+			m_values[0] = val2;
+			m_size += 3;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::XC2PU: {
+		if (std::max({index0, index1, index2, 1}) < m_size && m_size + 1 <= m_maxSize) {
+			std::swap(m_values[1], m_values[index0]);
+			std::swap(m_values[0], m_values[index1]);
+			int8_t value = m_values[index2];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 1] = m_values[i];
+			m_values[0] = value;
+			++m_size;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::XCPU: {
+		if (std::max(index0, index1) < m_size && m_size + 1 <= m_maxSize) {
+			std::swap(m_values[0], m_values[index0]);
+			int8_t value = m_values[index1];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 1] = m_values[i];
+			m_values[0] = value;
+			++m_size;
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::PUXC: {
+		int const index = command.i;
+		int const j = command.j;
+		if (execPUXC(index, j)) {
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::XCHG2: {
+		int const i = command.i;
+		int const j = command.j;
+		if (std::max(i, j) < m_size) {
+			std::swap(m_values[1], m_values[i]);
+			std::swap(m_values[0], m_values[j]);
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::XCHG3: {
+		int const i = command.i;
+		int const j = command.j;
+		int const k = command.k;
+		if (std::max(std::max(2, i), std::max(j, k)) < m_size) {
+			std::swap(m_values[2], m_values[i]);
+			std::swap(m_values[1], m_values[j]);
+			std::swap(m_values[0], m_values[k]);
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::PU2XC: {
+		if (execPUSHS(index0)) {
+			std::swap(m_values[0], m_values[1]);
+			if (execPUXC(index1 + 1, index2 + 1)) {
+				ok = true;
+			}
+		}
+		break;
+	}
+	case StackCommand::Opcode::PUXCPU: {
+		if (execPUXC(index0, index1) && execPUSHS(index2 + 1)) {
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::XCPUXC: {
+		if (std::max(index0, 1) < m_size) {
+			std::swap(m_values[1], m_values[index0]);
+			if (execPUXC(index1, index2)) {
+				ok = true;
+			}
+		}
+		break;
+	}
+	case StackCommand::Opcode::PUXC2: {
+		if (std::max(std::max(1, index0), std::max(index1, index2)) < m_size && m_size + 1 <= m_maxSize) {
+			int8_t val = m_values[index0];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 1] = m_values[i];
+			m_values[0] = val;
+			++m_size;
+			std::swap(m_values[2], m_values[0]);
+			std::swap(m_values[1], m_values[index1 + 1]);
+			std::swap(m_values[0], m_values[index2 + 1]);
+			ok = true;
+		}
+		break;
+	}
+	case StackCommand::Opcode::XCPU2: {
+		if (std::max(index0, std::max(index1, index2)) < m_size && m_size + 2 <= m_maxSize) {
+			std::swap(m_values[0], m_values[index0]);
+			int8_t val1 = m_values[index1];
+			int8_t val2 = m_values[index2];
+			for (int i = m_size - 1; 0 <= i; --i)
+				m_values[i + 2] = m_values[i];
+			m_values[1] = val1;
+			m_values[0] = val2;
+			m_size += 2;
+			ok = true;
+		}
+		break;
+	}
+	}
+
+	if (ok)
+		updHash();
+	return ok;
+}
+
+void StackState::updHash() {
+	m_hash = m_size;
+	for (int i = 0; i < m_size; ++i) {
+		m_hash = m_hash * 31 + m_values[i];
+	}
+}
+
+uint32_t StackState::pack() const {
+	uint32_t key = m_size;
+	for (int i = 0; i < m_size; ++i) {
+		solAssert(0 <= m_values[i] && m_values[i] < MAX_STACK_DEPTH, "");
+		key |= static_cast<uint32_t>(m_values[i]) << (4 + 3 * i);
+	}
+	return key;
+}
+
+StackState StackState::unpack(uint32_t _key) {
+	auto size = static_cast<int8_t>(_key & 0xF);
+	Values values{};
+	for (int i = 0; i < size; ++i)
+		values[i] = static_cast<int8_t>((_key >> (4 + 3 * i)) & 0x7);
+	return StackState{size, values};
+}
+
+uint64_t StackDpEntry::pack(uint32_t _state, uint32_t _prevIndex, StackCommand const& _command) {
+	auto arg = [](int value) -> uint64_t {
+		solAssert(-2 <= value && value <= 13, "");
+		return value + 2;
+	};
+	return static_cast<uint64_t>(_state) |
+		(static_cast<uint64_t>(_prevIndex) << 28) |
+		(static_cast<uint64_t>(_command.opcode) << 45) |
+		(arg(_command.i) << 50) |
+		(arg(_command.j) << 54) |
+		(arg(_command.k) << 58);
+}
+
+StackCommand StackDpEntry::command(uint64_t _entry) {
+	auto arg = [&](int shift) -> int {
+		return static_cast<int>((_entry >> shift) & 0xF) - 2;
+	};
+	return StackCommand{static_cast<StackCommand::Opcode>((_entry >> 45) & 0x1F), arg(50), arg(54), arg(58)};
+}
+
+int StackCommand::gasCost() const {
+	switch (opcode) {
+	case Opcode::POP_S:
+		return 18;
+	case Opcode::DROP: {
+		int n = i;
+		if (n == 1 || n == 2)
+			return 18; // "DROP" "DROP2"
+		if (n <= 15)
+			return 26; // BLKDROP
+		return 18 + 18; // PUSHINT N + DROPX
+	}
+	case Opcode::BLKDROP2: {
+		if (i > 15 || j > 15)
+			solUnimplemented("");
+		return 26;
+	}
+	case Opcode::BLKSWAP: {
+		int bottom = i;
+		int top = j;
+		if (bottom == 1 && top == 1) {
+			return 18; // SWAP
+		} else if (bottom == 1 && top == 2) {
+			return 18; // "ROT";
+		} else if (bottom == 2 && top == 1) {
+			return 18; // "ROTREV";
+		} else if (bottom == 2 && top == 2) {
+			return 18; // "SWAP2";
+		} else if (1 <= bottom && bottom <= 16 && 1 <= top && top <= 16) {
+			return 26; // "ROLL " "ROLLREV " "BLKSWAP"
+		} else {
+			solUnimplemented(""); // "ROLLX" "ROLLREVX" "BLKSWX"
+		}
+	}
+	case Opcode::BLKPUSH: {
+		if ((i == 2 && j == 1) || (i == 2 && j == 3)) {
+			return 18; // "DUP2" "OVER2"
+		} else {
+			if (i > 15)
+				solAssert(j == 0, "");
+			int rest = i;
+			int cost = 0;
+			while (rest > 0) {
+				cost += 26; // "BLKPUSH "
+				rest -= 15;
+			}
+			return cost;
+		}
+	}
+	case Opcode::PUSH2_S:
+		if ((i == 1 && j == 0) || (i == 3 && j == 2))
+			return 18; // "DUP2" "OVER2"
+		return 26; // "PUSH2"
+	case Opcode::REVERSE:
+		if ((i == 2 && j == 0) || (i == 3 && j == 0))
+			return 18; // "SWAP" "XCHG S2"
+		else if (2 <= i && i <= 17 && 0 <= j && j <= 15)
+			return 26; // "REVERSE"
+		solUnimplemented("");
+	case Opcode::XCHG:
+		if (i == 0 || i == 1)
+			return 18; // "XCHG Sj" "XCHG s1, Sj"
+		return 26; // XCHG Si, Sj
+	case Opcode::PUSH_S:
+		return 18;
+	case Opcode::XCHG3:
+	case Opcode::XCHG2:
+	case Opcode::XCPU:
+	case Opcode::PUXC:
+		return 26;
+	case Opcode::PUSH3_S:
+	case Opcode::XC2PU:
+	case Opcode::XCPU2:
+	case Opcode::PUXC2:
+	case Opcode::XCPUXC:
+	case Opcode::PUXCPU:
+	case Opcode::PU2XC:
+		return 34;
+	}
+	solUnimplemented("");
+}
+
+std::vector<uint64_t> solidity::frontend::buildStackDpTable(int startStackSize, bool _withCompoundOpcodes) {
+	struct Edge {
+		StackCommand opcode;
+		int gas{};
+	};
+	std::vector<Edge> edges;
+	auto addEdge = [&](StackCommand::Opcode opcode, int i = -1, int j = -1, int k = -1){
+		StackCommand command{opcode, i, j, k};
+		edges.emplace_back(Edge{command, command.gasCost()});
+	};
+
+	for (int i = 1; i < StackState::MAX_STACK_DEPTH; ++i)
+		addEdge(StackCommand::Opcode::POP_S, i);
+	for (int down = 1; down <= StackState::MAX_STACK_DEPTH; ++down)
+		for (int up = 1; down + up <= StackState::MAX_STACK_DEPTH; ++up)
+			addEdge(StackCommand::Opcode::BLKDROP2, down, up);
+	for (int n = 1; n <= StackState::MAX_STACK_DEPTH; ++n)
+		addEdge(StackCommand::Opcode::DROP, n);
+	for (int down = 1; down < StackState::MAX_STACK_DEPTH; ++down)
+		for (int up = 1; down + up < StackState::MAX_STACK_DEPTH; ++up)
+			addEdge(StackCommand::Opcode::BLKSWAP, down, up);
+	for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+		for (int j = i + 1; j < StackState::MAX_STACK_DEPTH; ++j)
+			addEdge(StackCommand::Opcode::XCHG, i, j);
+	for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+		for (int n = 2; i + n <= StackState::MAX_STACK_DEPTH; ++n)
+			addEdge(StackCommand::Opcode::REVERSE, n, i);
+	for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+		addEdge(StackCommand::Opcode::PUSH_S, i);
+
+	if (_withCompoundOpcodes)
+	{
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int qty = 2; i + 1 + qty <= StackState::MAX_STACK_DEPTH; ++qty)
+				addEdge(StackCommand::Opcode::BLKPUSH, qty, i);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
+				addEdge(StackCommand::Opcode::PUSH2_S, i, j);
+		for (int i = 1; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
+				addEdge(StackCommand::Opcode::XCPU, i, j);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = -1; j < StackState::MAX_STACK_DEPTH; ++j)
+				addEdge(StackCommand::Opcode::PUXC, i, j);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
+				addEdge(StackCommand::Opcode::XCHG2, i, j);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
+				for (int k = 0; k < StackState::MAX_STACK_DEPTH; ++k) {
+					addEdge(StackCommand::Opcode::XC2PU, i, j, k);
+					addEdge(StackCommand::Opcode::XCPU2, i, j, k);
+					addEdge(StackCommand::Opcode::XCHG3, i, j, k);
+				}
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = -1; j + 1 < StackState::MAX_STACK_DEPTH; ++j)
+				for (int k = -1; k + 1 < StackState::MAX_STACK_DEPTH; ++k)
+					addEdge(StackCommand::Opcode::PUXC2, i, j, k);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
+				for (int k = -1; k + 1 < StackState::MAX_STACK_DEPTH; ++k)
+					addEdge(StackCommand::Opcode::XCPUXC, i, j, k);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = -1; j + 1 < StackState::MAX_STACK_DEPTH; ++j)
+				for (int k = -1; k + 1 < StackState::MAX_STACK_DEPTH; ++k)
+					addEdge(StackCommand::Opcode::PUXCPU, i, j, k);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = -1; j + 1 < StackState::MAX_STACK_DEPTH; ++j)
+				for (int k = -2; k + 2 < StackState::MAX_STACK_DEPTH; ++k)
+					addEdge(StackCommand::Opcode::PU2XC, i, j, k);
+		for (int i = 0; i < StackState::MAX_STACK_DEPTH; ++i)
+			for (int j = 0; j < StackState::MAX_STACK_DEPTH; ++j)
+				for (int k = 0; k < StackState::MAX_STACK_DEPTH; ++k)
+					addEdge(StackCommand::Opcode::PUSH3_S, i, j, k);
+	}
+
+	std::stable_sort(edges.begin(), edges.end(), [](Edge const &a, Edge const &b){
+		return a.gas < b.gas;
+	});
+
+	struct DpState {
+		int gasCost;
+		StackState prevState;
+		StackCommand opcode;
+	};
+	struct QData {
+		StackState state;
+		int gas{};
+		int8_t opcodeQty{};
+	};
+
+	int const MAX_DEPTH = _withCompoundOpcodes ? 2 : MAX_NEW_OPCODES;
+	std::unordered_map<StackState, DpState> dp;
+	auto comp = [](QData const& x, QData const& y){
+		if (x.gas != y.gas)
+			return x.gas < y.gas;
+		return x.state.getHash() < y.state.getHash();
+	};
+	auto q = std::set<QData, decltype(comp)>(comp);
+	{
+		StackState state{startStackSize};
+		dp.emplace(state, DpState{0, StackState{startStackSize}, StackCommand{}});
+		q.emplace(QData{state, 0, 0});
+	}
+	while (!q.empty()) {
+		auto front = q.begin();
+		StackState const state = front->state;
+		int8_t const nextOpcodeQty = front->opcodeQty + 1;
+		int const gas = front->gas;
+		q.erase(front);
+		for (Edge const &e: edges) {
+			StackState nextState = state;
+			if (nextState.apply(e.opcode)) {
+				auto it = dp.find(nextState);
+				int nextGasCost = gas + e.gas;
+				if (it == dp.end()) {
+					dp.emplace(nextState, DpState{nextGasCost, state, e.opcode});
+					if (nextOpcodeQty < MAX_DEPTH)
+						q.emplace(QData{nextState, nextGasCost, nextOpcodeQty});
+				} else if (it->second.gasCost > nextGasCost) {
+					q.erase(QData{nextState, it->second.gasCost});
+					dp.erase(it);
+					dp.emplace(nextState, DpState{nextGasCost, state, e.opcode});
+					if (nextOpcodeQty < MAX_DEPTH) {
+						q.emplace(QData{nextState, nextGasCost, nextOpcodeQty});
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<StackState> states;
+	states.reserve(dp.size());
+	for (auto const& item : dp)
+		states.emplace_back(item.first);
+	std::sort(states.begin(), states.end(), [](StackState const& a, StackState const& b){
+		return a.pack() < b.pack();
+	});
+	solAssert(states.size() <= 0x1FFFF, "");
+
+	std::unordered_map<StackState, uint32_t> index;
+	for (size_t i = 0; i < states.size(); ++i)
+		index.emplace(states[i], i);
+
+	std::vector<uint64_t> table;
+	table.reserve(states.size());
+	for (StackState const& state : states) {
+		DpState const& dpState = dp.at(state);
+		// The gas cost isn't stored in the table, it's a sum of gas costs of commands in the chain.
+		solAssert(
+			state == StackState{startStackSize} ||
+			dpState.gasCost == dp.at(dpState.prevState).gasCost + dpState.opcode.gasCost(),
+			""
+		);
+		table.emplace_back(StackDpEntry::pack(state.pack(), index.at(dpState.prevState), dpState.opcode));
+	}
+	return table;
+}
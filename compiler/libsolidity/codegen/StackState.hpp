@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2021-2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Stack state model used by the stack opcode squasher.
+ * It doesn't depend on TVM AST so it can be used by the generator of precomputed squasher tables.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace solidity::frontend {
+
+constexpr static int MAX_NEW_OPCODES = 3;
+
+struct StackCommand {
+	enum class Opcode : uint8_t {
+		DROP,
+		BLKDROP2, // BLKDROP2 1, 1
+		POP_S,    // POP_S 1
+
+		BLKPUSH, // BLKPUSH 1, i | BLKPUSH 3, i         |  BLKPUSH 2, 1 (DUP2)  |  BLKPUSH 3, 1 (OVER2)
+		PUSH2_S, //              |                      |  PUSH2 S1, S0         |  PUSH2 S3, S2
+		PUSH3_S, //              | PUSH3 Si, Si-1, Si-2 |                       |
+		PUSH_S,  // PUSH Si      |                      |                       |
+
+		BLKSWAP, //  BLKSWAP 1, 1  |
+		REVERSE, //  REVERSE 2, 0  |  REVERSE 3, 0
+		XCHG,    //  XCHG S0 S1    |  XCHG S0 S2,
+
+		//  Compound stack manipulation primitives
+		XCHG3,
+		XCHG2,
+		XCPU,  //XCPU s1,s1 == TUCK
+		PUXC,
+		XC2PU,
+		XCPU2,
+		PUXC2,
+		XCPUXC,
+		PUXCPU,
+		PU2XC
+	};
+	Opcode opcode{};
+	int i{-1};
+	int j{-1};
+	int k{-1};
+
+	int gasCost() const;
+};
+
+class StackState {
+public:
+	// depth of the precomputed tables
+	constexpr static int MAX_STACK_DEPTH = 8;
+	// depth of the search for stack opcodes that reach deeper values, see StackOpcodeSquasher::search
+	constexpr static int MAX_SEARCH_DEPTH = 16;
+	using Values = std::array<int8_t, MAX_SEARCH_DEPTH>;
+
+	// `_maxSize` limits the size of the stack after opcodes that push values
+	explicit StackState(int _size, int _maxSize = MAX_STACK_DEPTH);
+	explicit StackState(int8_t _size, Values _values) : m_size{_size}, m_values{_values} {
+		updHash();
+	}
+	bool apply(StackCommand const& command);
+	bool operator==(const StackState &other) const {
+		if (m_size != other.m_size)
+			return false;
+		for (int i = 0; i < m_size; ++i)
+			if (m_values[i] != other.m_values[i])
+				return false;
+		return true;
+	}
+	bool operator!=(const StackState &other) const {
+		return !operator==(other);
+	}
+	std::size_t getHash() const { return m_hash; }
+	int8_t size() const { return m_size; }
+	Values const& values() const { return m_values; }
+	// 4 bits for the size and 3 bits for each value. All values are less than MAX_STACK_DEPTH.
+	uint32_t pack() const;
+	static StackState unpack(uint32_t _key);
+private:
+	void updHash();
+private:
+	std::size_t m_hash{};
+	int8_t m_size;
+	int8_t m_maxSize{MAX_STACK_DEPTH};
+	Values m_values{};
+};
+
+// Entry of the squasher table. It describes the cheapest way to get `state` from the start stack:
+// apply `command` to the state stored at `prevIndex` in the same table.
+// Entries are packed into 64 bits and sorted by `state`, so the tables can be embedded into the binary
+// and searched with binary search:
+//   bits  0..27 - state (see StackState::pack)
+//   bits 28..44 - prevIndex
+//   bits 45..49 - opcode
+//   bits 50..61 - arguments of the opcode (each one is stored as value + 2 in 4 bits)
+struct StackDpEntry {
+	static uint64_t pack(uint32_t _state, uint32_t _prevIndex, StackCommand const& _command);
+	static uint32_t state(uint64_t _entry) { return _entry & 0xFFFFFFF; }
+	static uint32_t prevIndex(uint64_t _entry) { return (_entry >> 28) & 0x1FFFF; }
+	static StackCommand command(uint64_t _entry);
+};
+
+// Finds the cheapest sequences of stack opcodes for all stack states that
+// can be got from the start stack of size `startStackSize`.
+std::vector<uint64_t> buildStackDpTable(int startStackSize, bool _withCompoundOpcodes);
+
+} // end solidity::frontend
+
+namespace std {
+
+template <>
+struct hash<solidity::frontend::StackState> {
+std::size_t operator()(const solidity::frontend::StackState& k) const {
+	return k.getHash();
+}
+};
+
+}
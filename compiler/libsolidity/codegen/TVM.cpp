@@ -16,14 +16,68 @@
 
 
 #include <libsolidity/codegen/TVM.hpp>
+#include <libsolidity/codegen/TVMConstants.hpp>
 #include <libsolidity/codegen/TVMContractCompiler.hpp>
 
+#include <json/json.h>
+
 using namespace std;
 using namespace solidity::frontend;
 
 solidity::langutil::ErrorReporter* GlobalParams::g_errorReporter{};
 solidity::langutil::CharStreamProvider* GlobalParams::g_charStreamProvider{};
 solidity::util::SetOnce<solidity::langutil::TVMVersion> GlobalParams::g_tvmVersion{};
+int GlobalParams::g_optimizerRounds{TvmConst::MaxOptimizerRounds};
+bool GlobalParams::g_dataflowPasses{true};
+bool GlobalParams::g_printOptimizerStats{};
+unsigned GlobalParams::g_jobs{1};
+std::map<uint32_t, double> GlobalParams::g_functionProfile{};
+bool GlobalParams::g_compareFunctionIds{};
+OptimizationObjective GlobalParams::g_optimizeFor{OptimizationObjective::Balanced};
+bool GlobalParams::g_lazyStateLoading{};
+bool GlobalParams::g_partialStateSaving{};
+bool GlobalParams::g_optimizeStorageLayout{};
+std::vector<std::string> GlobalParams::g_storageLayout{};
+ContractDefinition const* GlobalParams::g_mainContract{};
+std::optional<int> GlobalParams::g_inlineThreshold{};
+
+void GlobalParams::setCodegenSettings(TVMCodegenSettings const& _settings) {
+	g_optimizerRounds = _settings.optimizerRounds;
+	g_dataflowPasses = _settings.dataflowPasses;
+	g_printOptimizerStats = _settings.printOptimizerStats;
+	g_jobs = _settings.jobs;
+	g_functionProfile = _settings.functionProfile;
+	g_compareFunctionIds = _settings.compareFunctionIds;
+	g_optimizeFor = _settings.optimizeFor;
+	g_lazyStateLoading = _settings.lazyStateLoading;
+	g_partialStateSaving = _settings.partialStateSaving;
+	g_optimizeStorageLayout = _settings.optimizeStorageLayout;
+	g_storageLayout = _settings.storageLayout;
+	g_mainContract = nullptr;
+	g_inlineThreshold = _settings.inlineThreshold;
+}
+
+std::optional<std::string> parseFunctionProfile(Json::Value const& _profile, std::map<uint32_t, double>& _result) {
+	if (!_profile.isObject())
+		return "a JSON object is expected.";
+	for (std::string const& key : _profile.getMemberNames()) {
+		std::optional<uint32_t> functionId;
+		try {
+			size_t pos = 0;
+			unsigned long id = std::stoul(key, &pos, 0);
+			if (pos == key.size() && id <= std::numeric_limits<uint32_t>::max())
+				functionId = static_cast<uint32_t>(id);
+		} catch (std::logic_error const&) {
+		}
+		if (!functionId.has_value())
+			return "invalid function id \"" + key + "\".";
+		Json::Value const& frequency = _profile[key];
+		if (!frequency.isNumeric() || frequency.asDouble() < 0)
+			return "invalid call frequency of the function \"" + key + "\".";
+		_result[*functionId] = frequency.asDouble();
+	}
+	return std::nullopt;
+}
 
 std::string getPathToFiles(
 	const std::string& solFileName,
@@ -68,7 +122,8 @@ void TVMCompilerProceedContract(
 	const std::string& outputFolder,
 	const std::string& filePrefix,
 	bool doPrintFunctionIds,
-	bool doPrivateFunctionIds
+	bool doPrivateFunctionIds,
+	bool doGasReport
 ) {
 	std::string pathToFiles = getPathToFiles(solFileName, outputFolder, filePrefix);
 
@@ -78,12 +133,18 @@ void TVMCompilerProceedContract(
 	} else if (doPrivateFunctionIds) {
 		TVMContractCompiler::printPrivateFunctionIds(_contract, _sourceUnits, pragmaHelper);
 	} else {
+		Pointer<Contract> codeContract;
 		if (generateCode) {
-			TVMContractCompiler::generateCodeAndSaveToFile(pathToFiles + ".code", _contract, _sourceUnits, pragmaHelper);
+			codeContract = TVMContractCompiler::generateCodeAndSaveToFile(pathToFiles + ".code", _contract, _sourceUnits, pragmaHelper);
 		}
 		if (generateAbi) {
 			TVMContractCompiler::generateABI(pathToFiles + ".abi.json", &_contract, _sourceUnits, *pragmaDirectives);
 		}
+		if (doGasReport) {
+			if (!codeContract)
+				codeContract = TVMContractCompiler::generateContractCode(&_contract, _sourceUnits, pragmaHelper);
+			TVMContractCompiler::printGasReport(_contract, *codeContract, pragmaHelper);
+		}
 	}
 
 }
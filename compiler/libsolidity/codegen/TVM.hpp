@@ -16,20 +16,69 @@
 
 #pragma once
 
+#include <map>
+#include <optional>
 #include <vector>
 #include <liblangutil/ErrorReporter.h>
 #include <liblangutil/TVMVersion.h>
 #include <libsolidity/ast/ASTForward.h>
 #include <liblangutil/CharStreamProvider.h>
 #include <libsolutil/SetOnce.h>
+#include <libsolidity/codegen/TVMConstants.hpp>
+
+namespace Json { class Value; }
+
+// What the size optimizer prefers if code can be made smaller at the cost of gas
+enum class OptimizationObjective {
+	Balanced,
+	Size,
+	Gas
+};
+
+// Options of the TVM code generator and optimizer. CompilerStack keeps them and copies them
+// to GlobalParams on every compilation, so nothing is left over from a previous one.
+struct TVMCodegenSettings {
+	int optimizerRounds{TvmConst::MaxOptimizerRounds};
+	bool dataflowPasses{true};
+	bool printOptimizerStats{};
+	unsigned jobs{1};
+	std::map<uint32_t, double> functionProfile;
+	bool compareFunctionIds{};
+	OptimizationObjective optimizeFor{OptimizationObjective::Balanced};
+	bool lazyStateLoading{};
+	bool partialStateSaving{};
+	bool optimizeStorageLayout{};
+	std::vector<std::string> storageLayout;
+	std::optional<int> inlineThreshold;
+};
 
 class GlobalParams {
 public:
 	static solidity::langutil::ErrorReporter* g_errorReporter;
 	static solidity::langutil::CharStreamProvider* g_charStreamProvider;
 	static solidity::util::SetOnce<solidity::langutil::TVMVersion> g_tvmVersion;
+	static int g_optimizerRounds;
+	static bool g_dataflowPasses; // dictionary lookup elimination, loop invariant hoisting and constant propagation
+	static bool g_printOptimizerStats;
+	static unsigned g_jobs;
+	static std::map<uint32_t, double> g_functionProfile; // call frequencies of public functions by their ids
+	static bool g_compareFunctionIds; // without a profile consider public functions equally frequent
+	static OptimizationObjective g_optimizeFor;
+	static bool g_lazyStateLoading;
+	static bool g_partialStateSaving;
+	static bool g_optimizeStorageLayout;
+	static std::vector<std::string> g_storageLayout; // names of state variables in c4 of the previous version
+	// the compiled contract; g_optimizeStorageLayout and g_storageLayout don't change the layout of other contracts
+	static solidity::frontend::ContractDefinition const* g_mainContract;
+	static std::optional<int> g_inlineThreshold; // max size in bits of inlined functions, see FunctionInliner
+
+	static void setCodegenSettings(TVMCodegenSettings const& _settings);
 };
 
+// Reads a function profile: a JSON object that maps function ids to call frequencies.
+// Returns an error message if the profile is malformed.
+std::optional<std::string> parseFunctionProfile(Json::Value const& _profile, std::map<uint32_t, double>& _result);
+
 std::string getPathToFiles(
 	const std::string& solFileName,
 	const std::string& outputFolder,
@@ -46,5 +95,6 @@ void TVMCompilerProceedContract(
 	const std::string& outputFolder,
 	const std::string& filePrefix,
 	bool doPrintFunctionIds,
-	bool doPrivateFunctionIds
+	bool doPrivateFunctionIds,
+	bool doGasReport
 );
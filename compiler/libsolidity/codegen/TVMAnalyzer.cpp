@@ -391,6 +391,180 @@ bool ContactsUsageScanner::visit(const FunctionDefinition &fd) {
 	return true;
 }
 
+StateVariableUsageScanner::StateVariableUsageScanner(
+	ContractDefinition const& contract,
+	FunctionDefinition const& function
+) :
+	m_contract{contract}
+{
+	addFunction(function);
+}
+
+bool StateVariableUsageScanner::visit(Identifier const& _node) {
+	auto var = to<VariableDeclaration>(_node.annotation().referencedDeclaration);
+	if (var && var->isStateVariable())
+		m_stateVariables.insert(var);
+	return true;
+}
+
+bool StateVariableUsageScanner::visit(MemberAccess const& _node) {
+	auto var = to<VariableDeclaration>(_node.annotation().referencedDeclaration);
+	if (var && var->isStateVariable())
+		m_stateVariables.insert(var);
+
+	auto identifier = to<Identifier>(&_node.expression());
+	if (identifier && identifier->name() == "tvm") {
+		// these functions save state variables to c4
+		if (isIn(_node.memberName(), "commit", "exit", "exit1", "resetStorage"))
+			m_savesState = true;
+		// these functions change c4, all state variables or the header of c4 (pubkey and replay protection value)
+		if (isIn(_node.memberName(), "resetStorage", "setData", "setPubkey", "setReplayProtectionValue"))
+			m_writesAll = true;
+	}
+	return true;
+}
+
+bool StateVariableUsageScanner::visit(FunctionCall const& _functionCall) {
+	auto funType = to<FunctionType>(getType(&_functionCall.expression()));
+	if (funType && isIn(funType->kind(), FunctionType::Kind::Internal, FunctionType::Kind::DelegateCall)) {
+		auto callee = funType->hasDeclaration() ? to<FunctionDefinition>(&funType->declaration()) : nullptr;
+		if (callee == nullptr || callee->isInlineAssembly())
+			m_unknownCalls = true;
+		else
+			addFunction(*callee);
+	}
+	// member functions can change the object, e.g. `array.push(value)` or `map.delMin()`
+	if (auto memberAccess = to<MemberAccess>(&_functionCall.expression()))
+		addWrite(memberAccess->expression());
+	return true;
+}
+
+bool StateVariableUsageScanner::visit(Assignment const& _assignment) {
+	addWrite(_assignment.leftHandSide());
+	return true;
+}
+
+bool StateVariableUsageScanner::visit(UnaryOperation const& _node) {
+	if (isIn(_node.getOperator(), Token::Inc, Token::Dec, Token::Delete))
+		addWrite(_node.subExpression());
+	return true;
+}
+
+bool StateVariableUsageScanner::visit(ModifierInvocation const& _node) {
+	if (auto modifier = to<ModifierDefinition>(_node.name().annotation().referencedDeclaration))
+		addFunction(*modifier);
+	return true;
+}
+
+bool StateVariableUsageScanner::visit(FreeInlineAssembly const& /*_node*/) {
+	m_unknownCalls = true;
+	return false;
+}
+
+void StateVariableUsageScanner::addWrite(Expression const& lValue) {
+	if (auto tuple = to<TupleExpression>(&lValue)) {
+		for (ASTPointer<Expression> const& component : tuple->components())
+			if (component)
+				addWrite(*component);
+		return;
+	}
+	// find the variable that contains the changed member or element, e.g. `a` in `a[i].b = 1`
+	Expression const* expr = &lValue;
+	while (expr != nullptr) {
+		Declaration const* declaration = nullptr;
+		if (auto identifier = to<Identifier>(expr)) {
+			declaration = identifier->annotation().referencedDeclaration;
+			expr = nullptr;
+		} else if (auto memberAccess = to<MemberAccess>(expr)) {
+			declaration = memberAccess->annotation().referencedDeclaration;
+			expr = &memberAccess->expression();
+		} else if (auto indexAccess = to<IndexAccess>(expr)) {
+			expr = &indexAccess->baseExpression();
+		} else if (auto indexRangeAccess = to<IndexRangeAccess>(expr)) {
+			expr = &indexRangeAccess->baseExpression();
+		} else {
+			expr = nullptr;
+		}
+		auto var = to<VariableDeclaration>(declaration);
+		if (var && var->isStateVariable())
+			m_writtenStateVariables.insert(var);
+	}
+}
+
+void StateVariableUsageScanner::addFunction(CallableDeclaration const& function) {
+	// a virtual function can be overridden in any contract of the inheritance chain
+	std::vector<CallableDeclaration const*> candidates{&function};
+	if (function.virtualSemantics()) {
+		for (ContractDefinition const* base : m_contract.annotation().linearizedBaseContracts) {
+			for (FunctionDefinition const* f : base->definedFunctions())
+				if (f->name() == function.name())
+					candidates.emplace_back(f);
+			for (ModifierDefinition const* m : base->functionModifiers())
+				if (m->name() == function.name())
+					candidates.emplace_back(m);
+		}
+	}
+	for (CallableDeclaration const* f : candidates)
+		if (m_visitedFunctions.insert(f).second)
+			f->accept(*this);
+}
+
+StateVariableAccessCounter::StateVariableAccessCounter(ContractDefinition const& contract) {
+	for (ContractDefinition const* c : getContractsChain(&contract)) {
+		for (FunctionDefinition const* f : c->definedFunctions())
+			f->accept(*this);
+		for (ModifierDefinition const* m : c->functionModifiers())
+			m->accept(*this);
+	}
+}
+
+bool StateVariableAccessCounter::visit(Identifier const& _node) {
+	addAccess(_node.annotation().referencedDeclaration);
+	return true;
+}
+
+bool StateVariableAccessCounter::visit(WhileStatement const&) {
+	++m_loopDepth;
+	return true;
+}
+
+bool StateVariableAccessCounter::visit(ForStatement const&) {
+	++m_loopDepth;
+	return true;
+}
+
+bool StateVariableAccessCounter::visit(ForEachStatement const&) {
+	++m_loopDepth;
+	return true;
+}
+
+void StateVariableAccessCounter::endVisit(WhileStatement const&) {
+	--m_loopDepth;
+}
+
+void StateVariableAccessCounter::endVisit(ForStatement const&) {
+	--m_loopDepth;
+}
+
+void StateVariableAccessCounter::endVisit(ForEachStatement const&) {
+	--m_loopDepth;
+}
+
+uint64_t StateVariableAccessCounter::accessCount(VariableDeclaration const* var) const {
+	auto it = m_accessCount.find(var);
+	return it == m_accessCount.end() ? 0 : it->second;
+}
+
+void StateVariableAccessCounter::addAccess(Declaration const* declaration) {
+	auto var = to<VariableDeclaration>(declaration);
+	if (var == nullptr || !var->isStateVariable())
+		return;
+	uint64_t weight = 1;
+	for (int i = 0; i < std::min(m_loopDepth, MaxLoopDepth); ++i)
+		weight *= LoopWeight;
+	m_accessCount[var] += weight;
+}
+
 bool solidity::frontend::withPrelocatedRetValues(const FunctionDefinition *f) {
 	LocationReturn locationReturn = notNeedsPushContWhenInlining(f->body());
 	if (!f->returnParameters().empty() && isIn(locationReturn, LocationReturn::noReturn, LocationReturn::Anywhere)) {
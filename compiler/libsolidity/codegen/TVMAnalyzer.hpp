@@ -115,6 +115,67 @@ private:
 	std::set<Declaration const*> m_usedFunctions;
 };
 
+// Collects state variables that are used by a function, its modifiers and functions called by it
+class StateVariableUsageScanner: public ASTConstVisitor
+{
+public:
+	StateVariableUsageScanner(ContractDefinition const& contract, FunctionDefinition const& function);
+	bool visit(Identifier const& _node) override;
+	bool visit(MemberAccess const& _node) override;
+	bool visit(FunctionCall const& _functionCall) override;
+	bool visit(Assignment const& _assignment) override;
+	bool visit(UnaryOperation const& _node) override;
+	bool visit(ModifierInvocation const& _node) override;
+	bool visit(FreeInlineAssembly const& _node) override;
+
+	std::set<VariableDeclaration const*> const& stateVariables() const { return m_stateVariables; }
+	std::set<VariableDeclaration const*> const& writtenStateVariables() const { return m_writtenStateVariables; }
+	// true if the function stores state variables to c4 or the set of used variables is unknown,
+	// e.g. it calls a function by a pointer
+	bool usesAllStateVariables() const { return m_unknownCalls || m_savesState; }
+	// true if the function can change c4, its header or state variables in a way that isn't tracked
+	bool writesAllStateVariables() const { return m_unknownCalls || m_writesAll; }
+
+private:
+	void addFunction(CallableDeclaration const& function);
+	void addWrite(Expression const& lValue);
+
+	ContractDefinition const& m_contract;
+	std::set<VariableDeclaration const*> m_stateVariables;
+	std::set<VariableDeclaration const*> m_writtenStateVariables;
+	std::set<CallableDeclaration const*> m_visitedFunctions;
+	bool m_unknownCalls{};
+	bool m_savesState{};
+	bool m_writesAll{};
+};
+
+// Estimates how often state variables are accessed by the code of a contract.
+// Every access adds 1, an access inside a loop is multiplied by LoopWeight per nesting level.
+// Only identifiers are counted because they are resolved before type checking, so the result
+// is the same in the type checker and in the code generator.
+class StateVariableAccessCounter: public ASTConstVisitor
+{
+public:
+	explicit StateVariableAccessCounter(ContractDefinition const& contract);
+	bool visit(Identifier const& _node) override;
+	bool visit(WhileStatement const& _node) override;
+	bool visit(ForStatement const& _node) override;
+	bool visit(ForEachStatement const& _node) override;
+	void endVisit(WhileStatement const& _node) override;
+	void endVisit(ForStatement const& _node) override;
+	void endVisit(ForEachStatement const& _node) override;
+
+	uint64_t accessCount(VariableDeclaration const* var) const;
+
+private:
+	void addAccess(Declaration const* declaration);
+
+	static constexpr uint64_t LoopWeight = 8;
+	static constexpr int MaxLoopDepth = 4;
+	std::map<VariableDeclaration const*, uint64_t> m_accessCount;
+	int m_loopDepth{};
+};
+
 template <typename T>
 static bool doesAlways(const Statement* st) {
 	auto rec = [] (const Statement* s) {
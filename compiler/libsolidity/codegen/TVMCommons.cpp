@@ -727,50 +727,54 @@ std::optional<bool> ExprUtils::constBool(Expression const& _e) {
 }
 
 std::map<bigint, int> const& MathConsts::power2Exp() {
-	static std::map<bigint, int> power2Exp;
-	if (power2Exp.empty()) {
+	static std::map<bigint, int> const power2Exp = []() {
+		std::map<bigint, int> res;
 		bigint p2 = 1;
 		for (int p = 0; p <= 256; ++p) {
-			power2Exp[p2] = p;
+			res[p2] = p;
 			p2 *= 2;
 		}
-	}
+		return res;
+	}();
 	return power2Exp;
 }
 
 std::map<bigint, int> const& MathConsts::power2DecExp() {
-	static std::map<bigint, int> power2DecExp;
-	if (power2DecExp.empty()) {
+	static std::map<bigint, int> const power2DecExp = []() {
+		std::map<bigint, int> res;
 		bigint p2 = 1;
 		for (int p = 0; p <= 256; ++p) {
-			power2DecExp[p2 - 1] = p;
+			res[p2 - 1] = p;
 			p2 *= 2;
 		}
-	}
+		return res;
+	}();
 	return power2DecExp;
 }
 
 std::map<bigint, int> const& MathConsts::power2NegExp() {
-	static std::map<bigint, int> power2NegExp;
-	if (power2NegExp.empty()) {
+	static std::map<bigint, int> const power2NegExp = []() {
+		std::map<bigint, int> res;
 		bigint p2 = 1;
 		for (int p = 0; p <= 256; ++p) {
-			power2NegExp[-p2] = p;
+			res[-p2] = p;
 			p2 *= 2;
 		}
-	}
+		return res;
+	}();
 	return power2NegExp;
 }
 
 std::map<int, bigint> const& MathConsts::power10() {
-	static std::map<int, bigint> power10;
-	if (power10.empty()) {
+	static std::map<int, bigint> const power10 = []() {
+		std::map<int, bigint> res;
 		bigint p10 = 1;
 		for (int i = 0; i <= 80; ++i) {
-			power10[i] = p10;
+			res[i] = p10;
 			p10 *= 10;
 		}
-	}
+		return res;
+	}();
 	return power10;
 }
 
@@ -863,8 +867,8 @@ unsigned short crc16(std::string const& str) {
 }
 
 std::vector<ArithmeticOperation> tonCombinedArithmeticOperations() {
-	static std::vector<ArithmeticOperation> answer;
-	if (answer.empty()) {
+	static std::vector<ArithmeticOperation> const operations = []() {
+		std::vector<ArithmeticOperation> answer;
 		for (auto const& oper: std::vector<ArithmeticOperation>{
 			{"mulAddDivMod", 4, 2, false},
 			{"addDivMod", 3, 2, false},
@@ -901,8 +905,9 @@ std::vector<ArithmeticOperation> tonCombinedArithmeticOperations() {
 				}
 			}
 		}
-	}
-	return answer;
+		return answer;
+	}();
+	return operations;
 }
 
 FunctionDefinition const* getRemoteFunctionDefinition(const MemberAccess* memberAccess) {
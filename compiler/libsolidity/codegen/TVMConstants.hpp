@@ -112,6 +112,7 @@ namespace TvmConst {
 	}
 
 	const int IterStackOptQty = 10;
+	const int MaxOptimizerRounds = 10; // default cap of peephole + stack optimizer rounds per function
 	const int TvmTupleLen = 255;
 
 	static constexpr int CONTINUE_FLAG = 1;
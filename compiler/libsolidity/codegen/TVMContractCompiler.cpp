@@ -14,12 +14,23 @@
  * AST to TVM bytecode contract compiler
  */
 
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <iomanip>
+#include <future>
+#include <thread>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/range/adaptor/map.hpp>
 
 #include <libsolidity/interface/Version.h>
 
+#include <libsolidity/codegen/ConstantPropagator.hpp>
+#include <libsolidity/codegen/DeadFunctionEliminator.hpp>
+#include <libsolidity/codegen/DictLookupEliminator.hpp>
+#include <libsolidity/codegen/FunctionInliner.hpp>
+#include <libsolidity/codegen/GasEstimator.hpp>
+#include <libsolidity/codegen/LoopInvariantHoister.hpp>
 #include <libsolidity/codegen/PeepholeOptimizer.hpp>
 #include <libsolidity/codegen/SizeOptimizer.hpp>
 #include <libsolidity/codegen/StackOptimizer.hpp>
@@ -36,6 +47,200 @@ using namespace solidity::frontend;
 using namespace std;
 using namespace solidity::util;
 
+namespace {
+
+// Collects how much time each optimization pass has taken and how many functions were
+// optimized in each round of the fixpoint loop. It's printed with `--optimizer-stats`.
+class OptimizerStatistics {
+public:
+	template<class F>
+	void measure(std::string const& pass, F const& f) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		auto finish = std::chrono::steady_clock::now();
+		PassStat& stat = m_passes[pass];
+		++stat.runs;
+		stat.time += std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+	}
+
+	void addRound(size_t functionQty) {
+		m_functionsPerRound.emplace_back(functionQty);
+	}
+
+	void addResult(std::string const& name, int64_t value) {
+		m_results[name] += value;
+	}
+
+	void merge(OptimizerStatistics const& other) {
+		for (auto const& [name, stat] : other.m_passes) {
+			PassStat& s = m_passes[name];
+			s.runs += stat.runs;
+			s.time += stat.time;
+		}
+		for (auto const& [name, value] : other.m_results)
+			m_results[name] += value;
+		if (m_functionsPerRound.size() < other.m_functionsPerRound.size())
+			m_functionsPerRound.resize(other.m_functionsPerRound.size());
+		for (size_t i = 0; i < other.m_functionsPerRound.size(); ++i)
+			m_functionsPerRound.at(i) += other.m_functionsPerRound.at(i);
+	}
+
+	void print(std::ostream& out, bool reachedFixpoint) const {
+		out << "Optimizer rounds: " << m_functionsPerRound.size()
+			<< (reachedFixpoint ? " (fixpoint is reached)" : " (round limit is reached)") << std::endl;
+		for (size_t i = 0; i < m_functionsPerRound.size(); ++i)
+			out << "  round " << i + 1 << ": " << m_functionsPerRound.at(i) << " function(s)" << std::endl;
+		out << "Optimizer passes:" << std::endl;
+		for (auto const& [name, stat] : m_passes)
+			out << "  " << name << ": " << stat.runs << " run(s), " << stat.time.count() / 1000.0 << " ms" << std::endl;
+		if (!m_results.empty()) {
+			out << "Optimizer results:" << std::endl;
+			for (auto const& [name, value] : m_results)
+				out << "  " << name << ": " << value << std::endl;
+		}
+	}
+
+private:
+	struct PassStat {
+		int runs{};
+		std::chrono::microseconds time{};
+	};
+	std::map<std::string, PassStat> m_passes;
+	std::map<std::string, int64_t> m_results;
+	std::vector<size_t> m_functionsPerRound;
+};
+
+class CodeBlockCollector : public TvmAstVisitor {
+public:
+	bool visit(CodeBlock& _node) override {
+		m_blocks.emplace_back(&_node);
+		return true;
+	}
+	std::vector<CodeBlock const*> const& blocks() const { return m_blocks; }
+private:
+	std::vector<CodeBlock const*> m_blocks;
+};
+
+// Splits functions into groups that can be optimized independently. Bodies of inline functions
+// are inserted into callers by pointers, so several functions can share a code block, and the
+// optimizers change code blocks in place. Functions that share a code block get into the same group.
+// Groups and functions in a group are ordered as in `functions`.
+std::vector<std::vector<Pointer<Function>>> independentFunctionGroups(std::vector<Pointer<Function>> const& functions) {
+	std::vector<size_t> parent(functions.size());
+	for (size_t i = 0; i < parent.size(); ++i)
+		parent[i] = i;
+	auto root = [&](size_t i) {
+		while (parent[i] != i)
+			i = parent[i] = parent[parent[i]];
+		return i;
+	};
+
+	std::map<CodeBlock const*, size_t> owner;
+	for (size_t i = 0; i < functions.size(); ++i) {
+		CodeBlockCollector collector;
+		functions[i]->accept(collector);
+		for (CodeBlock const* block : collector.blocks()) {
+			auto [it, inserted] = owner.emplace(block, i);
+			if (!inserted) {
+				size_t a = root(it->second);
+				size_t b = root(i);
+				parent[std::max(a, b)] = std::min(a, b);
+			}
+		}
+	}
+
+	std::vector<std::vector<Pointer<Function>>> groups;
+	std::map<size_t, size_t> groupIndex;
+	for (size_t i = 0; i < functions.size(); ++i) {
+		auto [it, inserted] = groupIndex.emplace(root(i), groups.size());
+		if (inserted)
+			groups.emplace_back();
+		groups.at(it->second).emplace_back(functions[i]);
+	}
+	return groups;
+}
+
+// Runs dictionary lookup eliminator, loop invariant hoister, constant propagator (unless
+// --no-dataflow-passes is given), peephole and stack optimizers until a fixpoint. A function is taken into the next round only if one of the optimizers
+// has rewritten it in the current round, because these passes never look outside of the function they are visiting.
+// Returns true if the fixpoint is reached.
+bool optimizeFunctions(std::vector<Pointer<Function>> worklist, OptimizerStatistics& stats) {
+	for (int round = 0; round < GlobalParams::g_optimizerRounds && !worklist.empty(); ++round) {
+		std::vector<Pointer<Function>> dirty;
+		for (Pointer<Function> const& f : worklist) {
+			DictLookupEliminator eliminator;
+			LoopInvariantHoister hoister;
+			ConstantPropagator propagator;
+			if (GlobalParams::g_dataflowPasses) {
+				stats.measure("DictLookupEliminator", [&]() { f->accept(eliminator); });
+				stats.addResult("eliminated dictionary lookups", eliminator.eliminatedLookups());
+
+				stats.measure("LoopInvariantHoister", [&]() { f->accept(hoister); });
+				stats.addResult("hoisted loop invariants", hoister.hoistedValues());
+
+				stats.measure("ConstantPropagator", [&]() { f->accept(propagator); });
+				stats.addResult("folded instructions", propagator.foldedInstructions());
+				stats.addResult("removed branches", propagator.removedBranches());
+			}
+
+			PeepholeOptimizer peepHole{{}};
+			stats.measure("PeepholeOptimizer", [&]() { f->accept(peepHole); });
+
+			StackOptimizer opt;
+			stats.measure("StackOptimizer", [&]() { f->accept(opt); });
+
+			if (eliminator.didSome() || hoister.didSome() || propagator.didSome() || peepHole.didSome() || opt.didSome())
+				dirty.emplace_back(f);
+		}
+		stats.addRound(worklist.size());
+		worklist = std::move(dirty);
+	}
+	return worklist.empty();
+}
+
+// Optimizes independent groups of functions in `GlobalParams::g_jobs` threads.
+// The result doesn't depend on the number of threads.
+bool optimizeFunctionsInParallel(std::vector<Pointer<Function>> const& functions, OptimizerStatistics& stats) {
+	std::vector<std::vector<Pointer<Function>>> const groups = independentFunctionGroups(functions);
+	size_t jobs = GlobalParams::g_jobs == 0 ? std::thread::hardware_concurrency() : GlobalParams::g_jobs;
+	jobs = std::max<size_t>(1, std::min(jobs, groups.size()));
+
+	std::vector<OptimizerStatistics> groupStats(groups.size());
+	std::vector<char> reachedFixpoint(groups.size());
+	std::vector<std::exception_ptr> errors(groups.size());
+	std::atomic<size_t> next{0};
+	auto worker = [&]() {
+		for (size_t i = next++; i < groups.size(); i = next++) {
+			try {
+				reachedFixpoint[i] = optimizeFunctions(groups[i], groupStats[i]);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::future<void>> workers;
+	for (size_t j = 1; j < jobs; ++j)
+		workers.emplace_back(std::async(std::launch::async, worker));
+	worker();
+	for (std::future<void>& w : workers)
+		w.get();
+
+	// Report the same error regardless of the number of threads
+	for (std::exception_ptr const& error : errors)
+		if (error)
+			std::rethrow_exception(error);
+
+	bool fixpoint = true;
+	for (size_t i = 0; i < groups.size(); ++i) {
+		stats.merge(groupStats[i]);
+		fixpoint = fixpoint && reachedFixpoint[i];
+	}
+	return fixpoint;
+}
+
+}
+
 
 void TVMContractCompiler::printFunctionIds(
 	ContractDefinition const& contract,
@@ -73,7 +278,7 @@ void TVMContractCompiler::generateABI(
 	}
 }
 
-void TVMContractCompiler::generateCodeAndSaveToFile(
+Pointer<Contract> TVMContractCompiler::generateCodeAndSaveToFile(
 	const std::string& fileName,
 	ContractDefinition const& contract,
 	std::vector<ASTPointer<SourceUnit>>const& _sourceUnits,
@@ -90,6 +295,7 @@ void TVMContractCompiler::generateCodeAndSaveToFile(
 	codeContract->accept(p);
 	ofile.close();
 	cout << "Code was generated and saved to file " << fileName << endl;
+	return codeContract;
 }
 
 Pointer<Contract>
@@ -100,6 +306,8 @@ TVMContractCompiler::generateContractCode(
 ) {
 	std::vector<Pointer<Function>> functions;
 	std::map<uint32_t, std::string> getters;
+	// functions that are called by messages, they are roots for DeadFunctionEliminator
+	std::set<std::string> entryPoints;
 
 	TVMCompilerContext ctx{contract, pragmaHelper};
 
@@ -110,6 +318,7 @@ TVMContractCompiler::generateContractCode(
 		StackPusher pusher{&ctx};
 		TVMConstructorCompiler compiler(pusher);
 		Pointer<Function> f = compiler.generateConstructors();
+		entryPoints.insert(f->name());
 		functions.emplace_back(f);
 	}
 
@@ -125,19 +334,23 @@ TVMContractCompiler::generateContractCode(
 				if (!ctx.isOnBounceGenerated()) {
 					ctx.setIsOnBounce();
 					functions.emplace_back(TVMFunctionCompiler::generateOnBounce(ctx, _function));
+					entryPoints.insert(functions.back()->name());
 				}
 			} else if (_function->isReceive()) {
 				if (!ctx.isReceiveGenerated()) {
 					ctx.setIsReceiveGenerated();
 					functions.emplace_back(TVMFunctionCompiler::generateReceive(ctx, _function));
+					entryPoints.insert(functions.back()->name());
 				}
 			} else if (_function->isFallback()) {
 				if (ctx.fallBack() == nullptr) {
 					ctx.setFallback(_function);
 					functions.emplace_back(TVMFunctionCompiler::generateFallback(ctx, _function));
+					entryPoints.insert(functions.back()->name());
 				}
 			} else if (_function->isOnTickTock()) {
 				functions.emplace_back(TVMFunctionCompiler::generateOnTickTock(ctx, _function));
+				entryPoints.insert(functions.back()->name());
 			} else if (_function->name() == "onCodeUpgrade") {
 				if (!ctx.isBaseFunction(_function))
 					functions.emplace_back(TVMFunctionCompiler::generateOnCodeUpgrade(ctx, _function));
@@ -145,12 +358,14 @@ TVMContractCompiler::generateContractCode(
 				if (!ctx.isStdlib() && !ctx.getContract()->isContractLibrary() && _function->isPublic() && !ctx.isBaseFunction(_function)) {
 					if (_function->visibility() == Visibility::Getter) {
 						functions.emplace_back(TVMFunctionCompiler::generateGetterFunction(ctx, _function));
+						entryPoints.insert(functions.back()->name());
 						uint32_t functionId = crc16(_function->name());
 						functionId = (functionId & 0xffff) | 0x10000;
 						bool emplace = getters.emplace(functionId, _function->name()).second;
 						solAssert(emplace, "");
 					} else {
 						functions.emplace_back(TVMFunctionCompiler::generatePublicFunction(ctx, _function));
+						entryPoints.insert(functions.back()->name());
 						uint32_t functionId = ChainDataEncoder::calculateFunctionIDWithReason(_function,
 																					ReasonOfOutboundMessage::RemoteCallInternal);
 
@@ -170,8 +385,10 @@ TVMContractCompiler::generateContractCode(
 		if (contract->externalMsgHeaders())
 			functions.emplace_back(TVMFunctionCompiler::updateOnlyTime(ctx));
 		functions.emplace_back(TVMFunctionCompiler::generateMainInternal(ctx, contract));
+		entryPoints.insert(functions.back()->name());
 		if (contract->externalMsgHeaders()) {
 			functions.emplace_back(TVMFunctionCompiler::generateMainExternal(ctx, contract));
+			entryPoints.insert(functions.back()->name());
 		}
 	}
 
@@ -277,51 +494,72 @@ TVMContractCompiler::generateContractCode(
 	LocSquasher sq;
 	c->accept(sq);
 
-	optimizeCode(c);
+	optimizeCode(c, entryPoints);
 
 	return c;
 }
 
-void TVMContractCompiler::optimizeCode(Pointer<Contract>& c) {
-	DeleterCallX dc;
-	c->accept(dc);
+void TVMContractCompiler::optimizeCode(Pointer<Contract>& c, std::set<std::string> const& entryPoints) {
+	OptimizerStatistics stats;
+
+	// it runs before other passes because ids of private functions are still pushed by PUSHINT
+	stats.measure("DeadFunctionEliminator", [&]() {
+		DeadFunctionEliminator dfe{entryPoints};
+		dfe.eliminate(c);
+		stats.addResult("removed functions", dfe.removedFunctions());
+		stats.addResult("removed private function ids", dfe.removedPrivateFunctions());
+		stats.addResult("removed bytes of private functions", (dfe.removedBits() + 7) / 8);
+	});
+
+	stats.measure("FunctionInliner", [&]() {
+		FunctionInliner inliner{GlobalParams::g_inlineThreshold.value_or(FunctionInliner::defaultThreshold())};
+		inliner.inlineCalls(c);
+		for (auto const& [name, qty] : inliner.inlinedCalls())
+			stats.addResult("inlined calls of " + name, qty);
+	});
+
+	stats.measure("DeleterCallX", [&]() {
+		DeleterCallX dc;
+		c->accept(dc);
+	});
 
 	LogCircuitExpander lce;
-	c->accept(lce);
+	stats.measure("LogCircuitExpander", [&]() { c->accept(lce); });
 
-	{
+	stats.measure("StackOptimizer", [&]() {
 		StackOptimizer opt;
 		c->accept(opt);
-	}
+	});
 
 	lce = LogCircuitExpander{};
-	c->accept(lce);
+	stats.measure("LogCircuitExpander", [&]() { c->accept(lce); });
 
-	for (int i = 0; i < 10; ++i) { // TODO
-		PeepholeOptimizer peepHole{{}};
-		c->accept(peepHole);
-
-		StackOptimizer opt;
-		c->accept(opt);
-	}
+	bool reachedFixpoint = optimizeFunctionsInParallel(c->functions(), stats);
 
 	PeepholeOptimizer peepHole = PeepholeOptimizer{{}};
-	c->accept(peepHole);
+	stats.measure("PeepholeOptimizer", [&]() { c->accept(peepHole); });
 
 	peepHole = PeepholeOptimizer{1 << OptFlags::UnpackOpaque};
-	c->accept(peepHole);
+	stats.measure("PeepholeOptimizer", [&]() { c->accept(peepHole); });
 
 	peepHole = PeepholeOptimizer{(1 << OptFlags::UnpackOpaque) | (1 << OptFlags::UseCompoundOpcodes)};
-	c->accept(peepHole);
+	stats.measure("PeepholeOptimizer", [&]() { c->accept(peepHole); });
 
 	peepHole = PeepholeOptimizer{(1 << OptFlags::OptimizeSlice) | (1 << OptFlags::UseCompoundOpcodes)};
-	c->accept(peepHole);
+	stats.measure("PeepholeOptimizer", [&]() { c->accept(peepHole); });
 
-	LocSquasher sq = LocSquasher{};
-	c->accept(sq);
+	stats.measure("LocSquasher", [&]() {
+		LocSquasher sq = LocSquasher{};
+		c->accept(sq);
+	});
 
-	SizeOptimizer so{};
-	so.optimize(c);
+	stats.measure("SizeOptimizer", [&]() {
+		SizeOptimizer so{};
+		so.optimize(c);
+	});
+
+	if (GlobalParams::g_printOptimizerStats)
+		stats.print(std::cerr, reachedFixpoint);
 }
 
 void TVMContractCompiler::fillInlineFunctions(TVMCompilerContext &ctx, ContractDefinition const *contract, std::vector<ASTPointer<SourceUnit>>const& _sourceUnits) {
@@ -361,3 +599,41 @@ void TVMContractCompiler::fillInlineFunctions(TVMCompilerContext &ctx, ContractD
 	}
 }
 
+Json::Value TVMContractCompiler::generateGasReport(
+	ContractDefinition const& contract,
+	Contract const& code,
+	PragmaDirectiveHelper const& pragmaHelper
+) {
+	GasEstimator estimator{code};
+	auto toJson = [&](std::string const& name, Json::Value const& id) {
+		GasCost const cost = estimator.functionCost(name);
+		Json::Value item(Json::objectValue);
+		item["id"] = id;
+		// null values mean that the function always throws an exception or max gas is unbounded
+		item["min"] = cost.reachable ? Json::Value(Json::Int64{cost.min}) : Json::Value::null;
+		item["typical"] = cost.reachable ? Json::Value(Json::Int64{cost.typical}) : Json::Value::null;
+		item["max"] = cost.reachable && cost.max != GasCost::Unbounded ? Json::Value(Json::Int64{cost.max}) : Json::Value::null;
+		return item;
+	};
+
+	Json::Value report(Json::objectValue);
+	Json::Value const functionIds = TVMABI::generateFunctionIdsJson(contract, pragmaHelper);
+	for (std::string const& name : functionIds.getMemberNames())
+		if (estimator.hasFunction(name))
+			report[name] = toJson(name, functionIds[name]);
+	for (auto const& [id, name] : code.getters()) {
+		std::stringstream ss;
+		ss << "0x" << std::hex << std::setfill('0') << std::setw(8) << id;
+		if (estimator.hasFunction(name))
+			report[name] = toJson(name, ss.str());
+	}
+	return report;
+}
+
+void TVMContractCompiler::printGasReport(
+	ContractDefinition const& contract,
+	Contract const& code,
+	PragmaDirectiveHelper const& pragmaHelper
+) {
+	cout << generateGasReport(contract, code, pragmaHelper) << endl;
+}
@@ -38,7 +38,7 @@ public:
 		std::vector<ASTPointer<SourceUnit>> const& _sourceUnits,
 		std::vector<PragmaDirective const *> const& pragmaDirectives
 	);
-	static void generateCodeAndSaveToFile(
+	static Pointer<Contract> generateCodeAndSaveToFile(
 		std::string const& fileName,
 		ContractDefinition const& contract,
 		std::vector<ASTPointer<SourceUnit>> const& _sourceUnits,
@@ -49,7 +49,17 @@ public:
 		std::vector<ASTPointer<SourceUnit>>const& _sourceUnits,
 		PragmaDirectiveHelper const& pragmaHelper
 	);
-	static void optimizeCode(Pointer<Contract>& c);
+	static void optimizeCode(Pointer<Contract>& c, std::set<std::string> const& entryPoints);
+	static Json::Value generateGasReport(
+		ContractDefinition const& contract,
+		Contract const& code,
+		PragmaDirectiveHelper const& pragmaHelper
+	);
+	static void printGasReport(
+		ContractDefinition const& contract,
+		Contract const& code,
+		PragmaDirectiveHelper const& pragmaHelper
+	);
 private:
 	static void fillInlineFunctions(TVMCompilerContext& ctx, ContractDefinition const* contract, std::vector<ASTPointer<SourceUnit>>const& _sourceUnits);
 };
@@ -1224,6 +1224,29 @@ bool isOptionalGet(Expression const* expr) {
 bool isStackTop(Expression const* expr) {
 	return isFunctionKind(expr, FunctionType::Kind::TVMStackTop);
 }
+
+// Returns the bit length of the encoded value if it's stored without references and its length doesn't depend on
+// the value, see AbiV2Position
+std::optional<int> fixedBitLength(Type const* type) {
+	if (auto structType = to<StructType>(type)) {
+		int bits = 0;
+		for (ASTPointer<VariableDeclaration> const& member : structType->structDefinition().members()) {
+			std::optional<int> memberBits = fixedBitLength(member->type());
+			if (!memberBits)
+				return std::nullopt;
+			bits += *memberBits;
+		}
+		return bits;
+	}
+	if (auto userDefType = to<UserDefinedValueType>(type))
+		return fixedBitLength(&userDefType->underlyingType());
+	if (!isIn(type->category(), Type::Category::Integer, Type::Category::Bool, Type::Category::Enum,
+		Type::Category::FixedBytes, Type::Category::FixedPoint))
+		return std::nullopt;
+	ABITypeSize size{type};
+	solAssert(size.fixedSize && size.maxRefs == 0, "");
+	return size.maxBits;
+}
 }
 
 LValueInfo
@@ -1423,12 +1446,129 @@ TVMExpressionCompiler::collectLValue(
 }
 
 
+bool TVMExpressionCompiler::tryAssignMemberOfStructInMapping(Assignment const& _assignment) {
+	// m[k].member (op)= value
+	// The encoded struct is split around the member instead of decoding and encoding the whole struct.
+	const auto& lhs = _assignment.leftHandSide();
+	const auto& rhs = _assignment.rightHandSide();
+	const Token op = _assignment.assignmentOperator();
+
+	std::vector<MemberAccess const*> members;
+	Expression const* expr = &lhs;
+	while (auto memberAccess = to<MemberAccess>(expr)) {
+		if (getType(&memberAccess->expression())->category() != Type::Category::Struct)
+			return false;
+		members.push_back(memberAccess);
+		expr = &memberAccess->expression();
+	}
+	auto index = to<IndexAccess>(expr);
+	if (members.empty() || index == nullptr ||
+		getType(&index->baseExpression())->category() != Type::Category::Mapping)
+		return false;
+	std::reverse(members.begin(), members.end());
+
+	Type const* keyType = StackPusher::parseIndexType(getType(&index->baseExpression()));
+	Type const* valueType = getType(index);
+	if (isCurrentResultNeeded() ||
+		m_pusher.doesDictStoreValueInRef(keyType, valueType) ||
+		ABITypeSize{valueType}.maxRefs > 4)
+		return false;
+
+	// bit offset of the member in the encoded struct
+	int offset = 0;
+	for (MemberAccess const* memberAccess : members) {
+		auto structType = to<StructType>(getType(&memberAccess->expression()));
+		for (ASTPointer<VariableDeclaration> const& member : structType->structDefinition().members()) {
+			if (member->name() == memberAccess->memberName())
+				break;
+			std::optional<int> bits = fixedBitLength(member->type());
+			if (!bits)
+				return false;
+			offset += *bits;
+		}
+	}
+	Type const* memberType = getType(&lhs);
+	std::optional<int> const memberBits = fixedBitLength(memberType);
+	if (!memberBits || isIn(memberType->category(), Type::Category::Struct, Type::Category::UserDefinedValueType))
+		return false;
+
+	const int stackSize = m_pusher.stackSize();
+	compileNewExpr(&rhs); // r
+	m_pusher.convert(getType(&lhs), getType(&rhs));
+	const LValueInfo lValueInfo = expandLValue(&index->baseExpression(), true); // r expanded... dict
+	pushIndexAndConvert(*index); // r expanded... dict key
+	m_pusher.prepareKeyForDictOperations(index->indexExpression()->annotation().type, false);
+	m_pusher.exchange(1); // r expanded... key dict
+	const int expandedSize = m_pusher.stackSize() - stackSize - 1;
+
+	m_pusher.pushS2(1, 0);
+	m_pusher.pushInt(dictKeyLength(keyType));
+	m_pusher.startOpaque();
+	m_pusher.pushAsym("DICT" + typeToDictChar(keyType) + "GET");
+	m_pusher.startContinuation();
+	DataType const defaultType = m_pusher.pushDefaultValueForDict(keyType, valueType);
+	solAssert(defaultType == DataType::Slice, "");
+	m_pusher.endContinuation();
+	m_pusher.ifNot();
+	m_pusher.endOpaque(3, 1);
+	// r expanded... slice
+
+	int parts = 1;
+	if (offset > 0) {
+		if (offset <= 256)
+			m_pusher << "LDSLICE " + toString(offset);
+		else {
+			m_pusher.pushInt(offset);
+			m_pusher << "LDSLICEX";
+		}
+		++parts;
+	}
+	// r expanded... [prefix] slice
+	if (op == Token::Assign) {
+		m_pusher.pushInt(*memberBits);
+		m_pusher << "SDSKIPFIRST";
+		// r expanded... [prefix] suffix
+		m_pusher.blockSwap(1, expandedSize + parts);
+		// expanded... [prefix] suffix r
+	} else {
+		Type const* commonType = getType(&lhs);
+		m_pusher.load(memberType, true);
+		// r expanded... [prefix] suffix l
+		m_pusher.convert(commonType, memberType);
+		m_pusher.blockSwap(1, expandedSize + parts + 1);
+		// expanded... [prefix] suffix l r
+		visitMathBinaryOperation(TokenTraits::AssignmentToBinaryOp(op), memberType, getType(&rhs), commonType,
+								 nullopt, nullptr, nullopt);
+		// expanded... [prefix] suffix res
+	}
+
+	if (offset > 0) {
+		m_pusher.rot(); // expanded... suffix value prefix
+		m_pusher << "NEWC";
+		m_pusher << "STSLICE";
+	} else {
+		m_pusher << "NEWC";
+	}
+	// expanded... suffix value builder
+	m_pusher.store(memberType);
+	m_pusher << "STSLICE";
+	// expanded... key dict builder
+	m_pusher.rotRev(); // expanded... builder key dict
+	m_pusher.setDict(*keyType, *valueType, DataType::Builder); // expanded... dict'
+	collectLValue(lValueInfo, true);
+	solAssert(stackSize == m_pusher.stackSize(), "");
+	return true;
+}
+
 bool TVMExpressionCompiler::tryAssignLValue(Assignment const &_assignment) {
 	const auto& lhs = _assignment.leftHandSide();
 	const auto& rhs = _assignment.rightHandSide();
 	const Token op  = _assignment.assignmentOperator();
 	Token binOp = op == Token::Assign ? op : TokenTraits::AssignmentToBinaryOp(op);
 
+	if (tryAssignMemberOfStructInMapping(_assignment))
+		return true;
+
 	if (op == Token::Assign) {
 		auto push_rhs = [&] () {
 			compileNewExpr(&rhs);
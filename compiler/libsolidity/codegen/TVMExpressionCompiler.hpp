@@ -90,6 +90,7 @@ protected:
 	static void unrollTuple(Type const* type, TypePointers& result);
 	void assignTuple(Expression const* lhs, const TypePointers &right, int& index);
 	bool tryAssignLValue(Assignment const& _assignment);
+	bool tryAssignMemberOfStructInMapping(Assignment const& _assignment);
 	bool tryAssignTuple(Assignment const& _assignment);
 	void visit2(Assignment const& _assignment);
 	void pushIndexAndConvert(IndexAccess const& indexAccess);
@@ -347,7 +347,9 @@ void FunctionCallCompiler::mappingKeysOrValues(bool areKeys) {
 	Type const* mapKeyType{};
 	Type const* mapValueType{};
 	std::tie(mapKeyType, mapValueType) = realDictKeyValue(m_memberAccess->expression().annotation().type);
-	DictMinMax compiler{m_pusher, *mapKeyType, *mapValueType, true};
+	// values aren't decoded for keys
+	Type const* iterValueType = areKeys ? TypeProvider::tvmslice() : mapValueType;
+	DictMinMax compiler{m_pusher, *mapKeyType, *iterValueType, true};
 	compiler.minOrMax();
 	// array map minPair
 
@@ -386,9 +388,8 @@ void FunctionCallCompiler::mappingKeysOrValues(bool areKeys) {
 	// array' map curKey map
 	m_pusher.pushInt(dictKeyLength(mapKeyType));
 	// array' map curKey map nbits
-	DictPrevNext dictPrevNext{m_pusher, *mapKeyType, *mapValueType, "next"};
+	DictPrevNext dictPrevNext{m_pusher, *mapKeyType, *iterValueType, "next"};
 	dictPrevNext.prevNext();
-	// TODO don't parse value for keys
 	// array' map nextPair
 	m_pusher.endContinuation();
 
@@ -3909,34 +3910,12 @@ void FunctionCallCompiler::honestArrayCreation(bool onlyDict) {
 	Type const* arrayBaseType = arrayType->baseType();
 
 	pushArgAndConvert(0); // N
-	DataType const& dataType = m_pusher.pushDefaultValueForDict(&key, arrayBaseType); // N value
-	m_pusher.pushInt(0);   // N value iter
-	m_pusher << "NULL"; // N value iter dict
-	m_pusher.pushS(3);     // N value iter dict N
-
-	solAssert(stackSize + 5 == m_pusher.stackSize(), "");
-	m_pusher.fixStack(-1); // fix stack: drop replay iterator
-	solAssert(stackSize + 4 == m_pusher.stackSize(), "");
-	{
-		// N value iter dict
-		m_pusher.startContinuation();
-		m_pusher.pushS(2);    // N value iter dict value
-		m_pusher.pushS(2);    // N value iter dict value iter
-		m_pusher << "INC";    // N value iter dict value iter++
-		m_pusher.exchange(3); // N value iter++ dict value iter
-		m_pusher.rot();       // N value iter++ value iter dict
-		m_pusher.setDict(key, *arrayType->baseType(), dataType); // N value iter++ dict'
-		m_pusher.endContinuation();
-	}
-	m_pusher.repeat(false);
-	solAssert(stackSize + 4 == m_pusher.stackSize(), "");
-	// N value iter dict
-	if (onlyDict) {
-		m_pusher.dropUnder(3, 1); // dict
-	} else {
-		m_pusher.dropUnder(2, 1); // N dict
+	if (!onlyDict)
+		m_pusher.pushS(0); // N N
+	DataType dataType = m_pusher.pushDefaultValueForDict(&key, arrayBaseType); // N value
+	m_pusher.makeArrayDictOfSameValues(dataType); // dict
+	if (!onlyDict)
 		m_pusher << "TUPLE 2";
-	}
 	solAssert(stackSize + 1 == m_pusher.stackSize(), "");
 }
 
@@ -15,6 +15,7 @@
  */
 
 #include <tuple>
+#include <cmath>
 #include <numeric>
 #include <boost/algorithm/string/replace.hpp>
 
@@ -509,10 +510,33 @@ TVMFunctionCompiler::generateGetter(StackPusher &pusher, VariableDeclaration con
 }
 
 void TVMFunctionCompiler::generatePublicFunctionSelector(bool const isExternal) const {
-	const auto functions = isExternal ?
-		m_pusher.ctx().getExtPublicFunctions() :
-		m_pusher.ctx().getIntPublicFunctions();
+	PublicFunctionSelector const pfs{
+		isExternal ?
+			m_pusher.ctx().getExtPublicFunctions() :
+			m_pusher.ctx().getIntPublicFunctions(),
+		GlobalParams::g_functionProfile,
+		GlobalParams::g_compareFunctionIds
+	};
+	// the report is a part of the optimizer statistics, so nothing is written to stderr by default,
+	// e.g. when the compiler is used as a library
+	if (GlobalParams::g_printOptimizerStats && !GlobalParams::g_functionProfile.empty())
+		pfs.printReport(std::cerr, m_pusher.ctx().getContract()->name() + (isExternal ? " external" : " internal"));
 
+	// body' funcId
+	for (const auto& [functionId, name] : pfs.hotFunctions()) {
+		m_pusher.pushS(0);
+		m_pusher.pushInt(functionId);
+		m_pusher << "EQUAL";
+		m_pusher.fixStack(-1); // fix stack
+		m_pusher.startContinuation();
+		m_pusher.drop(); // drop funcId
+		m_pusher.pushFragment(0, 0, name);
+		m_pusher.endContinuationFromRef();
+		m_pusher.fixStack(+1); // fix stack
+		m_pusher.ifJmp();
+	}
+
+	const auto& functions = pfs.dictFunctions();
 	if (functions.empty()) {
 		m_pusher.fixStack(+1); // fix stack
 		m_pusher.drop();
@@ -529,11 +553,6 @@ void TVMFunctionCompiler::generatePublicFunctionSelector(bool const isExternal)
 		lines.emplace_back("DICTUGETJMP");
 		m_pusher.push(createNode<HardCode>(lines, 1, 1, false));
 	}
-
-	// TVMFunctionCompiler compiler{pusher, contract};
-	// PublicFunctionSelector pfs{int(functions.size())};
-	// compiler.buildPublicFunctionSelector(functions, 0, functions.size(), pfs);
-	// return createNode<Function>(1, 1, name, nullopt, Function::FunctionType::Fragment, m_pusher.getBlock());
 }
 
 Pointer<Function> TVMFunctionCompiler::generateLibFunctionWithObject(
@@ -1197,14 +1216,29 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 	// private key (not visible in solidity code)
 	// [return flag] - optional. If have return/break/continue.
 
+	// `for (k : m.keys())` and `for (v : m.values())` iterate over the mapping without building the array.
+
 	const int saveStackSize = m_pusher.stackSize();
+	Expression const* rangeExpression = _forStatement.rangeExpression();
+	std::optional<bool> iterateKeys;
+	if (auto funCall = to<FunctionCall>(rangeExpression)) {
+		auto memberAccess = to<MemberAccess>(&funCall->expression());
+		if (memberAccess && to<MappingType>(memberAccess->expression().annotation().type) &&
+			isIn(memberAccess->memberName(), "keys", "values")
+		) {
+			rangeExpression = &memberAccess->expression();
+			iterateKeys = memberAccess->memberName() == "keys";
+		}
+	}
 	TVMExpressionCompiler ec{m_pusher};
-	ec.acceptExpr(_forStatement.rangeExpression(), true); // stack: dict
+	ec.acceptExpr(rangeExpression, true); // stack: dict
 
 	// init
-	auto arrayType = to<ArrayType>(_forStatement.rangeExpression()->annotation().type);
-	auto mappingType = to<MappingType>(_forStatement.rangeExpression()->annotation().type);
+	auto arrayType = to<ArrayType>(rangeExpression->annotation().type);
+	auto mappingType = to<MappingType>(rangeExpression->annotation().type);
 	auto vds = to<VariableDeclarationStatement>(_forStatement.rangeDeclaration());
+	// values of the mapping aren't decoded if they aren't used
+	Type const* mappingValueType{};
 	int loopVarQty{};
 	if (arrayType) {
 		solAssert(vds->declarations().size() == 1, "");
@@ -1222,15 +1256,27 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 		m_pusher.getStack().add(iterVar, false);
 		// stack: dict 0 value
 	} else if (mappingType) {
+		VariableDeclaration const* iterKey{};
+		VariableDeclaration const* iterVal{};
+		if (!iterateKeys) {
+			iterKey = vds->declarations().at(0).get();
+			iterVal = vds->declarations().at(1).get();
+		} else if (*iterateKeys) {
+			solAssert(vds->declarations().size() == 1, "");
+			iterKey = vds->declarations().at(0).get();
+		} else {
+			solAssert(vds->declarations().size() == 1, "");
+			iterVal = vds->declarations().at(0).get();
+		}
+		mappingValueType = iterVal == nullptr ? TypeProvider::tvmslice() : mappingType->valueType();
+
 		// stack: dict
 		m_pusher.pushS(0); // stack: dict dict
-		DictMinMax dictMinMax{m_pusher, *mappingType->keyType(), *mappingType->valueType(), true};
+		DictMinMax dictMinMax{m_pusher, *mappingType->keyType(), *mappingValueType, true};
 		dictMinMax.minOrMax(true);
 		// stack: dict minKey(private) minKey(pub) value
 
 		m_pusher.fixStack(-2); // fix stack
-		auto iterKey = vds->declarations().at(0).get();
-		auto iterVal = vds->declarations().at(1).get();
 		if (iterKey == nullptr)
 			m_pusher.fixStack(+1);
 		else
@@ -1334,7 +1380,7 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 			m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 1); // stack: dict minKey(private) minKey(pub) value [flag] minKey dict
 			m_pusher.pushInt(dictKeyLength(mappingType->keyType()));  // stack: dict minKey(private) minKey(pub) value [flag] minKey dict nbits
 
-			DictPrevNext dictPrevNext{m_pusher, *mappingType->keyType(), *mappingType->valueType(), "next"};
+			DictPrevNext dictPrevNext{m_pusher, *mappingType->keyType(), *mappingValueType, "next"};
 			dictPrevNext.prevNext(true);
 
 			// stack: dict minKey(private) minKey(pub) value [flag] minKey(private) minKey(pub) value
@@ -1897,16 +1943,95 @@ void TVMFunctionCompiler::pushC4ToC7IfNeed() const {
 			m_pusher.endContinuationFromRef();
 			m_pusher._if();
 		} else if (!m_function->isExternalMsg()) { // only internal messages
-			m_pusher.pushFragmentInCallRef(0, 0, "c4_to_c7");
+			if (std::optional<std::set<VariableDeclaration const*>> vars = lazyLoadedStateVariables())
+				pushC4ToC7ForVariables(*vars);
+			else
+				m_pusher.pushFragmentInCallRef(0, 0, "c4_to_c7");
 		}
 	}
 }
 
+// Returns state variables used by the function if it's enough to decode only them from c4
+std::optional<std::set<VariableDeclaration const*>> TVMFunctionCompiler::lazyLoadedStateVariables() const {
+	StorageLayout const& layout = m_pusher.ctx().storageLayout();
+	// c7_to_c4 saves all state variables, so only view functions can leave some of them not decoded
+	if (!GlobalParams::g_lazyStateLoading ||
+		m_function->stateMutability() != StateMutability::View ||
+		layout.tooMuchStateVariables() ||
+		!layout.unpackedStateVariables().empty()
+	)
+		return std::nullopt;
+
+	StateVariableUsageScanner scanner{*m_pusher.ctx().getContract(), *m_function};
+	if (scanner.usesAllStateVariables())
+		return std::nullopt;
+	std::set<VariableDeclaration const*> const& usedVars = scanner.stateVariables();
+	std::vector<VariableDeclaration const*> const stateVars = layout.usualStateVariables();
+	bool const usesAll = std::all_of(stateVars.begin(), stateVars.end(), [&](VariableDeclaration const* var) {
+		return usedVars.count(var) != 0;
+	});
+	if (usesAll)
+		return std::nullopt; // c4_to_c7 does the same and its cell is shared between functions
+	return usedVars;
+}
+
+// The same as c4_to_c7, but it skips the state variables that are not used
+void TVMFunctionCompiler::pushC4ToC7ForVariables(std::set<VariableDeclaration const*> const& usedVars) const {
+	StorageLayout const& layout = m_pusher.ctx().storageLayout();
+	std::vector<VariableDeclaration const*> const stateVars = layout.usualStateVariables();
+	std::vector<Type const*> const stateVarTypes = getTypesFromVarDecls(stateVars);
+	std::vector<bool> varNeeded(stateVars.size());
+	std::vector<VariableDeclaration const*> neededVars;
+	for (size_t i = 0; i < stateVars.size(); ++i) {
+		varNeeded[i] = usedVars.count(stateVars[i]) != 0;
+		if (varNeeded[i])
+			neededVars.emplace_back(stateVars[i]);
+	}
+
+	m_pusher.startContinuation();
+	const int startStackSize = m_pusher.stackSize();
+	m_pusher.pushRoot();
+	m_pusher << "CTOS";
+	if (layout.storePubkeyInC4())
+		m_pusher << "LDU 256      ; pubkey c4";
+	if (layout.storeTimestampInC4())
+		m_pusher << "LDU 64       ; pubkey timestamp c4";
+	if (layout.hasConstructor())
+		m_pusher << "LDU 1      ; ctor flag";
+
+	if (neededVars.empty()) {
+		m_pusher.drop();
+	} else {
+		UnpackedCoderDecoder decoder{m_pusher, layout.getOffsetC4(), 0, 0, stateVarTypes, varNeeded};
+		decoder.unpackedData();
+	}
+	for (VariableDeclaration const* var : layout.nostorageStateVars()) {
+		if (usedVars.count(var)) {
+			m_pusher.pushDefaultValue(var->type());
+			m_pusher.setGlob(var);
+		}
+	}
+	for (VariableDeclaration const* var : neededVars | boost::adaptors::reversed)
+		m_pusher.setGlob(var);
+
+	if (layout.hasConstructor())
+		m_pusher.setGlob(TvmConst::C7::ConstructorFlag);
+	if (layout.storeTimestampInC4())
+		m_pusher.setGlob(TvmConst::C7::ReplayProtTime);
+	if (layout.storePubkeyInC4())
+		m_pusher.setGlob(TvmConst::C7::TvmPubkey);
+	solAssert(startStackSize == m_pusher.stackSize(), "");
+	m_pusher.pushRefContAndCallX(0, 0, false);
+}
+
 void TVMFunctionCompiler::updC4IfItNeeds() const {
 	// c7_to_c4 if need
 	//	solAssert(m_pusher.stackSize() == 0, "");
 	if (m_function->stateMutability() == StateMutability::NonPayable) {
-		m_pusher.pushFragmentInCallRef(0, 0, "c7_to_c4");
+		if (std::optional<std::set<VariableDeclaration const*>> vars = savedStateVariables())
+			pushC7ToC4ForVariables(*vars);
+		else
+			m_pusher.pushFragmentInCallRef(0, 0, "c7_to_c4");
 	} else if (m_function->isExternalMsg()) {
 	    // if it's external message, then we save values for replay protection
 
@@ -1939,6 +2064,81 @@ void TVMFunctionCompiler::updC4IfItNeeds() const {
 	}
 }
 
+// Returns state variables that can be changed by the function if it's enough to re-encode only them in c4
+std::optional<std::set<VariableDeclaration const*>> TVMFunctionCompiler::savedStateVariables() const {
+	StorageLayout const& layout = m_pusher.ctx().storageLayout();
+	// external messages update the replay protection timestamp,
+	// the constructor sets the constructor flag
+	if (!GlobalParams::g_partialStateSaving ||
+		m_function->isExternalMsg() ||
+		m_function->isConstructor() ||
+		layout.tooMuchStateVariables() ||
+		!layout.unpackedStateVariables().empty()
+	)
+		return std::nullopt;
+
+	StateVariableUsageScanner scanner{*m_pusher.ctx().getContract(), *m_function};
+	if (scanner.writesAllStateVariables())
+		return std::nullopt;
+	std::set<VariableDeclaration const*> const& writtenVars = scanner.writtenStateVariables();
+	std::vector<VariableDeclaration const*> const stateVars = layout.usualStateVariables();
+	bool const writesAll = std::all_of(stateVars.begin(), stateVars.end(), [&](VariableDeclaration const* var) {
+		return writtenVars.count(var) != 0;
+	});
+	if (writesAll)
+		return std::nullopt; // c7_to_c4 does the same and its cell is shared between functions
+	return writtenVars;
+}
+
+// The same as c7_to_c4, but it keeps the encoded values of the state variables that are not changed
+void TVMFunctionCompiler::pushC7ToC4ForVariables(std::set<VariableDeclaration const*> const& changedVars) const {
+	StorageLayout const& layout = m_pusher.ctx().storageLayout();
+	std::vector<VariableDeclaration const*> const stateVars = layout.usualStateVariables();
+	std::vector<Type const*> const stateVarTypes = getTypesFromVarDecls(stateVars);
+	std::vector<bool> varNeeded(stateVars.size());
+	std::map<int, std::function<void()>> varIndexToPush;
+	for (size_t i = 0; i < stateVars.size(); ++i) {
+		varNeeded[i] = changedVars.count(stateVars[i]) != 0;
+		if (varNeeded[i]) {
+			VariableDeclaration const* var = stateVars[i];
+			varIndexToPush[i] = [this, var] {
+				m_pusher.getGlob(var);
+			};
+		}
+	}
+	if (varIndexToPush.empty())
+		return; // c4 isn't changed
+
+	m_pusher.startContinuation();
+	const int startStackSize = m_pusher.stackSize();
+	int const offset = layout.getOffsetC4();
+	m_pusher.pushRoot();
+	m_pusher << "CTOS";
+	if (offset != 0) {
+		// pubkey, timestamp and constructor flag are not changed
+		m_pusher.pushInt(offset);
+		m_pusher << "LDSLICEX";
+		// header data
+	}
+	UnpackedCoderDecoder decoder{m_pusher, offset, 0, 0, stateVarTypes, varNeeded};
+	decoder.packData(varIndexToPush);
+	if (offset != 0) {
+		// header data
+		m_pusher << "NEWC";
+		m_pusher.rot();
+		// data builder header
+		m_pusher << "STSLICER"
+				<< "STSLICE";
+	} else {
+		m_pusher << "NEWC"
+				<< "STSLICE";
+	}
+	m_pusher << "ENDC";
+	m_pusher.popRoot();
+	solAssert(startStackSize == m_pusher.stackSize(), "");
+	m_pusher.pushRefContAndCallX(0, 0, false);
+}
+
 void TVMFunctionCompiler::pushReceiveOrFallbackAndLoadFuncId() {
 	// stack: ... body 0 (internal msg selector)
 	bool const hasReceive = !isEmptyFunction(m_contract->receiveFunction());
@@ -1992,45 +2192,6 @@ void TVMFunctionCompiler::pushReceiveOrFallbackAndLoadFuncId() {
 	}
 }
 
-void TVMFunctionCompiler::buildPublicFunctionSelector(
-	const std::vector<std::pair<uint32_t, std::string>>& functions,
-	int left,
-	int right,
-	PublicFunctionSelector const& pfs
-) {
-	auto pushOne = [&](uint32_t functionId, const std::string& name) {
-		m_pusher.pushS(0);
-		m_pusher.pushInt(functionId);
-		m_pusher << "EQUAL";
-		m_pusher.fixStack(-1); // fix stack
-		m_pusher.startContinuation();
-		m_pusher.pushFragment(0, 0, name);
-		m_pusher.endContinuationFromRef();
-		m_pusher.ifJmp();
-	};
-
-	int const n = right - left;
-	std::vector<int> const& sizes = pfs.groupSizes(n);
-	int pos = left;
-	for (int const groupSize : sizes) {
-		if (groupSize == 1) {
-			const auto& [functionId, name] = functions.at(pos);
-			pushOne(functionId, name);
-		} else {
-			const auto& [functionId, name] = functions.at(pos + groupSize - 1);
-			m_pusher.pushS(0);
-			m_pusher.pushInt(functionId);
-			m_pusher << "LEQ";
-			m_pusher.startContinuation();
-			buildPublicFunctionSelector(functions, pos, pos + groupSize, pfs);
-			m_pusher.endContinuationFromRef();
-			m_pusher.ifJmp();
-
-		}
-		pos += groupSize;
-	}
-}
-
 void TVMFunctionCompiler::pushLocation(const ASTNode& node, bool reset) {
 	SourceReference sr = SourceReferenceExtractor::extract(*GlobalParams::g_charStreamProvider, &node.location());
 	const int line = reset ? 0 : sr.position.line + 1;
@@ -2177,56 +2338,88 @@ void TVMConstructorCompiler::beginConstructor() {
 	m_pusher._throw("THROWIF " + toString(TvmConst::RuntimeException::ConstructorIsCalledTwice));
 }
 
-PublicFunctionSelector::PublicFunctionSelector(int _n) {
-	maxPath = vector<int>(_n + 1, INF);
-	sumPaths = vector<int>(_n + 1, INF);
-	prev = vector<vector<int>>(_n + 1);
-	maxPath[0] = INF;
-	for (int n = 1; n <= _n; ++n) {
-		maxPath[n] = INF;
-		dfs(0, n);
+PublicFunctionSelector::PublicFunctionSelector(
+	std::vector<std::pair<uint32_t, std::string>> const& functions,
+	std::map<uint32_t, double> const& profile,
+	bool uniform
+) {
+	double total = 0;
+	for (auto const& [id, name] : functions)
+		if (profile.count(id))
+			total += profile.at(id);
+	// The dictionary is smaller, so it's always used for `--optimize-for size`.
+	uniform = uniform && total == 0 && GlobalParams::g_optimizeFor != OptimizationObjective::Size;
+
+	// (frequency, index) of the functions that are called at least once, the most frequent first
+	std::vector<std::pair<double, size_t>> sorted;
+	for (size_t i = 0; i < functions.size(); ++i) {
+		uint32_t const id = functions[i].first;
+		double frequency = 0;
+		if (uniform)
+			frequency = 1.0 / functions.size();
+		else if (total > 0 && profile.count(id))
+			frequency = profile.at(id) / total;
+		m_frequency[id] = frequency;
+		if (frequency > 0)
+			sorted.emplace_back(frequency, i);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) {
+		return a.first > b.first;
+	});
+
+	size_t hotQty = 0;
+	m_dictOnlyGas = expectedGas(sorted, 0);
+	m_expectedGas = m_dictOnlyGas;
+	for (size_t k = 1; k <= sorted.size(); ++k) {
+		double const gas = expectedGas(sorted, k);
+		if (gas < m_expectedGas) {
+			m_expectedGas = gas;
+			hotQty = k;
+		}
+	}
+
+	std::set<size_t> hot;
+	for (size_t k = 0; k < hotQty; ++k) {
+		hot.insert(sorted.at(k).second);
+		m_hotFunctions.emplace_back(functions.at(sorted.at(k).second));
+	}
+	for (size_t i = 0; i < functions.size(); ++i)
+		if (!hot.count(i))
+			m_dictFunctions.emplace_back(functions[i]);
+}
+
+double PublicFunctionSelector::expectedGas(std::vector<std::pair<double, size_t>> const& sorted, size_t hotQty) const {
+	size_t const n = m_frequency.size();
+	if (sorted.empty())
+		return dictLookupGas(n);
+	double gas = 0;
+	double hotFrequency = 0;
+	for (size_t i = 0; i < hotQty; ++i) {
+		gas += sorted.at(i).first * (FAIL_JMP * i + OK_JMP);
+		hotFrequency += sorted.at(i).first;
 	}
-	//for (int n = 1; n <= _n; ++n)  cout
-	//	<< std::setw(2) << n << ": "
-	//	<< std::setw(4) << int(double(sumPaths[n]) / n) << " "
-	//	<< std::setw(4) << maxPath[n]
-	//	<< endl;
+	double const rest = std::max(0.0, 1.0 - hotFrequency);
+	gas += rest * (FAIL_JMP * hotQty + (hotQty < n ? dictLookupGas(n - hotQty) : 0));
+	return gas;
 }
 
-void PublicFunctionSelector::dfs(int pos, int n) {
-	if (curGroupSize.size() > 4)
-		return;
-	int curSum = std::accumulate(curGroupSize.begin(), curGroupSize.end(), 0);
-	if (curSum > n)
-		return;
+double PublicFunctionSelector::dictLookupGas(size_t n) {
+	// a leaf of the dictionary with n keys is log2(n) + 1 cells deep on average
+	double const depth = std::log2(std::max<size_t>(n, 1)) + 1;
+	return 34 + 26 + 100 * depth; // DICTPUSHCONST / DICTUGETJMP / loading of cells
+}
 
-	if (curSum == n) {
-		int curMaxPath = 0;
-		int curSumPath = 0;
-		for (int i = 0; i < int(curGroupSize.size()); ++i) {
-			int giSize = curGroupSize.at(i);
-			if (giSize == 1) {
-				curMaxPath = max(curMaxPath, FAIL_JMP * i + OK_JMP);
-				curSumPath += FAIL_JMP * i + OK_JMP;
-			} else {
-				curMaxPath = max(curMaxPath, FAIL_JMP * i + OK_JMP + maxPath.at(giSize));
-				curSumPath += (FAIL_JMP * i + OK_JMP) * giSize + sumPaths.at(giSize);
-			}
-		}
-		if (maxPath[n] > curMaxPath || (maxPath[n] == curMaxPath && sumPaths[n] > curSumPath)) {
-			maxPath[n] = curMaxPath;
-			sumPaths[n] = curSumPath;
-			prev[n] = curGroupSize;
-		}
-	} else if (pos < int(curGroupSize.size())) {
-		++curGroupSize[pos];
-		dfs(pos, n);
-		dfs(pos + 1, n);
-		--curGroupSize[pos];
-	} else {
-		curGroupSize.push_back(1);
-		dfs(pos, n);
-		dfs(pos + 1, n);
-		curGroupSize.pop_back();
+void PublicFunctionSelector::printReport(std::ostream& out, std::string const& selectorName) const {
+	out << selectorName << " function selector: "
+		<< m_hotFunctions.size() << " hot function(s), "
+		<< m_dictFunctions.size() << " function(s) in the dictionary" << std::endl;
+	size_t i = 0;
+	for (auto const& [id, name] : m_hotFunctions) {
+		out << "  " << name << " (frequency " << m_frequency.at(id) << "): "
+			<< FAIL_JMP * i + OK_JMP << " gas" << std::endl;
+		++i;
 	}
+	if (!m_dictFunctions.empty())
+		out << "  other functions: " << FAIL_JMP * m_hotFunctions.size() + dictLookupGas(m_dictFunctions.size()) << " gas" << std::endl;
+	out << "  expected gas: " << m_expectedGas << " (" << m_dictOnlyGas << " without hot functions)" << std::endl;
 }
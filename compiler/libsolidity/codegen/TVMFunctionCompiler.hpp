@@ -20,8 +20,6 @@
 
 namespace solidity::frontend {
 
-class PublicFunctionSelector;
-
 class TVMFunctionCompiler: public ASTConstVisitor, private boost::noncopyable
 {
 protected:
@@ -122,11 +120,13 @@ private:
 	void pushMsgPubkey();
 	void checkSignatureAndReadPublicKey();
 	void pushC4ToC7IfNeed() const;
+	std::optional<std::set<VariableDeclaration const*>> lazyLoadedStateVariables() const;
+	void pushC4ToC7ForVariables(std::set<VariableDeclaration const*> const& usedVars) const;
 	void updC4IfItNeeds() const;
+	std::optional<std::set<VariableDeclaration const*>> savedStateVariables() const;
+	void pushC7ToC4ForVariables(std::set<VariableDeclaration const*> const& changedVars) const;
 	void pushReceiveOrFallbackAndLoadFuncId();
 
-	void buildPublicFunctionSelector(const std::vector<std::pair<uint32_t, std::string>>& functions, int left, int right,
-									 PublicFunctionSelector const& pfs);
     void pushLocation(const ASTNode& node, bool reset = false);
 
 private:
@@ -156,20 +156,36 @@ private:
 	void beginConstructor();
 };
 
+// Splits public functions into hot ones, which are compared with the function id one by one
+// in order of their call frequency, and the rest ones, which are found in the dictionary.
+// Call frequencies are taken from the profile (see `--function-profile`). The number of hot
+// functions is chosen to minimize the expected gas of the dispatch.
+// Without a profile all functions are found in the dictionary, unless `uniform` is set
+// (see `--compare-function-ids`). Then the functions are considered equally frequent. By this model
+// comparisons pay off for 2..7 functions, e.g. 262 gas instead of 318 for 3 functions. Starting from
+// 8 functions only the dictionary is used: 460 gas for 8 functions, 560 for 16, 751 for 60.
 class PublicFunctionSelector {
 public:
-	explicit PublicFunctionSelector(int n);
-	std::vector<int> const& groupSizes(int n) const { return prev.at(n); }
+	PublicFunctionSelector(
+		std::vector<std::pair<uint32_t, std::string>> const& functions,
+		std::map<uint32_t, double> const& profile,
+		bool uniform
+	);
+	std::vector<std::pair<uint32_t, std::string>> const& hotFunctions() const { return m_hotFunctions; }
+	std::vector<std::pair<uint32_t, std::string>> const& dictFunctions() const { return m_dictFunctions; }
+	void printReport(std::ostream& out, std::string const& selectorName) const;
 private:
-	void dfs(int pos, int n);
+	// expected gas if the first `hotQty` functions of `sorted` are checked before the dictionary lookup
+	double expectedGas(std::vector<std::pair<double, size_t>> const& sorted, size_t hotQty) const;
+	static double dictLookupGas(size_t n);
 private:
-	std::vector<int> curGroupSize;
-	const int INF = 1e9;
-	const int OK_JMP = 18 + 23 + 18 + 126;  // DUP / PUSHINT ? / LEQ / IFJMPREF
-	const int FAIL_JMP = 18 + 23 + 18 + 26; // DUP / PUSHINT ? / LEQ / IFJMPREF
-	std::vector<int> maxPath;
-	std::vector<int> sumPaths;
-	std::vector<std::vector<int>> prev;
+	static constexpr int OK_JMP = 18 + 23 + 18 + 126;  // DUP / PUSHINT ? / EQUAL / IFJMPREF
+	static constexpr int FAIL_JMP = 18 + 23 + 18 + 26; // DUP / PUSHINT ? / EQUAL / IFJMPREF
+	std::vector<std::pair<uint32_t, std::string>> m_hotFunctions;
+	std::vector<std::pair<uint32_t, std::string>> m_dictFunctions;
+	std::map<uint32_t, double> m_frequency; // normalized call frequencies of the functions
+	double m_expectedGas{};
+	double m_dictOnlyGas{};
 };
 
 } // end solidity::frontend
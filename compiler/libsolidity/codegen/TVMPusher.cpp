@@ -17,6 +17,7 @@
 #include <libsolidity/ast/TypeProvider.h>
 
 #include <libsolidity/codegen/DictOperations.hpp>
+#include <libsolidity/codegen/TVM.hpp>
 #include <libsolidity/codegen/TVMPusher.hpp>
 #include <libsolidity/codegen/TVMExpressionCompiler.hpp>
 #include <libsolidity/codegen/TVMStructCompiler.hpp>
@@ -206,6 +207,140 @@ DataType StackPusher::pushDefaultValueForDict(Type const* keyType, Type const* v
 	return value.value();
 }
 
+// stack: N value
+// Builds the dictionary {0: value, 1: value, ..., N-1: value} of an array directly from cells. All keys below N-1 are
+// covered by complete subtrees, and a complete subtree of height h is two references to the same subtree of height h-1.
+// So only O(log N) cells are created instead of N dictionary insertions.
+void StackPusher::makeArrayDictOfSameValues(DataType valueType) {
+	// node len maxLen -> edge
+	// The label consists of `len` zero bits. It's stored in the shortest form: hml_same or hml_short.
+	auto edge = [](std::string const& indent) {
+		return std::vector<std::string>{
+			indent + "UBITSIZE",            // node len k
+			indent + "OVER",                // node len k len
+			indent + "MULCONST 2",          // node len k 2*len
+			indent + "OVER",                // node len k 2*len k
+			indent + "INC",                 // node len k 2*len k+1
+			indent + "GREATER",             // node len k isSame
+			indent + "PUSHCONT {",
+			indent + "\tNEWC",             // node len k b
+			indent + "\tSTSLICECONST xd_", // node len k b  // hml_same$11 v:0
+			indent + "\tSWAP",             // node len b k
+			indent + "\tSTUX",             // node b
+			indent + "}",
+			indent + "PUSHCONT {",
+			indent + "\tDROP",             // node len
+			indent + "\tNEWC",             // node len b
+			indent + "\tSTSLICECONST 0",   // node len b  // hml_short$0
+			indent + "\tOVER",             // node len b len
+			indent + "\tSTONES",           // node len b
+			indent + "\tSTSLICECONST 0",   // node len b
+			indent + "\tSWAP",             // node b len
+			indent + "\tSTZEROES",         // node b
+			indent + "}",
+			indent + "IFELSE",
+			indent + "STB",                 // b'
+			indent + "ENDC"                 // edge
+		};
+	};
+
+	std::vector<std::string> code;
+	auto append = [&](std::vector<std::string> const& lines) {
+		code.insert(code.end(), lines.begin(), lines.end());
+	};
+	// N value
+	switch (valueType) {
+	case DataType::Builder:
+		break;
+	case DataType::Cell:
+		append({"NEWC", "STREF"});
+		break;
+	case DataType::Slice:
+		append({"NEWC", "STSLICE"});
+		break;
+	}
+	append({
+		// leaf
+		"SWAP",                      // leaf N
+		// The same bound as the REPEAT loop that filled the dictionary before: 0 <= N < 2^31, otherwise
+		// range check error (exit code 5).
+		"DUP",                       // leaf N N
+		"UBITSIZE",                  // leaf N k
+		"GTINT 31",
+		"THROWIF 5",                 // leaf N
+		"DUP",                       // leaf N N
+		"PUSHCONT {",
+		"\tDEC",                    // leaf K  // K - the last key
+		"\tOVER",                   // leaf K leaf
+		"\tNEWC",                   // leaf K leaf b
+		"\tSTSLICECONST x2_",       // leaf K leaf b  // empty label
+		"\tSTB",                    // leaf K b
+		"\tENDC",                   // leaf K C  // C - complete subtree of height i
+		"\tROTREV",                 // C leaf K
+		"\tPUSHINT 0",              // C node K m  // m - height of node
+		"\tSWAP",                   // C node m K
+		"\tPUSHINT 0",              // C node m K i  // i - number of processed bits of K
+		"\tSWAP",                   // C node m i K
+		"\tXCHG S2, S4",            // m node C i K
+		"\tPUSHCONT {",
+		"\t\tDUP",                 // m node C i K K
+		"\t}",
+		"\tPUSHCONT {",
+		"\t\tPUSHINT 2",
+		"\t\tDIVMOD",              // m node C i K' bit
+		"\t\tPUSHCONT {",
+		"\t\t\tPUSH S3",          // m node C i K' node
+		"\t\t\tPUSH S2",          // m node C i K' node i
+		"\t\t\tDUP",              // m node C i K' node i i
+		"\t\t\tPUSH S7",          // m node C i K' node i i m
+		"\t\t\tSUB",              // m node C i K' node i i-m
+		"\t\t\tSWAP",             // m node C i K' node len maxLen
+	});
+	append(edge("\t\t\t"));       // m node C i K' edge
+	append({
+		"\t\t\tPUSH S3",          // m node C i K' edge C
+		"\t\t\tNEWC",
+		"\t\t\tSTREF",            // m node C i K' edge b
+		"\t\t\tSTREF",            // m node C i K' fork
+		"\t\t\tXCHG S4",          // m fork C i K' node
+		"\t\t\tDROP",             // m fork C i K'
+		"\t\t\tPUSH S1",          // m fork C i K' i
+		"\t\t\tINC",              // m fork C i K' i+1
+		"\t\t\tXCHG S5",          // i+1 fork C i K' m
+		"\t\t\tDROP",             // m' node' C i K'
+		"\t\t}",
+		"\t\tIF",
+		"\t\tROT",                 // m node i K' C
+		"\t\tDUP",                 // m node i K' C C
+		"\t\tNEWC",
+		"\t\tSTSLICECONST x2_",
+		"\t\tSTREF",
+		"\t\tSTREF",
+		"\t\tENDC",                // m node i K' C'
+		"\t\tROTREV",              // m node C' i K'
+		"\t\tSWAP",
+		"\t\tINC",
+		"\t\tSWAP",                // m node C' i+1 K'
+		"\t}",
+		"\tWHILE",
+		"\tBLKDROP 3",              // m node
+		"\tSWAP",                   // node m
+		"\tNEGATE",
+		"\tADDCONST " + toString(TvmConst::ArrayKeyLength), // node len
+		"\tPUSHINT " + toString(TvmConst::ArrayKeyLength),  // node len maxLen
+	});
+	append(edge("\t"));             // dict
+	append({
+		"}",
+		"PUSHCONT {",
+		"\tDROP2",
+		"\tNULL",
+		"}",
+		"IFELSE"
+	});
+	push(createNode<HardCode>(code, 2, 1, false));
+}
+
 // delMin/delMax
 // min/max
 // fetch
@@ -511,37 +646,37 @@ void StackPusher::declRetFlag() {
 
 Pointer<AsymGen>
 StackPusher::makeAsym(const string& cmd) {
-	static std::set<string> asymOpcodes;
-	if (asymOpcodes.empty()) {
+	static std::set<string> const asymOpcodes = []() {
+		std::set<string> res;
 		for (std::string type : {"", "I", "U"}) {
 			for (std::string suf : {"", "REF"}) {
 				for (std::string op : {"MIN", "MAX"}) {
-					asymOpcodes.insert("DICT" + type + "REM" + op + suf);
-					asymOpcodes.insert("DICT" + type + op + suf);
+					res.insert("DICT" + type + "REM" + op + suf);
+					res.insert("DICT" + type + op + suf);
 				}
 			}
 
 			for (std::string op : {"SETGET", "ADDGET", "REPLACEGET"})
 				for (std::string suf : {"", "REF", "B"})
-					asymOpcodes.insert("DICT" + type + op + suf);
+					res.insert("DICT" + type + op + suf);
 
 			for (std::string op : {"DELGET"})
 				for (std::string suf : {"", "REF"})
-					asymOpcodes.insert("DICT" + type + op + suf);
+					res.insert("DICT" + type + op + suf);
 
 			for (std::string suf : {"", "REF", "PREV", "PREVEQ", "NEXT", "NEXTEQ"})
-				asymOpcodes.insert("DICT" + type + "GET" + suf);
+				res.insert("DICT" + type + "GET" + suf);
 		}
 
 		for (std::string preload : {"", "P"})
 			for (std::string type : {"I", "U"}) {
 				for (std::string size : {"4", "8"})
-					asymOpcodes.insert(preload + "LD" + type + "LE" + size + "Q");
+					res.insert(preload + "LD" + type + "LE" + size + "Q");
 				for (std::string x : {"", "X"})
-					asymOpcodes.insert(preload + "LD" + type + x + "Q");
+					res.insert(preload + "LD" + type + x + "Q");
 			}
 
-		asymOpcodes.insert({
+		res.insert({
 			"CDATASIZEQ",
 			"CONFIGPARAM",
 			"CONFIGPARAM",
@@ -578,7 +713,8 @@ StackPusher::makeAsym(const string& cmd) {
 			"STSLICEQ",
 			"STUQ",
 		});
-	}
+		return res;
+	}();
 
 	istringstream iss(cmd);
 	string baseCmd;
@@ -2153,9 +2289,11 @@ bool FunctionCallGraph::dfs(std::string const& v) {
 	return false;
 }
 
-StorageLayout::StorageLayout(ContractDefinition const *contract) : m_contract(contract) {
-	auto const c4StateVars = usualStateVariables();
-	for (VariableDeclaration const *variable : c4StateVars) {
+StorageLayout::StorageLayout(ContractDefinition const *contract) :
+	m_contract(contract),
+	m_usualStateVars(planUsualStateVariables())
+{
+	for (VariableDeclaration const *variable : m_usualStateVars) {
 		int index = TvmConst::C7::FirstIndexForVariables + m_stateVarIndex.size();
 		m_stateVarIndex[variable] = index;
 	}
@@ -2186,14 +2324,56 @@ std::vector<Type const *> StorageLayout::getC4Types() const {
 }
 
 std::vector<VariableDeclaration const *> StorageLayout::usualAndUnpackedStateVariables() const {
-	auto stateVars = ::stateVariables(m_contract, StateVarType::Usual);
+	auto stateVars = m_usualStateVars;
 	auto unpacked = ::stateVariables(m_contract, StateVarType::Unpacked);
 	stateVars.insert(stateVars.end(), unpacked.begin(), unpacked.end());
 	return stateVars;
 }
 
 std::vector<VariableDeclaration const *> StorageLayout::usualStateVariables() const {
-	return ::stateVariables(m_contract, StateVarType::Usual);
+	return m_usualStateVars;
+}
+
+// State variables are stored in c4 in declaration order. With --optimize-storage-layout the most
+// frequently accessed ones are stored first so they get into the root cell and are loaded without
+// extra cell loads. Variables with equal frequency keep declaration order.
+// Both options apply only to the compiled contract. Other contracts, e.g. the ones deployed by
+// `new B{varInit: ...}`, keep declaration order.
+std::vector<VariableDeclaration const *> StorageLayout::planUsualStateVariables() const {
+	std::vector<VariableDeclaration const *> const declared = ::stateVariables(m_contract, StateVarType::Usual);
+	if (m_contract != GlobalParams::g_mainContract)
+		return declared;
+	std::vector<VariableDeclaration const *> stateVars = declared;
+	if (GlobalParams::g_optimizeStorageLayout) {
+		StateVariableAccessCounter const counter{*m_contract};
+		std::stable_sort(stateVars.begin(), stateVars.end(), [&](VariableDeclaration const* a, VariableDeclaration const* b) {
+			return counter.accessCount(a) > counter.accessCount(b);
+		});
+	}
+	if (GlobalParams::g_storageLayout.empty())
+		return stateVars;
+
+	// Variables of the previous layout keep their order, so the data stays valid after tvm.setcode.
+	// New variables are stored after them. Names are the same as in the ABI: a shadowed variable
+	// of a base contract is named `Contract$name`.
+	std::map<std::string, VariableDeclaration const*> byName;
+	for (VariableDeclaration const* var : declared | boost::adaptors::reversed) {
+		std::string name = var->name();
+		if (byName.count(name) != 0)
+			name = var->annotation().contract->name() + "$" + var->name();
+		byName.emplace(name, var);
+	}
+	std::vector<VariableDeclaration const *> res;
+	std::set<VariableDeclaration const *> pinned;
+	for (std::string const& name : GlobalParams::g_storageLayout) {
+		auto it = byName.find(name);
+		if (it != byName.end() && pinned.insert(it->second).second)
+			res.push_back(it->second);
+	}
+	for (VariableDeclaration const* var : stateVars)
+		if (pinned.count(var) == 0)
+			res.push_back(var);
+	return res;
 }
 
 std::vector<VariableDeclaration const *> StorageLayout::unpackedStateVariables() const {
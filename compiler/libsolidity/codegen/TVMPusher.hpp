@@ -95,8 +95,12 @@ public:
 	std::vector<std::pair<VariableDeclaration const*, int>> getStaticVariables() const;
 	int getUnpackIndex() const;
 
+private:
+	std::vector<VariableDeclaration const *> planUsualStateVariables() const;
+
 private:
 	ContractDefinition const* m_contract;
+	std::vector<VariableDeclaration const *> m_usualStateVars;
 	std::map<VariableDeclaration const*, int> m_stateVarIndex;
 };
 
@@ -337,6 +341,7 @@ public:
 	DataType prepareValueForDictOperations(Type const* keyType, Type const* valueType);
 	[[nodiscard]]
 	DataType pushDefaultValueForDict(Type const* keyType, Type const* valueType);
+	void makeArrayDictOfSameValues(DataType valueType);
 	static bool doesDictStoreValueInRef(Type const* keyType, Type const* valueType);
 
 	enum class DecodeType {
@@ -14,9 +14,14 @@
  * TVM Solidity abstract syntax tree.
  */
 
+#include <cctype>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
 #include <liblangutil/Exceptions.h>
@@ -158,14 +163,87 @@ bool HardCode::operator==(TvmAstNode const& _node) const {
 	return g && std::tie(m_code, m_take, m_ret) == std::tie(g->m_code, g->m_take, g->m_ret);
 }
 
+namespace {
+	// Names are never removed, so pointers to the elements stay valid
+	std::unordered_set<std::string>& opcodeNames() {
+		static std::unordered_set<std::string> names;
+		return names;
+	}
+
+	std::mutex& opcodeNamesMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	// Every thread keeps its own index of the interned names, so the shared table is locked
+	// only the first time a thread meets a name.
+	std::string const* internOpcodeName(std::string const& _name) {
+		thread_local std::unordered_map<std::string_view, std::string const*> known;
+		auto it = known.find(_name);
+		if (it != known.end())
+			return it->second;
+		std::string const* name{};
+		{
+			std::lock_guard lock{opcodeNamesMutex()};
+			name = &*opcodeNames().insert(_name).first;
+		}
+		known.emplace(*name, name);
+		return name;
+	}
+
+	// Parses decimal and hexadecimal (0x...) integers. Leading zeros are not allowed in decimal
+	// numbers, because bigint parses such strings as octal numbers.
+	std::optional<solidity::bigint> parseIntArg(std::string const& str) {
+		size_t start = !str.empty() && str[0] == '-' ? 1 : 0;
+		if (start == str.size())
+			return std::nullopt;
+		bool isHex = str.size() > start + 1 && str[start] == '0' && (str[start + 1] == 'x' || str[start + 1] == 'X');
+		size_t digits = isHex ? start + 2 : start;
+		if (digits == str.size() || (!isHex && str[digits] == '0' && digits + 1 != str.size()))
+			return std::nullopt;
+		for (size_t i = digits; i < str.size(); ++i) {
+			auto c = static_cast<unsigned char>(str[i]);
+			if (!(isHex ? std::isxdigit(c) : std::isdigit(c)))
+				return std::nullopt;
+		}
+		solidity::bigint value{str.substr(start)};
+		return start == 1 ? -value : value;
+	}
+}
+
+OpcodeSymbol::OpcodeSymbol(std::string const& _name) : m_name{internOpcodeName(_name)} {
+}
+
+namespace solidity::frontend::Opcodes {
+	OpcodeSymbol const& ADD() { static OpcodeSymbol const symbol{"ADD"}; return symbol; }
+	OpcodeSymbol const& ADDCONST() { static OpcodeSymbol const symbol{"ADDCONST"}; return symbol; }
+	OpcodeSymbol const& AND() { static OpcodeSymbol const symbol{"AND"}; return symbol; }
+	OpcodeSymbol const& DEC() { static OpcodeSymbol const symbol{"DEC"}; return symbol; }
+	OpcodeSymbol const& EQUAL() { static OpcodeSymbol const symbol{"EQUAL"}; return symbol; }
+	OpcodeSymbol const& FALSE() { static OpcodeSymbol const symbol{"FALSE"}; return symbol; }
+	OpcodeSymbol const& INC() { static OpcodeSymbol const symbol{"INC"}; return symbol; }
+	OpcodeSymbol const& MAX() { static OpcodeSymbol const symbol{"MAX"}; return symbol; }
+	OpcodeSymbol const& MIN() { static OpcodeSymbol const symbol{"MIN"}; return symbol; }
+	OpcodeSymbol const& MUL() { static OpcodeSymbol const symbol{"MUL"}; return symbol; }
+	OpcodeSymbol const& MULCONST() { static OpcodeSymbol const symbol{"MULCONST"}; return symbol; }
+	OpcodeSymbol const& NEQ() { static OpcodeSymbol const symbol{"NEQ"}; return symbol; }
+	OpcodeSymbol const& OR() { static OpcodeSymbol const symbol{"OR"}; return symbol; }
+	OpcodeSymbol const& PUSHINT() { static OpcodeSymbol const symbol{"PUSHINT"}; return symbol; }
+	OpcodeSymbol const& SDEQ() { static OpcodeSymbol const symbol{"SDEQ"}; return symbol; }
+	OpcodeSymbol const& SUB() { static OpcodeSymbol const symbol{"SUB"}; return symbol; }
+	OpcodeSymbol const& TRUE() { static OpcodeSymbol const symbol{"TRUE"}; return symbol; }
+	OpcodeSymbol const& XOR() { static OpcodeSymbol const symbol{"XOR"}; return symbol; }
+}
+
 StackOpcode::StackOpcode(const std::string& opcode, int take, int ret, bool _isPure) : Gen{_isPure}, m_take{take}, m_ret{ret} {
 	vector<string> lines = split(opcode, ';');
 	solAssert(lines.size() <= 2, "");
 
 	auto pos = lines.at(0).find(' ');
-	m_opcode = boost::algorithm::trim_copy(lines.at(0).substr(0, pos));
+	m_opcode = OpcodeSymbol{boost::algorithm::trim_copy(lines.at(0).substr(0, pos))};
 	if (pos != std::string::npos)
 		m_arg = boost::algorithm::trim_copy(lines.at(0).substr(pos + 1));
+	m_intArg = parseIntArg(m_arg);
 
 	if (lines.size() == 2) {
 		m_comment = ";" + lines.at(1);
@@ -178,7 +256,7 @@ void StackOpcode::accept(TvmAstVisitor& _visitor) {
 }
 
 std::string StackOpcode::fullOpcode() const {
-	std::string ret = m_opcode;
+	std::string ret = m_opcode.str();
 	if (!m_arg.empty())
 		ret += " " + m_arg;
 	if (!m_comment.empty())
@@ -186,17 +264,31 @@ std::string StackOpcode::fullOpcode() const {
 	return ret;
 }
 
+std::optional<solidity::bigint> StackOpcode::pushedInt() const {
+	if (m_opcode == Opcodes::PUSHINT())
+		return m_intArg;
+	if (m_opcode == Opcodes::TRUE() && m_arg.empty())
+		return bigint{-1};
+	if (m_opcode == Opcodes::FALSE() && m_arg.empty())
+		return bigint{0};
+	return std::nullopt;
+}
+
 bool StackOpcode::operator==(TvmAstNode const& _node) const {
 	auto gen = to<StackOpcode>(&_node);
-	if (gen) {
-		if (
-			(isIn(fullOpcode(), "TRUE", "PUSHINT -1") && isIn(gen->fullOpcode(), "TRUE", "PUSHINT -1")) ||
-			(isIn(fullOpcode(), "FALSE", "PUSHINT 0") && isIn(gen->fullOpcode(), "FALSE", "PUSHINT 0"))
-		) {
+	if (!gen)
+		return false;
+	// TRUE == PUSHINT -1 and FALSE == PUSHINT 0
+	if (
+		(isIn(m_opcode, Opcodes::TRUE(), Opcodes::FALSE()) || isIn(gen->m_opcode, Opcodes::TRUE(), Opcodes::FALSE())) &&
+		m_comment.empty() && gen->m_comment.empty()
+	) {
+		std::optional<bigint> a = pushedInt();
+		std::optional<bigint> b = gen->pushedInt();
+		if (a && b && *a == *b && (*a == 0 || *a == -1))
 			return true;
-		}
 	}
-	return gen && std::tie(m_opcode, m_arg) == std::tie(gen->m_opcode, gen->m_arg);
+	return m_opcode == gen->m_opcode && m_arg == gen->m_arg;
 }
 
 TvmReturn::TvmReturn(bool _withIf, bool _withNot, bool _withAlt) :
@@ -826,14 +918,15 @@ Pointer<StackOpcode> gen(const std::string& cmd) {
 		{"QMULDIVMOD", {3, 2, true}},
 		{"SPLIT", {3, 2}},
 	};
-	static bool isInit = false;
-	if (!isInit) {
-		isInit = true;
+	// The initialization of a static local variable is thread-safe
+	static bool const isInit = []() {
 		const auto combArithOpers =  tonCombinedArithmeticOperations();
 		for (const auto& arith : combArithOpers) {
 			opcodes.insert({boost::to_upper_copy<std::string>(arith.name), {int(arith.take), int(arith.ret)}});
 		}
-	}
+		return true;
+	}();
+	solAssert(isInit, "");
 
 	Pointer<StackOpcode> opcode;
 	if (opcodes.count(op)) {
@@ -1069,6 +1162,31 @@ bool isPureGen01(TvmAstNode const& node) {
 	return gen && gen->isPure() && gen->take() == 0 && gen->ret() == 1;
 }
 
+bool isCallOrGlobalWrite(TvmAstNode const& node) {
+	if (auto opcode = to<StackOpcode>(&node)) {
+		std::string const& op = opcode->opcode();
+		return boost::starts_with(op, "CALL") || boost::starts_with(op, "JMP") || op == ".inline" ||
+			boost::starts_with(op, "SETGLOB") || boost::starts_with(op, "POP");
+	}
+	if (auto hardCode = to<HardCode>(&node)) {
+		for (std::string const& line : hardCode->code())
+			for (char const* op : {"CALL", "JMP", ".inline", "SETGLOB", "POP C", "POPROOT", "POPCTR"})
+				if (boost::icontains(line, op))
+					return true;
+	}
+	return false;
+}
+
+bool leavesContinuation(TvmAstNode const& node) {
+	if (auto opcode = to<StackOpcode>(&node))
+		return boost::contains(opcode->opcode(), "RET") || boost::contains(opcode->opcode(), "JMP");
+	if (auto hardCode = to<HardCode>(&node))
+		for (std::string const& line : hardCode->code())
+			if (boost::icontains(line, "RET") || boost::icontains(line, "JMP"))
+				return true;
+	return false;
+}
+
 bool isSWAP(Pointer<TvmAstNode> const& node) {
 	return isBLKSWAP(node) && isBLKSWAP(node).value() == std::make_pair(1, 1);
 }
@@ -1245,88 +1363,7 @@ Pointer<AsymGen> getZeroOrNullAlignment(bool isZero, bool isSwap, bool isNot) {
 }
 
 int OpcodeUtils::gasCost(Stack const& opcode) {
-	int i = opcode.i();
-	int j = opcode.j();
-	//int k = opcode.k();
-	switch (opcode.opcode()) {
-	case Stack::Opcode::POP_S:
-		return 18;
-	case Stack::Opcode::DROP: {
-		int n = i;
-		if (n == 1 || n == 2)
-			return 18; // "DROP" "DROP2"
-		if (n <= 15)
-			return 26; // BLKDROP
-		return 18 + 18; // PUSHINT N + DROPX
-	}
-	case Stack::Opcode::BLKDROP2: {
-		if (i > 15 || j > 15)
-			solUnimplemented("");
-		return 26;
-	}
-	case Stack::Opcode::BLKSWAP: {
-		int bottom = i;
-		int top = j;
-		if (bottom == 1 && top == 1) {
-			return 18; // SWAP
-		} else if (bottom == 1 && top == 2) {
-			return 18; // "ROT";
-		} else if (bottom == 2 && top == 1) {
-			return 18; // "ROTREV";
-		} else if (bottom == 2 && top == 2) {
-			return 18; // "SWAP2";
-		} else if (1 <= bottom && bottom <= 16 && 1 <= top && top <= 16) {
-			return 26; // "ROLL " "ROLLREV " "BLKSWAP"
-		} else {
-			solUnimplemented(""); // "ROLLX" "ROLLREVX" "BLKSWX"
-		}
-	}
-	case Stack::Opcode::BLKPUSH: {
-		if ((i == 2 && j == 1) || (i == 2 && j == 3)) {
-			return 18; // "DUP2" "OVER2"
-		} else {
-			if (i > 15)
-				solAssert(j == 0, "");
-			int rest = i;
-			int cost = 0;
-			while (rest > 0) {
-				cost += 26; // "BLKPUSH "
-				rest -= 15;
-			}
-			return cost;
-		}
-	}
-	case Stack::Opcode::PUSH2_S:
-		if ((i == 1 && j == 0) || (i == 3 && j == 2))
-			return 18; // "DUP2" "OVER2"
-		return 26; // "PUSH2"
-	case Stack::Opcode::REVERSE:
-		if ((i == 2 && j == 0) || (i == 3 && j == 0))
-			return 18; // "SWAP" "XCHG S2"
-		else if (2 <= i && i <= 17 && 0 <= j && j <= 15)
-			return 26; // "REVERSE"
-		solUnimplemented("");
-	case Stack::Opcode::XCHG:
-		if (i == 0 || i == 1)
-			return 18; // "XCHG Sj" "XCHG s1, Sj"
-		return 26; // XCHG Si, Sj
-	case Stack::Opcode::PUSH_S:
-		return 18;
-	case Stack::Opcode::XCHG3:
-	case Stack::Opcode::XCHG2:
-	case Stack::Opcode::XCPU:
-	case Stack::Opcode::PUXC:
-		return 26;
-	case Stack::Opcode::PUSH3_S:
-	case Stack::Opcode::XC2PU:
-	case Stack::Opcode::XCPU2:
-	case Stack::Opcode::PUXC2:
-	case Stack::Opcode::XCPUXC:
-	case Stack::Opcode::PUXCPU:
-	case Stack::Opcode::PU2XC:
-		return 34;
-	}
-	solUnimplemented("");
+	return opcode.command().gasCost();
 }
 
 } // end solidity::frontend
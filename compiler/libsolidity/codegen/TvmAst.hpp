@@ -25,6 +25,7 @@
 
 #include <boost/noncopyable.hpp>
 #include <libsolidity/ast/AST.h>
+#include <libsolidity/codegen/StackState.hpp>
 
 template <class T>
 using Pointer = std::shared_ptr<T>;
@@ -33,6 +34,8 @@ namespace solidity::frontend
 {
 class TvmAstVisitor;
 
+// Nodes are not allocated in an arena: with shared_ptr handles every node keeps the whole arena alive,
+// so the memory of all nodes created by the optimizer is held until the end of the compilation.
 template <class NodeType, typename... Args>
 Pointer<NodeType> createNode(Args&& ... _args)
 {
@@ -60,32 +63,7 @@ private:
 
 class Stack : public TvmAstNode {
 public:
-	enum class Opcode {
-		DROP,
-		BLKDROP2, // BLKDROP2 1, 1
-		POP_S,    // POP_S 1
-
-		BLKPUSH, // BLKPUSH 1, i | BLKPUSH 3, i         |  BLKPUSH 2, 1 (DUP2)  |  BLKPUSH 3, 1 (OVER2)
-		PUSH2_S, //              |                      |  PUSH2 S1, S0         |  PUSH2 S3, S2
-		PUSH3_S, //              | PUSH3 Si, Si-1, Si-2 |                       |
-		PUSH_S,  // PUSH Si      |                      |                       |
-
-		BLKSWAP, //  BLKSWAP 1, 1  |
-		REVERSE, //  REVERSE 2, 0  |  REVERSE 3, 0
-		XCHG,    //  XCHG S0 S1    |  XCHG S0 S2,
-
-		//  Compound stack manipulation primitives
-		XCHG3,
-		XCHG2,
-		XCPU,  //XCPU s1,s1 == TUCK
-		PUXC,
-		XC2PU,
-		XCPU2,
-		PUXC2,
-		XCPUXC,
-		PUXCPU,
-		PU2XC
-	};
+	using Opcode = StackCommand::Opcode;
 	explicit Stack(Opcode opcode, int i = -1, int j = -1, int k = -1);
 	void accept(TvmAstVisitor& _visitor) override;
 	bool operator==(TvmAstNode const& _node) const override;
@@ -93,6 +71,7 @@ public:
 	int i() const { return m_i; }
 	int j() const { return m_j; }
 	int k() const { return m_k; }
+	StackCommand command() const { return StackCommand{m_opcode, m_i, m_j, m_k}; }
 private:
 	Opcode m_opcode{};
 	int m_i{-1};
@@ -186,20 +165,62 @@ private:
 	int m_ret{};
 };
 
+// Interned name of a TVM instruction. All symbols with the same name share one string,
+// so symbols are compared and hashed as pointers.
+class OpcodeSymbol {
+public:
+	OpcodeSymbol() : OpcodeSymbol{std::string{}} { }
+	explicit OpcodeSymbol(std::string const& _name);
+	std::string const& str() const { return *m_name; }
+	bool operator==(OpcodeSymbol const& _other) const { return m_name == _other.m_name; }
+	bool operator!=(OpcodeSymbol const& _other) const { return m_name != _other.m_name; }
+private:
+	std::string const* m_name{};
+};
+
+// Symbols of instructions that are matched by optimizers. They are function-local statics,
+// so they are safe to use during static initialization.
+namespace Opcodes {
+	OpcodeSymbol const& ADD();
+	OpcodeSymbol const& ADDCONST();
+	OpcodeSymbol const& AND();
+	OpcodeSymbol const& DEC();
+	OpcodeSymbol const& EQUAL();
+	OpcodeSymbol const& FALSE();
+	OpcodeSymbol const& INC();
+	OpcodeSymbol const& MAX();
+	OpcodeSymbol const& MIN();
+	OpcodeSymbol const& MUL();
+	OpcodeSymbol const& MULCONST();
+	OpcodeSymbol const& NEQ();
+	OpcodeSymbol const& OR();
+	OpcodeSymbol const& PUSHINT();
+	OpcodeSymbol const& SDEQ();
+	OpcodeSymbol const& SUB();
+	OpcodeSymbol const& TRUE();
+	OpcodeSymbol const& XOR();
+}
+
 class StackOpcode : public Gen {
 public:
 	explicit StackOpcode(const std::string& opcode, int take, int ret, bool _isPure = false);
 	void accept(TvmAstVisitor& _visitor) override;
 	std::string fullOpcode() const;
-	std::string const &opcode() const { return m_opcode; }
+	std::string const &opcode() const { return m_opcode.str(); }
+	OpcodeSymbol symbol() const { return m_opcode; }
 	std::string const &arg() const { return m_arg; }
+	// The argument if it's a decimal or a hexadecimal integer, e.g. for PUSHINT, ADDCONST or MULCONST
+	std::optional<bigint> const& intArg() const { return m_intArg; }
 	std::string const &comment() const { return m_comment; }
 	int take() const override { return m_take; }
 	int ret() const override { return m_ret; }
 	bool operator==(TvmAstNode const& _node) const override;
+	// Returns the value that is pushed by PUSHINT, TRUE or FALSE
+	std::optional<bigint> pushedInt() const;
 private:
-	std::string m_opcode;
+	OpcodeSymbol m_opcode;
 	std::string m_arg;
+	std::optional<bigint> m_intArg;
 	std::string m_comment;
 	int m_take{};
 	int m_ret{};
@@ -523,7 +544,9 @@ public:
 	bool upgradeOldSolidity() const { return m_upgradeOldSolidity; }
 	std::string const& version() const { return m_version; }
 	std::vector<Pointer<Function>> const& functions() const { return m_functions; }
+	void updFunctions(std::vector<Pointer<Function>> _functions) { m_functions = std::move(_functions); }
 	std::map<uint32_t, std::string> const& privateFunctions() const { return m_privateFunctions; }
+	void updPrivateFunctions(std::map<uint32_t, std::string> _privateFunctions) { m_privateFunctions = std::move(_privateFunctions); }
 	std::map<uint32_t, std::string> const& getters() const { return m_getters; }
 private:
 	ContractType m_contractType;
@@ -566,6 +589,10 @@ Pointer<Stack> makeXCPU(int i, int j);
 Pointer<TvmIfElse> flipIfElse(TvmIfElse const& node);
 
 bool isPureGen01(TvmAstNode const& node);
+// Returns true if the opcode or the hard code calls a function or changes global variables or control registers
+bool isCallOrGlobalWrite(TvmAstNode const& node);
+// Returns true if the opcode or the hard code returns from or jumps out of the current continuation
+bool leavesContinuation(TvmAstNode const& node);
 bool isSWAP(Pointer<TvmAstNode> const& node);
 std::optional<std::pair<int, int>> isBLKSWAP(Pointer<TvmAstNode> const& node);
 std::optional<int> isDrop(Pointer<TvmAstNode> const& node);
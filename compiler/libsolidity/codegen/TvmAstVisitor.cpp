@@ -17,6 +17,8 @@
 #include <ostream>
 #include <memory>
 
+#include <boost/algorithm/string.hpp>
+
 #include <libsolidity/codegen/TvmAstVisitor.hpp>
 #include <liblangutil/Exceptions.h>
 #include <libsolidity/codegen/TVMCommons.hpp>
@@ -1044,3 +1046,102 @@ bool LogCircuitExpander::isPureOperation(Pointer<TvmAstNode> const& op) {
 
 	return false;
 }
+
+bool ContinuationExitChecker::visit(TvmReturn &_node) {
+	if (m_depth == 0 || _node.withAlt())
+		m_canExit = true;
+	return false;
+}
+
+bool ContinuationExitChecker::visit(StackOpcode &_node) {
+	std::string const& opcode = _node.opcode();
+	if (opcode == ".inline") {
+		// the code of the fragment is placed into the current continuation
+		if (m_depth == 0 && !m_isInlinable(_node.arg()))
+			m_canExit = true;
+		return false;
+	}
+	if (m_depth == 0 && (boost::contains(opcode, "RET") || boost::starts_with(opcode, "JMP") || opcode == "CALLCC"))
+		m_canExit = true;
+	if (boost::contains(opcode, "ALT") || boost::icontains(_node.arg(), "c0"))
+		m_canExit = true;
+	return false;
+}
+
+bool ContinuationExitChecker::visit(HardCode &_node) {
+	for (std::string const& line : _node.code())
+		for (char const* s : {"RET", "JMP", "ALT", "CALLCC", "c0", "C0"})
+			if (boost::contains(line, s))
+				m_canExit = true;
+	return false;
+}
+
+bool ContinuationExitChecker::visit(TvmIfElse &_node) {
+	if (m_depth == 0 && _node.withJmp())
+		m_canExit = true;
+	nested(_node.trueBody());
+	nested(_node.falseBody());
+	return false;
+}
+
+bool ContinuationExitChecker::visit(SubProgram &_node) {
+	if (m_depth == 0 && _node.isJmp())
+		m_canExit = true;
+	nested(_node.block());
+	return false;
+}
+
+bool ContinuationExitChecker::visit(TvmRepeat &_node) {
+	loop(_node.withBreakOrReturn(), {_node.body()});
+	return false;
+}
+
+bool ContinuationExitChecker::visit(TvmUntil &_node) {
+	loop(_node.withBreakOrReturn(), {_node.body()});
+	return false;
+}
+
+bool ContinuationExitChecker::visit(While &_node) {
+	loop(_node.withBreakOrReturn(), {_node.condition(), _node.body()});
+	return false;
+}
+
+bool ContinuationExitChecker::visit(TryCatch &_node) {
+	nested(_node.tryBody());
+	nested(_node.catchBody());
+	return false;
+}
+
+bool ContinuationExitChecker::visit(LogCircuit &_node) {
+	nested(_node.body());
+	return false;
+}
+
+bool ContinuationExitChecker::visit(CodeBlock &_node) {
+	// a continuation that is pushed to the stack
+	if (_node.type() != CodeBlock::Type::None)
+		++m_depth;
+	return true;
+}
+
+void ContinuationExitChecker::endVisit(CodeBlock &_node) {
+	if (_node.type() != CodeBlock::Type::None)
+		--m_depth;
+}
+
+void ContinuationExitChecker::nested(Pointer<CodeBlock> const& block) {
+	if (block == nullptr)
+		return;
+	++m_depth;
+	for (Pointer<TvmAstNode> const& op : block->instructions())
+		op->accept(*this);
+	--m_depth;
+}
+
+void ContinuationExitChecker::loop(bool withBreakOrReturn, std::vector<Pointer<CodeBlock>> const& blocks) {
+	// `return` and `break` in loops use RETALT
+	if (withBreakOrReturn)
+		m_canExit = true;
+	for (Pointer<CodeBlock> const& block : blocks)
+		nested(block);
+}
@@ -16,8 +16,10 @@
 
 #pragma once
 
+#include <functional>
 #include <optional>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <boost/noncopyable.hpp>
@@ -120,4 +122,33 @@ private:
 	std::vector<Pointer<TvmAstNode>> m_newInst;
 };
 
+// Checks whether code can leave the continuation where it's placed other than by reaching its end
+// or by throwing an exception, e.g. by RET, JMPX or RETALT. Such code can't be moved into another continuation.
+class ContinuationExitChecker : public TvmAstVisitor {
+public:
+	// `_isInlinable` tells whether the code of the `.inline` fragment can't leave the continuation
+	explicit ContinuationExitChecker(std::function<bool(std::string const&)> _isInlinable) :
+		m_isInlinable{std::move(_isInlinable)} { }
+	bool visit(TvmReturn &_node) override;
+	bool visit(StackOpcode &_node) override;
+	bool visit(HardCode &_node) override;
+	bool visit(TvmIfElse &_node) override;
+	bool visit(SubProgram &_node) override;
+	bool visit(TvmRepeat &_node) override;
+	bool visit(TvmUntil &_node) override;
+	bool visit(While &_node) override;
+	bool visit(TryCatch &_node) override;
+	bool visit(LogCircuit &_node) override;
+	bool visit(CodeBlock &_node) override;
+	void endVisit(CodeBlock &_node) override;
+	bool canExit() const { return m_canExit; }
+private:
+	void nested(Pointer<CodeBlock> const& block);
+	void loop(bool withBreakOrReturn, std::vector<Pointer<CodeBlock>> const& blocks);
+private:
+	std::function<bool(std::string const&)> m_isInlinable;
+	int m_depth{}; // 0 for instructions of the checked continuation
+	bool m_canExit{};
+};
+
 }	// end solidity::frontend
@@ -251,6 +251,66 @@ void CompilerStack::setTVMVersion(langutil::TVMVersion _version)
 	GlobalParams::g_tvmVersion = m_tvmVersion;
 }
 
+void CompilerStack::setOptimizerRounds(int _rounds)
+{
+	m_codegenSettings.optimizerRounds = _rounds;
+}
+
+void CompilerStack::disableDataflowPasses()
+{
+	m_codegenSettings.dataflowPasses = false;
+}
+
+void CompilerStack::printOptimizerStats()
+{
+	m_codegenSettings.printOptimizerStats = true;
+}
+
+void CompilerStack::setJobs(unsigned _jobs)
+{
+	m_codegenSettings.jobs = _jobs;
+}
+
+void CompilerStack::setFunctionProfile(std::map<uint32_t, double> _profile)
+{
+	m_codegenSettings.functionProfile = std::move(_profile);
+}
+
+void CompilerStack::setCompareFunctionIds()
+{
+	m_codegenSettings.compareFunctionIds = true;
+}
+
+void CompilerStack::setOptimizeFor(OptimizationObjective _objective)
+{
+	m_codegenSettings.optimizeFor = _objective;
+}
+
+void CompilerStack::setLazyStateLoading()
+{
+	m_codegenSettings.lazyStateLoading = true;
+}
+
+void CompilerStack::setPartialStateSaving()
+{
+	m_codegenSettings.partialStateSaving = true;
+}
+
+void CompilerStack::setOptimizeStorageLayout()
+{
+	m_codegenSettings.optimizeStorageLayout = true;
+}
+
+void CompilerStack::setStorageLayout(std::vector<std::string> _fields)
+{
+	m_codegenSettings.storageLayout = std::move(_fields);
+}
+
+void CompilerStack::setInlineThreshold(int _threshold)
+{
+	m_codegenSettings.inlineThreshold = _threshold;
+}
+
 void CompilerStack::setLibraries(std::map<std::string, util::h160> const& _libraries)
 {
 	if (m_stackState >= ParsedAndImported)
@@ -311,6 +371,7 @@ void CompilerStack::reset(bool _keepSettings)
 		m_metadataFormat = defaultMetadataFormat();
 		m_metadataHash = MetadataHash::IPFS;
 		m_stopAfter = State::CompilationSuccessful;
+		m_codegenSettings = TVMCodegenSettings{};
 	}
 	m_experimentalAnalysis.reset();
 	m_globalContext.reset();
@@ -640,6 +701,7 @@ bool CompilerStack::analyzeLegacy(bool _noErrorsSoFar)
 			ContractDefinition const *targetContract{};
 			std::vector<PragmaDirective const *> targetPragmaDirectives;
 			std::tie(targetContract, targetPragmaDirectives) = res.value();
+			GlobalParams::g_mainContract = targetContract;
 			PragmaDirectiveHelper pragmaDirectiveHelper{targetPragmaDirectives};
 			TVMTypeChecker checker(m_errorReporter);
 			checker.checkMainContract(targetContract, pragmaDirectiveHelper);
@@ -808,12 +870,15 @@ std::pair<bool, bool> CompilerStack::compile(bool json)
 	if (m_hasError)
 		solThrow(CompilerError, "Called compile with errors.");
 
-	if (m_generateAbi || m_generateCode || m_doPrintFunctionIds || m_doPrivateFunctionIds) {
+	GlobalParams::setCodegenSettings(m_codegenSettings);
+
+	if (m_generateAbi || m_generateCode || m_doPrintFunctionIds || m_doPrivateFunctionIds || m_doGasReport) {
 		auto res = findMainContract();
 		if (res) {
 			ContractDefinition const *targetContract{};
 			std::vector<PragmaDirective const *> targetPragmaDirectives;
 			std::tie(targetContract, targetPragmaDirectives) = res.value();
+			GlobalParams::g_mainContract = targetContract;
 
 			if (targetContract != nullptr) {
 				try {
@@ -825,14 +890,20 @@ std::pair<bool, bool> CompilerStack::compile(bool json)
 							Json::Value abi = TVMABI::generateABIJson(targetContract, getSourceUnits(), pragmaDirectives);
 							c.abi = std::make_unique<Json::Value>(abi);
 						}
-						if (m_generateCode) {
+						if (m_generateCode || m_doGasReport) {
 							Pointer<solidity::frontend::Contract> codeContract =
 								TVMContractCompiler::generateContractCode(targetContract, getSourceUnits(), pragmaHelper);
-							std::ostringstream out;
-							Printer p{out};
-							codeContract->accept(p);
-							Json::Value code = Json::Value(out.str());
-							c.code = std::make_unique<Json::Value>(code);
+							if (m_generateCode) {
+								std::ostringstream out;
+								Printer p{out};
+								codeContract->accept(p);
+								Json::Value code = Json::Value(out.str());
+								c.code = std::make_unique<Json::Value>(code);
+							}
+							if (m_doGasReport) {
+								Json::Value gasReport = TVMContractCompiler::generateGasReport(*targetContract, *codeContract, pragmaHelper);
+								c.gasReport = std::make_unique<Json::Value>(gasReport);
+							}
 						}
 						if (m_doPrintFunctionIds)
 						{
@@ -861,7 +932,8 @@ std::pair<bool, bool> CompilerStack::compile(bool json)
 							m_folder,
 							m_file_prefix,
 							m_doPrintFunctionIds,
-							m_doPrivateFunctionIds
+							m_doPrivateFunctionIds,
+							m_doGasReport
 						);
 					}
 					didCompileSomething = true;
@@ -1006,6 +1078,12 @@ Json::Value const& CompilerStack::privateFunctionIds(std::string const& _contrac
 	return c.privateFunctionIds ? *c.privateFunctionIds : Json::Value::null;
 }
 
+Json::Value const& CompilerStack::gasReport(std::string const& _contractName) const
+{
+	Contract const &c = contract(_contractName);
+	return c.gasReport ? *c.gasReport : Json::Value::null;
+}
+
 Json::Value const& CompilerStack::natspecUser(std::string const& _contractName) const
 {
 	if (m_stackState < AnalysisSuccessful)
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <libsolidity/analysis/FunctionCallGraph.h>
+#include <libsolidity/codegen/TVM.hpp>
 #include <libsolidity/interface/ReadFile.h>
 #include <libsolidity/interface/ImportRemapper.h>
 #include <libsolidity/interface/OptimiserSettings.h>
@@ -165,6 +166,44 @@ public:
 
 	void setTVMVersion(langutil::TVMVersion _version = langutil::TVMVersion{});
 
+	/// Sets the maximum number of peephole and stack optimizer rounds.
+	void setOptimizerRounds(int _rounds);
+
+	/// Don't run dictionary lookup elimination, loop invariant hoisting and constant propagation.
+	void disableDataflowPasses();
+
+	/// Print timing statistics of the TVM optimizer passes to stderr.
+	void printOptimizerStats();
+
+	/// Sets the number of threads used to optimize functions of a contract.
+	/// 0 means the number of hardware threads.
+	void setJobs(unsigned _jobs);
+
+	/// Sets call frequencies of public functions, which are used to build the function selector.
+	void setFunctionProfile(std::map<uint32_t, double> _profile);
+
+	/// Without a function profile, consider public functions equally frequent when building the function selector.
+	void setCompareFunctionIds();
+
+	/// Sets what the size optimizer prefers: smaller code or less gas.
+	void setOptimizeFor(OptimizationObjective _objective);
+
+	/// Decode only the state variables that are read by view functions called by internal messages.
+	void setLazyStateLoading();
+
+	/// Re-encode only the state variables that are changed by functions called by internal messages.
+	void setPartialStateSaving();
+
+	/// Store the most frequently accessed state variables first in c4.
+	void setOptimizeStorageLayout();
+
+	/// Sets the order of state variables in c4 of the previous version of the contract
+	/// (names from the "fields" section of its ABI). These variables keep their order.
+	void setStorageLayout(std::vector<std::string> _fields);
+
+	/// Sets the maximum size in bits of private functions that are inlined at all call sites.
+	void setInlineThreshold(int _threshold);
+
 	/// Sets the requested contract names by source.
 	/// If empty, no filtering is performed and every contract
 	/// found in the supplied sources is compiled.
@@ -207,6 +246,11 @@ public:
         m_doPrivateFunctionIds = true;
     }
 
+	/// Estimate gas of public functions of the generated code.
+	void printGasReport() {
+		m_doGasReport = true;
+	}
+
 	/// Enable EVM Bytecode generation. This is enabled by default.
 	void enableEvmBytecodeGeneration(bool _enable = true) { m_generateEvmBytecode = _enable; }
 
@@ -309,6 +353,7 @@ public:
 
 	Json::Value const& functionIds(std::string const& _contractName) const;
 	Json::Value const& privateFunctionIds(std::string const& _contractName) const;
+	Json::Value const& gasReport(std::string const& _contractName) const;
 
 	/// @returns a JSON representing the storage layout of the contract.
 	/// Prerequisite: Successful call to parse or compile.
@@ -375,6 +420,7 @@ private:
 		mutable std::unique_ptr<Json::Value const> abi;
 		mutable std::unique_ptr<Json::Value const> functionIds;
 		mutable std::unique_ptr<Json::Value const> privateFunctionIds;
+		mutable std::unique_ptr<Json::Value const> gasReport;
 		util::LazyInit<Json::Value const> storageLayout;
 		util::LazyInit<Json::Value const> userDocumentation;
 		util::LazyInit<Json::Value const> devDocumentation;
@@ -517,7 +563,9 @@ private:
 	std::string m_inputFile;
 	bool m_doPrintFunctionIds = false;
     bool m_doPrivateFunctionIds = false;
+	bool m_doGasReport = false;
 	solidity::langutil::TVMVersion m_tvmVersion;
+	TVMCodegenSettings m_codegenSettings;
 
 	CompilationSourceType m_compilationSourceType = CompilationSourceType::Solidity;
 	MetadataFormat m_metadataFormat = defaultMetadataFormat();
@@ -39,6 +39,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 
 #include <algorithm>
+#include <limits>
 #include <optional>
 
 using namespace solidity;
@@ -182,7 +183,7 @@ bool hashMatchesContent(std::string const& _hash, std::string const& _content)
 
 bool isArtifactRequested(Json::Value const& _outputSelection, std::string const& _artifact, bool _wildcardMatchesExperimental)
 {
-	static std::set<std::string> experimental{"ir", "irAst", "irOptimized", "irOptimizedAst"};
+	static std::set<std::string> experimental{"ir", "irAst", "irOptimized", "irOptimizedAst", "gasReport"};
 	for (auto const& selectedArtifactJson: _outputSelection)
 	{
 		std::string const& selectedArtifact = selectedArtifactJson.asString();
@@ -193,7 +194,7 @@ bool isArtifactRequested(Json::Value const& _outputSelection, std::string const&
 			return true;
 		else if (selectedArtifact == "*")
 		{
-			// "ir", "irOptimized" can only be matched by "*" if activated.
+			// "ir", "irOptimized", "gasReport" can only be matched by "*" if activated.
 			if (experimental.count(_artifact) == 0 || _wildcardMatchesExperimental)
 				return true;
 		}
@@ -311,6 +312,21 @@ bool isIRRequested(Json::Value const& _outputSelection)
 	return false;
 }
 
+/// @returns true if the gas report was requested. It is expensive, so '*' does not match "gasReport"
+bool isGasReportRequested(Json::Value const& _outputSelection)
+{
+	if (!_outputSelection.isObject())
+		return false;
+
+	for (auto const& fileRequests: _outputSelection)
+		for (auto const& requests: fileRequests)
+			for (auto const& request: requests)
+				if (request == "gasReport")
+					return true;
+
+	return false;
+}
+
 std::optional<Json::Value> checkKeys(Json::Value const& _input, std::set<std::string> const& _keys, std::string const& _name)
 {
 	if (!!_input && !_input.isObject())
@@ -344,10 +360,17 @@ std::optional<Json::Value> checkAuxiliaryInputKeys(Json::Value const& _input)
 std::optional<Json::Value> checkSettingsKeys(Json::Value const& _input)
 {
 	static std::set<std::string> keys{"debug", "evmVersion", "libraries", "metadata", "modelChecker", "optimizer", "outputSelection", "remappings", "stopAfter", "viaIR",
-									  "includePaths", "mainContract", "tvmVersion"};
+									  "includePaths", "mainContract", "tvmVersion", "tvmOptimizer"};
 	return checkKeys(_input, keys, "settings");
 }
 
+std::optional<Json::Value> checkTvmOptimizerKeys(Json::Value const& _input)
+{
+	static std::set<std::string> keys{"rounds", "stats", "dataflowPasses", "jobs", "functionProfile", "compareFunctionIds", "optimizeFor", "lazyStateLoading", "partialStateSaving",
+		"optimizeStorageLayout", "storageLayout", "inlineThreshold"};
+	return checkKeys(_input, keys, "settings.tvmOptimizer");
+}
+
 std::optional<Json::Value> checkModelCheckerSettingsKeys(Json::Value const& _input)
 {
 	static std::set<std::string> keys{"bmcLoopIterations", "contracts", "divModNoSlacks", "engine", "extCalls", "invariants", "printQuery", "showProvedSafe", "showUnproved", "showUnsupported", "solvers", "targets", "timeout"};
@@ -735,6 +758,107 @@ std::variant<StandardCompiler::InputsAndSettings, Json::Value> StandardCompiler:
 		ret.tvmVersion = *version;
 	}
 
+	if (settings.isMember("tvmOptimizer"))
+	{
+		Json::Value const& tvmOptimizer = settings["tvmOptimizer"];
+		if (auto result = checkTvmOptimizerKeys(tvmOptimizer))
+			return *result;
+
+		if (tvmOptimizer.isMember("rounds"))
+		{
+			if (!tvmOptimizer["rounds"].isInt() || tvmOptimizer["rounds"].asInt() < 0)
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.rounds\" must be a non-negative integer.");
+			ret.tvmOptimizerRounds = tvmOptimizer["rounds"].asInt();
+		}
+
+		if (tvmOptimizer.isMember("stats"))
+		{
+			if (!tvmOptimizer["stats"].isBool())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.stats\" must be a Boolean.");
+			ret.tvmOptimizerStats = tvmOptimizer["stats"].asBool();
+		}
+
+		if (tvmOptimizer.isMember("jobs"))
+		{
+			if (!tvmOptimizer["jobs"].isUInt())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.jobs\" must be an unsigned number.");
+			ret.jobs = tvmOptimizer["jobs"].asUInt();
+		}
+
+		if (tvmOptimizer.isMember("functionProfile"))
+		{
+			if (std::optional<std::string> error = parseFunctionProfile(tvmOptimizer["functionProfile"], ret.functionProfile))
+				return formatFatalError(Error::Type::JSONError, "Invalid \"settings.tvmOptimizer.functionProfile\": " + *error);
+		}
+
+		if (tvmOptimizer.isMember("compareFunctionIds"))
+		{
+			if (!tvmOptimizer["compareFunctionIds"].isBool())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.compareFunctionIds\" must be a Boolean.");
+			ret.compareFunctionIds = tvmOptimizer["compareFunctionIds"].asBool();
+		}
+
+		if (tvmOptimizer.isMember("optimizeFor"))
+		{
+			std::string const objective = tvmOptimizer["optimizeFor"].isString() ? tvmOptimizer["optimizeFor"].asString() : "";
+			if (objective == "size")
+				ret.optimizeFor = OptimizationObjective::Size;
+			else if (objective == "gas")
+				ret.optimizeFor = OptimizationObjective::Gas;
+			else if (objective == "balanced")
+				ret.optimizeFor = OptimizationObjective::Balanced;
+			else
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.optimizeFor\" must be \"size\", \"gas\" or \"balanced\".");
+		}
+
+		if (tvmOptimizer.isMember("dataflowPasses"))
+		{
+			if (!tvmOptimizer["dataflowPasses"].isBool())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.dataflowPasses\" must be a Boolean.");
+			ret.dataflowPasses = tvmOptimizer["dataflowPasses"].asBool();
+		}
+
+		if (tvmOptimizer.isMember("lazyStateLoading"))
+		{
+			if (!tvmOptimizer["lazyStateLoading"].isBool())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.lazyStateLoading\" must be a Boolean.");
+			ret.lazyStateLoading = tvmOptimizer["lazyStateLoading"].asBool();
+		}
+
+		if (tvmOptimizer.isMember("partialStateSaving"))
+		{
+			if (!tvmOptimizer["partialStateSaving"].isBool())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.partialStateSaving\" must be a Boolean.");
+			ret.partialStateSaving = tvmOptimizer["partialStateSaving"].asBool();
+		}
+
+		if (tvmOptimizer.isMember("optimizeStorageLayout"))
+		{
+			if (!tvmOptimizer["optimizeStorageLayout"].isBool())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.optimizeStorageLayout\" must be a Boolean.");
+			ret.optimizeStorageLayout = tvmOptimizer["optimizeStorageLayout"].asBool();
+		}
+
+		if (tvmOptimizer.isMember("storageLayout"))
+		{
+			if (!tvmOptimizer["storageLayout"].isArray())
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.storageLayout\" must be an array of state variable names.");
+			for (Json::Value const& name: tvmOptimizer["storageLayout"])
+			{
+				if (!name.isString())
+					return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.storageLayout\" must be an array of state variable names.");
+				ret.storageLayout.emplace_back(name.asString());
+			}
+		}
+
+		if (tvmOptimizer.isMember("inlineThreshold"))
+		{
+			if (!tvmOptimizer["inlineThreshold"].isInt() || tvmOptimizer["inlineThreshold"].asInt() < 0)
+				return formatFatalError(Error::Type::JSONError, "\"settings.tvmOptimizer.inlineThreshold\" must be a non-negative integer.");
+			ret.inlineThreshold = tvmOptimizer["inlineThreshold"].asInt();
+		}
+	}
+
 	if (settings.isMember("debug"))
 	{
 		if (auto result = checkKeys(settings["debug"], {"revertStrings", "debugInfo"}, "settings.debug"))
@@ -1027,9 +1151,34 @@ Json::Value StandardCompiler::compileSolidity(StandardCompiler::InputsAndSetting
 	compilerStack.setInputFile(sourceList.begin()->first);
 	compilerStack.setMainContract(_inputsAndSettings.mainContract);
 	compilerStack.setTVMVersion(_inputsAndSettings.tvmVersion);
+	if (_inputsAndSettings.tvmOptimizerRounds.has_value())
+		compilerStack.setOptimizerRounds(*_inputsAndSettings.tvmOptimizerRounds);
+	if (_inputsAndSettings.tvmOptimizerStats)
+		compilerStack.printOptimizerStats();
+	if (!_inputsAndSettings.dataflowPasses)
+		compilerStack.disableDataflowPasses();
+	if (_inputsAndSettings.jobs.has_value())
+		compilerStack.setJobs(*_inputsAndSettings.jobs);
+	if (!_inputsAndSettings.functionProfile.empty())
+		compilerStack.setFunctionProfile(_inputsAndSettings.functionProfile);
+	if (_inputsAndSettings.compareFunctionIds)
+		compilerStack.setCompareFunctionIds();
+	compilerStack.setOptimizeFor(_inputsAndSettings.optimizeFor);
+	if (_inputsAndSettings.lazyStateLoading)
+		compilerStack.setLazyStateLoading();
+	if (_inputsAndSettings.partialStateSaving)
+		compilerStack.setPartialStateSaving();
+	if (_inputsAndSettings.optimizeStorageLayout)
+		compilerStack.setOptimizeStorageLayout();
+	if (!_inputsAndSettings.storageLayout.empty())
+		compilerStack.setStorageLayout(_inputsAndSettings.storageLayout);
+	if (_inputsAndSettings.inlineThreshold.has_value())
+		compilerStack.setInlineThreshold(*_inputsAndSettings.inlineThreshold);
 	compilerStack.generateAbi();
 	if (binariesRequested)
 		compilerStack.generateCode();
+	if (isGasReportRequested(_inputsAndSettings.outputSelection))
+		compilerStack.printGasReport();
 	compilerStack.printFunctionIds();
 	compilerStack.printPrivateFunctionIds();
 
@@ -1190,6 +1339,8 @@ Json::Value StandardCompiler::compileSolidity(StandardCompiler::InputsAndSetting
 		contractData["assembly"] = compilerStack.contractCode(contractName);
 		contractData["functionIds"] = compilerStack.functionIds(contractName);
 		contractData["privateFunctionIds"] = compilerStack.privateFunctionIds(contractName);
+		if (isArtifactRequested(_inputsAndSettings.outputSelection, file, name, "gasReport", wildcardMatchesExperimental))
+			contractData["gasReport"] = compilerStack.gasReport(contractName);
 		contractData["metadata"] = compilerStack.metadata(contractName);
 		contractData["userdoc"] = compilerStack.natspecUser(contractName);
 		contractData["devdoc"] = compilerStack.natspecDev(contractName);
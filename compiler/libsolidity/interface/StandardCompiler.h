@@ -89,6 +89,18 @@ private:
 		CompilerStack::MetadataHash metadataHash = CompilerStack::MetadataHash::IPFS;
 		Json::Value outputSelection;
 		bool viaIR = false;
+		std::optional<int> tvmOptimizerRounds;
+		bool tvmOptimizerStats = false;
+		bool dataflowPasses = true;
+		std::optional<unsigned> jobs;
+		std::map<uint32_t, double> functionProfile;
+		bool compareFunctionIds = false;
+		OptimizationObjective optimizeFor = OptimizationObjective::Balanced;
+		bool lazyStateLoading = false;
+		bool partialStateSaving = false;
+		bool optimizeStorageLayout = false;
+		std::vector<std::string> storageLayout;
+		std::optional<int> inlineThreshold;
 	};
 
 	/// Parses the input json (and potentially invokes the read callback) and either returns
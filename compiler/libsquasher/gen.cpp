@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2025 EverX. All Rights Reserved.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * Generator of the precomputed StackOpcodeSquasher tables.
+ * Usage: squasher-gen <output header>
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include <libsolidity/codegen/StackState.hpp>
+
+using namespace solidity::frontend;
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		std::cerr << "Usage: " << argv[0] << " <output header>" << std::endl;
+		return 1;
+	}
+	std::ofstream out{argv[1]};
+	if (!out) {
+		std::cerr << "Failed to open the output file: " << argv[1] << std::endl;
+		return 1;
+	}
+
+	out << "// The generation of this file is defined in libsquasher/CMakeLists.txt.\n";
+	out << "// This file was generated by libsquasher/gen.cpp, see buildStackDpTable().\n\n";
+	out << "#pragma once\n\n";
+	out << "#include <cstddef>\n";
+	out << "#include <cstdint>\n\n";
+	out << "namespace solidity::frontend::squasher\n{\n\n";
+
+	for (int withCompound = 0; withCompound <= 1; ++withCompound) {
+		for (int size = 0; size <= StackState::MAX_STACK_DEPTH; ++size) {
+			std::vector<uint64_t> table = buildStackDpTable(size, withCompound);
+			out << "static constexpr uint64_t table" << withCompound << "_" << size << "[] = {";
+			for (size_t i = 0; i < table.size(); ++i) {
+				if (i % 8 == 0)
+					out << "\n\t";
+				out << "0x" << std::hex << table[i] << std::dec << "u,";
+			}
+			out << "\n};\n\n";
+		}
+	}
+
+	out << "struct TableRef {\n\tuint64_t const* data;\n\tstd::size_t size;\n};\n\n";
+	out << "static constexpr TableRef tables[2][" << StackState::MAX_STACK_DEPTH + 1 << "] = {\n";
+	for (int withCompound = 0; withCompound <= 1; ++withCompound) {
+		out << "\t{\n";
+		for (int size = 0; size <= StackState::MAX_STACK_DEPTH; ++size) {
+			std::string name = "table" + std::to_string(withCompound) + "_" + std::to_string(size);
+			out << "\t\t{" << name << ", sizeof(" << name << ") / sizeof(uint64_t)},\n";
+		}
+		out << "\t},\n";
+	}
+	out << "};\n\n";
+	out << "} // namespace solidity::frontend::squasher\n";
+	return 0;
+}
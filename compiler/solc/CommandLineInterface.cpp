@@ -543,8 +543,33 @@ void CommandLineInterface::compile()
 			m_compiler->printFunctionIds();
 		if (m_options.tvmParams.printPrivateFunctionIds)
 			m_compiler->printPrivateFunctionIds();
+		if (m_options.tvmParams.printGasReport)
+			m_compiler->printGasReport();
 		m_compiler->setOutputFolder(m_options.output.dir.string());
 		m_compiler->setTVMVersion(m_options.tvmParams.tvmVersion);
+		if (m_options.tvmParams.optimizerRounds.has_value())
+			m_compiler->setOptimizerRounds(m_options.tvmParams.optimizerRounds.value());
+		if (m_options.tvmParams.printOptimizerStats)
+			m_compiler->printOptimizerStats();
+		if (!m_options.tvmParams.dataflowPasses)
+			m_compiler->disableDataflowPasses();
+		if (m_options.tvmParams.jobs.has_value())
+			m_compiler->setJobs(m_options.tvmParams.jobs.value());
+		if (!m_options.tvmParams.functionProfile.empty())
+			m_compiler->setFunctionProfile(m_options.tvmParams.functionProfile);
+		if (m_options.tvmParams.compareFunctionIds)
+			m_compiler->setCompareFunctionIds();
+		m_compiler->setOptimizeFor(m_options.tvmParams.optimizeFor);
+		if (m_options.tvmParams.lazyStateLoading)
+			m_compiler->setLazyStateLoading();
+		if (m_options.tvmParams.partialStateSaving)
+			m_compiler->setPartialStateSaving();
+		if (m_options.tvmParams.optimizeStorageLayout)
+			m_compiler->setOptimizeStorageLayout();
+		if (!m_options.tvmParams.storageLayout.empty())
+			m_compiler->setStorageLayout(m_options.tvmParams.storageLayout);
+		if (m_options.tvmParams.inlineThreshold.has_value())
+			m_compiler->setInlineThreshold(m_options.tvmParams.inlineThreshold.value());
 
 		bool successful = true;
 		bool didCompileSomething = false;
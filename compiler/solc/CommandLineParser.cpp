@@ -98,7 +98,20 @@ static std::string const g_strAsm = "asm";
 static std::string const g_strABI = "abi-json";
 static std::string const g_strFunctionIds = "function-ids";
 static std::string const g_strPrivateFunctionIds = "private-function-ids";
+static std::string const g_strGasReport = "gas-report";
 static std::string const g_strTVMVersion = "tvm-version";
+static std::string const g_strOptimizerRounds = "optimizer-rounds";
+static std::string const g_strOptimizerStats = "optimizer-stats";
+static std::string const g_strNoDataflowPasses = "no-dataflow-passes";
+static std::string const g_strJobs = "jobs";
+static std::string const g_strFunctionProfile = "function-profile";
+static std::string const g_strCompareFunctionIds = "compare-function-ids";
+static std::string const g_strOptimizeFor = "optimize-for";
+static std::string const g_strLazyStateLoading = "lazy-state-loading";
+static std::string const g_strPartialStateSaving = "partial-state-saving";
+static std::string const g_strOptimizeStorageLayout = "optimize-storage-layout";
+static std::string const g_strStorageLayout = "storage-layout";
+static std::string const g_strInlineThreshold = "inline-threshold";
 
 
 /// Possible arguments to for --revert-strings
@@ -371,6 +384,51 @@ void CommandLineParser::parseInputPathsAndRemappings()
 		);
 }
 
+void CommandLineParser::parseFunctionProfile(std::string const& _path)
+{
+	std::string data;
+	try
+	{
+		data = util::readFileAsString(_path);
+	}
+	catch (util::Exception const&)
+	{
+		solThrow(CommandLineValidationError, "Failed to read the function profile: \"" + _path + "\"");
+	}
+
+	Json::Value profile;
+	std::string errors;
+	if (!util::jsonParseStrict(data, profile, &errors))
+		solThrow(CommandLineValidationError, "Invalid function profile \"" + _path + "\": a JSON object is expected. " + errors);
+	if (std::optional<std::string> error = ::parseFunctionProfile(profile, m_options.tvmParams.functionProfile))
+		solThrow(CommandLineValidationError, "Invalid function profile \"" + _path + "\": " + *error);
+}
+
+void CommandLineParser::parseStorageLayout(std::string const& _path)
+{
+	std::string data;
+	try
+	{
+		data = util::readFileAsString(_path);
+	}
+	catch (util::Exception const&)
+	{
+		solThrow(CommandLineValidationError, "Failed to read the storage layout: \"" + _path + "\"");
+	}
+
+	Json::Value abi;
+	std::string errors;
+	if (!util::jsonParseStrict(data, abi, &errors) || !abi.isObject() || !abi["fields"].isArray())
+		solThrow(CommandLineValidationError, "Invalid storage layout \"" + _path + "\": an ABI with the \"fields\" section is expected. " + errors);
+
+	for (Json::Value const& field: abi["fields"])
+	{
+		if (!field.isObject() || !field["name"].isString())
+			solThrow(CommandLineValidationError, "Invalid storage layout \"" + _path + "\": every field must have a name.");
+		m_options.tvmParams.storageLayout.emplace_back(field["name"].asString());
+	}
+}
+
 void CommandLineParser::parseLibraryOption(std::string const& _input)
 {
 	namespace fs = boost::filesystem;
@@ -619,6 +677,83 @@ General Information)").c_str(),
 	;
 	desc.add(outputOptions);
 
+	po::options_description optimizerOptions("Optimizer Options");
+	optimizerOptions.add_options()
+		(
+			g_strOptimizerRounds.c_str(),
+			po::value<int>()->value_name("N"),
+			"Set the maximum number of peephole and stack optimizer rounds. "
+			"Optimization of a function stops earlier if a round doesn't change it."
+		)
+		(
+			g_strOptimizerStats.c_str(),
+			"Print the number of optimizer rounds, time spent in each optimizer pass, "
+			"what was removed and inlined and the expected gas of the function selectors "
+			"built from --function-profile to stderr."
+		)
+		(
+			g_strNoDataflowPasses.c_str(),
+			"Don't run dictionary lookup elimination, loop invariant hoisting and constant propagation "
+			"in the rounds of the optimizer."
+		)
+		(
+			g_strJobs.c_str(),
+			po::value<unsigned>()->value_name("N"),
+			"Optimize functions of a contract in N threads. The output doesn't depend on N. "
+			"If N is 0, the number of hardware threads is used."
+		)
+		(
+			g_strFunctionProfile.c_str(),
+			po::value<std::string>()->value_name("path"),
+			"JSON file with call frequencies of public functions, e.g. {\"0x1234abcd\": 1000}, where keys are "
+			"function ids from --function-ids. The most frequently called functions are checked before "
+			"the dictionary lookup in the function selector if it reduces the expected gas."
+		)
+		(
+			g_strCompareFunctionIds.c_str(),
+			"Without --function-profile, consider public functions equally frequent: contracts with 2..7 "
+			"public functions compare the function id with each id before the dictionary lookup."
+		)
+		(
+			g_strOptimizeFor.c_str(),
+			po::value<std::string>()->value_name("size|gas|balanced")->default_value("balanced"),
+			"Select what the size optimizer prefers when it moves repeated slices to shared cells: "
+			"the smallest code (size), the lowest gas (gas) or a trade-off between them (balanced)."
+		)
+		(
+			g_strLazyStateLoading.c_str(),
+			"Decode only the state variables that a view function reads when it's called by an internal message. "
+			"Other functions decode all state variables."
+		)
+		(
+			g_strPartialStateSaving.c_str(),
+			"Re-encode only the state variables that a function can change when it's called by an internal message. "
+			"c4 isn't saved at all if the function doesn't change state variables."
+		)
+		(
+			g_strOptimizeStorageLayout.c_str(),
+			"Store the most frequently accessed state variables first in c4. "
+			"The order is written to the \"fields\" section of the ABI and is used by abi.decodeData. "
+			"It changes the storage layout, so don't use it for contracts that are upgraded by tvm.setcode "
+			"unless the layout of the previous version is given by --storage-layout."
+		)
+		(
+			g_strStorageLayout.c_str(),
+			po::value<std::string>()->value_name("path"),
+			"ABI file of the previous version of the contract. State variables listed in its \"fields\" section "
+			"keep their order in c4, new state variables are stored after them. "
+			"Use it to keep the data valid when the contract is upgraded by tvm.setcode."
+		)
+		(
+			g_strInlineThreshold.c_str(),
+			po::value<int>()->value_name("bits"),
+			"Inline calls of private functions whose code isn't larger than the given number of bits. "
+			"Functions with one call site are also inlined unless the value is 0, which turns inlining off. "
+			"The default value is 32 for --optimize-for size, 64 for balanced and 256 for gas."
+		)
+	;
+	desc.add(optimizerOptions);
+
 	po::options_description outputFormatting("Output Formatting");
 	outputFormatting.add_options()
 		(
@@ -651,6 +786,7 @@ General Information)").c_str(),
 		(g_strABI.c_str(), "ABI specification of the contracts")
 		(g_strFunctionIds.c_str(), "Print name and id for each public function.")
 		(g_strPrivateFunctionIds.c_str(), "Print name and id for each private function.")
+		(g_strGasReport.c_str(), "Print min, typical and max gas estimated for each public function.")
 		(CompilerOutputs::componentName(&CompilerOutputs::astCompactJson).c_str(), "AST of all source files in a compact JSON format.")
 		(CompilerOutputs::componentName(&CompilerOutputs::natspecUser).c_str(), "Natspec user documentation of all contracts.")
 		(CompilerOutputs::componentName(&CompilerOutputs::natspecDev).c_str(), "Natspec developer documentation of all contracts.")
@@ -1033,6 +1169,51 @@ void CommandLineParser::processArgs()
 		m_options.tvmParams.tvmVersion = *versionOption;
 	}
 
+	if (m_args.count(g_strOptimizerRounds))
+	{
+		int rounds = m_args[g_strOptimizerRounds].as<int>();
+		if (rounds < 0)
+			solThrow(CommandLineValidationError, "Invalid option for --" + g_strOptimizerRounds + ": " + std::to_string(rounds));
+		m_options.tvmParams.optimizerRounds = rounds;
+	}
+	if (m_args.count(g_strOptimizerStats))
+		m_options.tvmParams.printOptimizerStats = true;
+	if (m_args.count(g_strJobs))
+		m_options.tvmParams.jobs = m_args[g_strJobs].as<unsigned>();
+	if (m_args.count(g_strFunctionProfile))
+		parseFunctionProfile(m_args[g_strFunctionProfile].as<std::string>());
+	if (m_args.count(g_strCompareFunctionIds))
+		m_options.tvmParams.compareFunctionIds = true;
+	if (m_args.count(g_strOptimizeFor))
+	{
+		std::string const objective = m_args[g_strOptimizeFor].as<std::string>();
+		if (objective == "size")
+			m_options.tvmParams.optimizeFor = OptimizationObjective::Size;
+		else if (objective == "gas")
+			m_options.tvmParams.optimizeFor = OptimizationObjective::Gas;
+		else if (objective == "balanced")
+			m_options.tvmParams.optimizeFor = OptimizationObjective::Balanced;
+		else
+			solThrow(CommandLineValidationError, "Invalid option for --" + g_strOptimizeFor + ": " + objective);
+	}
+	if (m_args.count(g_strNoDataflowPasses))
+		m_options.tvmParams.dataflowPasses = false;
+	if (m_args.count(g_strLazyStateLoading))
+		m_options.tvmParams.lazyStateLoading = true;
+	if (m_args.count(g_strPartialStateSaving))
+		m_options.tvmParams.partialStateSaving = true;
+	if (m_args.count(g_strOptimizeStorageLayout))
+		m_options.tvmParams.optimizeStorageLayout = true;
+	if (m_args.count(g_strStorageLayout))
+		parseStorageLayout(m_args[g_strStorageLayout].as<std::string>());
+	if (m_args.count(g_strInlineThreshold))
+	{
+		int threshold = m_args[g_strInlineThreshold].as<int>();
+		if (threshold < 0)
+			solThrow(CommandLineValidationError, "Invalid option for --" + g_strInlineThreshold + ": " + std::to_string(threshold));
+		m_options.tvmParams.inlineThreshold = threshold;
+	}
+
 	if (m_args.count(g_strContract))
 		m_options.tvmParams.mainContract = m_args[g_strContract].as<std::string>();
 	if (m_args.count(g_strOutputPrefix))
@@ -1045,12 +1226,15 @@ void CommandLineParser::processArgs()
 		m_options.tvmParams.printFunctionIds = true;
 	if (m_args.count(g_strPrivateFunctionIds))
 		m_options.tvmParams.printPrivateFunctionIds = true;
+	if (m_args.count(g_strGasReport))
+		m_options.tvmParams.printGasReport = true;
 
 	if (
 		!m_options.tvmParams.code &&
 		!m_options.tvmParams.abi &&
 		!m_options.tvmParams.printFunctionIds &&
 		!m_options.tvmParams.printPrivateFunctionIds &&
+		!m_options.tvmParams.printGasReport &&
 		m_args.count("ast-compact-json") == 0 &&
 		m_args.count("userdoc") == 0 &&
 		m_args.count("devdoc") == 0
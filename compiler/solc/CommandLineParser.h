@@ -232,7 +232,20 @@ struct CommandLineOptions
 		bool abi = false;
 		bool printFunctionIds = false;
 		bool printPrivateFunctionIds = false;
+		bool printGasReport = false;
 		langutil::TVMVersion tvmVersion;
+		std::optional<int> optimizerRounds;
+		bool printOptimizerStats = false;
+		bool dataflowPasses = true;
+		std::optional<unsigned> jobs;
+		std::map<uint32_t, double> functionProfile;
+		bool compareFunctionIds = false;
+		OptimizationObjective optimizeFor = OptimizationObjective::Balanced;
+		bool lazyStateLoading = false;
+		bool partialStateSaving = false;
+		bool optimizeStorageLayout = false;
+		std::vector<std::string> storageLayout;
+		std::optional<int> inlineThreshold;
 	} tvmParams;
 };
 
@@ -282,6 +295,16 @@ private:
 	/// @throws CommandLineValidationError in case of validation errors.
 	void parseLibraryOption(std::string const& _input);
 
+	/// Reads call frequencies of public functions from the JSON file @a _path like {"0x1234abcd": 1000, ...},
+	/// where keys are function ids printed by --function-ids, and stores them in @a m_options.tvmParams.
+	/// @throws CommandLineValidationError in case of validation errors.
+	void parseFunctionProfile(std::string const& _path);
+
+	/// Reads the names of state variables from the "fields" section of the ABI file @a _path
+	/// of the previous version of the contract and stores them in @a m_options.tvmParams.
+	/// @throws CommandLineValidationError in case of validation errors.
+	void parseStorageLayout(std::string const& _path);
+
 	void parseOutputSelection();
 
 	void checkMutuallyExclusive(std::vector<std::string> const& _optionNames);
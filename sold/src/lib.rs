@@ -124,6 +124,11 @@ fn compile(
     } else {
         ", \"assembly\""
     };
+    let gas_report = if args.gas_report {
+        ", \"gasReport\""
+    } else {
+        ""
+    };
     let doc = if args.userdoc || args.devdoc {
         ", \"userdoc\", \"devdoc\""
     } else {
@@ -136,6 +141,7 @@ fn compile(
         }
     };
     let main_contract = args.contract.clone().unwrap_or_default();
+    let tvm_optimizer = tvm_optimizer_to_json_string(args)?;
     let remappings = remappings_to_json_string(remappings);
     let input_json = format!(
         r#"
@@ -143,11 +149,12 @@ fn compile(
             "language": "Solidity",
             "settings": {{
                 {tvm_version}
+                {tvm_optimizer}
                 "mainContract": "{main_contract}",
                 "remappings": {remappings},
                 "outputSelection": {{
                     "{source_unit_name}": {{
-                        "*": [ "abi"{assembly}{show_function_ids}{show_private_function_ids}{doc} ],
+                        "*": [ "abi"{assembly}{show_function_ids}{show_private_function_ids}{gas_report}{doc} ],
                         "": [ "ast" ]
                     }}
                 }}
@@ -175,6 +182,64 @@ fn compile(
     Ok((source_unit_name.clone(), res))
 }
 
+fn tvm_optimizer_to_json_string(args: &SoldArgs) -> Result<String> {
+    let mut settings = serde_json::Map::new();
+    if let Some(rounds) = args.optimizer_rounds {
+        settings.insert("rounds".to_string(), json!(rounds));
+    }
+    if args.optimizer_stats {
+        settings.insert("stats".to_string(), json!(true));
+    }
+    if args.no_dataflow_passes {
+        settings.insert("dataflowPasses".to_string(), json!(false));
+    }
+    if let Some(jobs) = args.jobs {
+        settings.insert("jobs".to_string(), json!(jobs));
+    }
+    if let Some(ref path) = args.function_profile {
+        let profile: serde_json::Value = serde_json::from_str(&std::fs::read_to_string(path)?)
+            .map_err(|e| format_err!("Invalid function profile \"{}\": {}", path, e))?;
+        settings.insert("functionProfile".to_string(), profile);
+    }
+    if args.compare_function_ids {
+        settings.insert("compareFunctionIds".to_string(), json!(true));
+    }
+    if let Some(optimize_for) = args.optimize_for {
+        settings.insert("optimizeFor".to_string(), json!(optimize_for.to_string()));
+    }
+    if args.lazy_state_loading {
+        settings.insert("lazyStateLoading".to_string(), json!(true));
+    }
+    if args.partial_state_saving {
+        settings.insert("partialStateSaving".to_string(), json!(true));
+    }
+    if args.optimize_storage_layout {
+        settings.insert("optimizeStorageLayout".to_string(), json!(true));
+    }
+    if let Some(ref path) = args.storage_layout {
+        let abi: serde_json::Value = serde_json::from_str(&std::fs::read_to_string(path)?)
+            .map_err(|e| format_err!("Invalid storage layout \"{}\": {}", path, e))?;
+        let fields = abi["fields"]
+            .as_array()
+            .ok_or_else(|| format_err!("Invalid storage layout \"{}\": no \"fields\" section", path))?;
+        let mut names = vec![];
+        for field in fields {
+            let name = field["name"]
+                .as_str()
+                .ok_or_else(|| format_err!("Invalid storage layout \"{}\": every field must have a name", path))?;
+            names.push(json!(name));
+        }
+        settings.insert("storageLayout".to_string(), serde_json::Value::Array(names));
+    }
+    if let Some(threshold) = args.inline_threshold {
+        settings.insert("inlineThreshold".to_string(), json!(threshold));
+    }
+    if settings.is_empty() {
+        return Ok(String::new());
+    }
+    Ok(format!(r#""tvmOptimizer": {},"#, serde_json::Value::Object(settings)))
+}
+
 fn remappings_to_json_string(remappings: Vec<String>) -> String {
     let mut out = String::from("[ ");
     let len = remappings.len();
@@ -395,6 +460,11 @@ pub fn run_sold(args: SoldArgs) -> Status {
         return Ok(());
     }
 
+    if args.gas_report {
+        println!("{}", serde_json::to_string_pretty(&out["gasReport"])?);
+        return Ok(());
+    }
+
     let input_file_stem = input_canonical
         .file_stem()
         .ok_or_else(|| format_err!("Failed to extract file stem"))?
@@ -516,6 +586,23 @@ impl fmt::Display for TvmVersion {
     }
 }
 
+#[derive(Copy, Debug, Clone, PartialEq, Eq, PartialOrd, Ord, ValueEnum)]
+pub enum OptimizeFor {
+    Size,
+    Gas,
+    Balanced,
+}
+
+impl fmt::Display for OptimizeFor {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        match self {
+            OptimizeFor::Size => write!(f, "size"),
+            OptimizeFor::Gas => write!(f, "gas"),
+            OptimizeFor::Balanced => write!(f, "balanced"),
+        }
+    }
+}
+
 #[derive(Parser, Debug)]
 #[clap(author, about = "sold, the TVM Solidity commandline driver", long_about = None)]
 #[clap(arg_required_else_help = true)]
@@ -558,6 +645,47 @@ pub struct SoldArgs {
     #[clap(long, value_enum)]
     pub tvm_version: Option<TvmVersion>,
 
+    // Optimizer Options:
+    /// Maximum number of rounds of the TVM code optimizer
+    #[clap(long, value_parser, value_names = &["ROUNDS"])]
+    pub optimizer_rounds: Option<u32>,
+    /// Print statistics of the TVM code optimizer to stderr
+    #[clap(long, value_parser)]
+    pub optimizer_stats: bool,
+    /// Don't run dictionary lookup elimination, loop invariant hoisting and constant propagation
+    #[clap(long, value_parser)]
+    pub no_dataflow_passes: bool,
+    /// Optimize functions of a contract in N threads. The output does not depend on N (0 means the number of hardware threads)
+    #[clap(short('j'), long, value_parser, value_names = &["N"])]
+    pub jobs: Option<u32>,
+    /// JSON file with call frequencies of public functions, e.g. {"0x1234abcd": 1000}.
+    /// Frequently called functions are checked before the dictionary lookup in the function selector
+    #[clap(long, value_parser, value_names = &["PATH"])]
+    pub function_profile: Option<String>,
+    /// Without a function profile consider public functions equally frequent,
+    /// so contracts with 2..7 public functions compare the function id with each id before the dictionary lookup
+    #[clap(long, value_parser)]
+    pub compare_function_ids: bool,
+    /// Select what the size optimizer prefers: the smallest code, the lowest gas or a trade-off between them (balanced by default)
+    #[clap(long, value_enum)]
+    pub optimize_for: Option<OptimizeFor>,
+    /// Decode only the state variables that a view function reads when it's called by an internal message
+    #[clap(long, value_parser)]
+    pub lazy_state_loading: bool,
+    /// Re-encode only the state variables that a function can change when it's called by an internal message
+    #[clap(long, value_parser)]
+    pub partial_state_saving: bool,
+    /// Store the most frequently accessed state variables first in c4.
+    /// Don't use it for contracts upgraded by tvm.setcode without --storage-layout
+    #[clap(long, value_parser)]
+    pub optimize_storage_layout: bool,
+    /// ABI file of the previous version of the contract. State variables listed in its "fields" section keep their order in c4
+    #[clap(long, value_parser, value_names = &["PATH"])]
+    pub storage_layout: Option<String>,
+    /// Maximum size in bits of private functions that are inlined at every call site. Functions with one call site are also inlined. 0 turns inlining off
+    #[clap(long, value_parser, value_names = &["BITS"])]
+    pub inline_threshold: Option<u32>,
+
     //Output Components:
     /// ABI specification of the contracts
     #[clap(long, value_parser)]
@@ -568,6 +696,9 @@ pub struct SoldArgs {
     /// Print name and id for each private function
     #[clap(long, value_parser)]
     pub private_function_ids: bool,
+    /// Print the estimated min, typical and max gas of each public function and getter
+    #[clap(long, value_parser)]
+    pub gas_report: bool,
     /// AST of all source files in a compact JSON format
     #[clap(long, value_parser)]
     pub ast_compact_json: bool,
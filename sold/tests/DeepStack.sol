@@ -0,0 +1,25 @@
+pragma tvm-solidity >=0.50.0;
+
+contract DeepStack {
+	uint m_value;
+
+	function mix(uint a, uint b, uint c, uint d, uint e, uint f, uint g, uint h, uint i, uint j, uint k, uint l) private pure returns (uint) {
+		return ((a + l) * (b + k) + (c + j) * (d + i)) ^ ((e + h) * (f + g));
+	}
+
+	function run(uint x) public {
+		uint a = x + 1;
+		uint b = x * 3;
+		uint c = a ^ b;
+		uint d = c + 7;
+		uint e = d * a;
+		uint f = e - b;
+		uint g = f | c;
+		uint h = g & d;
+		uint i = h + e;
+		uint j = i * f;
+		uint k = j ^ g;
+		uint l = k + h;
+		m_value = mix(l, k, j, i, h, g, f, e, d, c, b, a) + mix(a, c, e, g, i, k, b, d, f, h, j, l);
+	}
+}
@@ -0,0 +1,53 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Dispatch {
+	uint m_value;
+
+	function f0(uint value) public {
+		m_value = value + 0;
+	}
+
+	function f1(uint value) public {
+		m_value = value + 1;
+	}
+
+	function f2(uint value) public {
+		m_value = value + 2;
+	}
+
+	function f3(uint value) public {
+		m_value = value + 3;
+	}
+
+	function f4(uint value) public {
+		m_value = value + 4;
+	}
+
+	function f5(uint value) public {
+		m_value = value + 5;
+	}
+
+	function f6(uint value) public {
+		m_value = value + 6;
+	}
+
+	function f7(uint value) public {
+		m_value = value + 7;
+	}
+
+	function f8(uint value) public {
+		m_value = value + 8;
+	}
+
+	receive() external {
+		m_value = 100;
+	}
+
+	fallback() external {
+		m_value = 101;
+	}
+
+	onBounce(TvmSlice) external {
+		m_value = 102;
+	}
+}
@@ -0,0 +1,11 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Fold {
+	function fold(uint a) public pure returns (uint) {
+		uint x = 2;
+		uint y = x + 1;
+		if (y > 10)
+			a += 5;
+		return a * y;
+	}
+}
@@ -0,0 +1,14 @@
+pragma tvm-solidity >=0.50.0;
+
+function addHex(uint a) assembly pure returns (uint) {
+	"PUSHINT 0x10",
+	"ADD",
+	"PUSHINT -0x2",
+	"MUL",
+}
+
+contract HexPushint {
+	function f(uint a) public pure returns (uint) {
+		return addHex(a) + 1;
+	}
+}
@@ -0,0 +1,21 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Inline {
+	uint m_value;
+
+	function add(uint a, uint b) private pure returns (uint) {
+		return a + b;
+	}
+
+	function twice(uint a) private pure returns (uint) {
+		return a * 2;
+	}
+
+	function inc() public {
+		m_value = twice(add(m_value, 1));
+	}
+
+	function dec(uint value) public view returns (uint) {
+		return add(m_value, value);
+	}
+}
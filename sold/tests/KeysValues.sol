@@ -0,0 +1,45 @@
+pragma tvm-solidity >=0.50.0;
+
+contract KeysValues {
+	mapping(uint32 => uint64) m_map;
+	uint m_sum;
+
+	function sumKeys() public {
+		uint s = 0;
+		for (uint32 k : m_map.keys())
+			s += k;
+		m_sum = s;
+	}
+
+	function sumKeysOfPairs() public {
+		uint s = 0;
+		for ((uint32 k, ) : m_map)
+			s += k;
+		m_sum = s;
+	}
+
+	function sumValues() public {
+		uint s = 0;
+		for (uint64 v : m_map.values())
+			s += v;
+		m_sum = s;
+	}
+
+	function sumValuesOfPairs() public {
+		uint s = 0;
+		for ((, uint64 v) : m_map)
+			s += v;
+		m_sum = s;
+	}
+
+	// the loop iterates over the mapping as it was before the loop
+	function shiftKeys() public {
+		for (uint32 k : m_map.keys())
+			m_map[k + 1] = 7;
+	}
+
+	function shiftKeysOfPairs() public {
+		for ((uint32 k, ) : m_map)
+			m_map[k + 1] = 7;
+	}
+}
@@ -0,0 +1,18 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Layout {
+	uint m_cold;
+	uint m_hot;
+	uint m_new;
+
+	function setCold(uint value) public {
+		m_cold = value;
+	}
+
+	function sum(uint n) public view returns (uint s) {
+		for (uint i = 0; i < n; ++i) {
+			s += m_hot + m_hot;
+		}
+		s += m_new * m_new;
+	}
+}
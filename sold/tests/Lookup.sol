@@ -0,0 +1,14 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Lookup {
+	mapping(uint => uint) m_map;
+
+	function square(uint key) public view returns (uint) {
+		return m_map[key] * m_map[key];
+	}
+
+	function get(uint key) public view returns (uint) {
+		require(m_map.exists(key), 101);
+		return m_map[key];
+	}
+}
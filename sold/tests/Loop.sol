@@ -0,0 +1,10 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Loop {
+	uint m_value;
+
+	function sum(uint n) public view returns (uint s) {
+		for (uint i = 0; i < n; ++i)
+			s += m_value;
+	}
+}
@@ -0,0 +1,15 @@
+pragma tvm-solidity >=0.50.0;
+
+contract NewArray {
+	uint8[] m_bytes;
+	uint32[] m_words;
+
+	function makeConst() public {
+		m_bytes = new uint8[](5);
+		m_words = new uint32[](1000);
+	}
+
+	function make(uint32 n) public {
+		m_words = new uint32[](n);
+	}
+}
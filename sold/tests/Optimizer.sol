@@ -0,0 +1,14 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Optimizer {
+	uint m_value;
+
+	function set(uint value) public {
+		tvm.accept();
+		m_value = value;
+	}
+
+	function get() public view returns (uint) {
+		return m_value;
+	}
+}
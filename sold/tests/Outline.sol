@@ -0,0 +1,27 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Outline {
+	uint m_a;
+	uint m_b;
+
+	function f(uint a, uint b) public {
+		tvm.accept();
+		m_a = (a * 3 + m_b) / 7 + (m_a ^ b) * 11;
+		m_b = (m_b & a) + m_a % 13;
+		m_a += 3;
+	}
+
+	function g(uint a, uint b) public {
+		tvm.accept();
+		m_a = (a * 3 + m_b) / 7 + (m_a ^ b) * 11;
+		m_b = (m_b & a) + m_a % 13;
+		m_b += 5;
+	}
+
+	function h(uint a, uint b) public {
+		tvm.accept();
+		m_a = (a * 3 + m_b) / 7 + (m_a ^ b) * 11;
+		m_b = (m_b & a) + m_a % 13;
+		m_a += m_b;
+	}
+}
@@ -0,0 +1,17 @@
+pragma tvm-solidity >=0.50.0;
+
+contract Selector {
+	uint m_value;
+
+	function hot(uint value) public functionID(0x10) {
+		m_value = value;
+	}
+
+	function a() public view returns (uint) {
+		return m_value;
+	}
+
+	function b() public view returns (uint) {
+		return m_value + 1;
+	}
+}
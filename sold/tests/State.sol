@@ -0,0 +1,31 @@
+pragma tvm-solidity >=0.50.0;
+
+contract State {
+	uint m_a;
+	uint64 m_b;
+	mapping(uint => uint) m_c;
+
+	function setA(uint a) public {
+		m_a = a;
+	}
+
+	function setB(uint64 b) public {
+		m_b = b;
+	}
+
+	function setC(uint key, uint value) public {
+		m_c[key] = value;
+	}
+
+	function setReplayProtection(uint64 value) public {
+		tvm.setReplayProtectionValue(value);
+	}
+
+	function getA() public view returns (uint) {
+		return m_a;
+	}
+
+	function getB() public view returns (uint64) {
+		return m_b;
+	}
+}
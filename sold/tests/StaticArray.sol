@@ -0,0 +1,40 @@
+pragma tvm-solidity >=0.50.0;
+
+contract StaticArray {
+	uint8[4] m_arr;
+
+	event Values(uint8[4] values);
+
+	function set(uint i, uint8 value) public {
+		m_arr[i] = value;
+	}
+
+	function at(uint i) public view returns (uint8) {
+		// throws ArrayIndexOutOfRange if i >= m_arr.length
+		return m_arr[i];
+	}
+
+	function local(bool flag) public pure returns (uint, bool, uint8[4]) {
+		uint8[4] a;
+		uint len = a.length; // 0, the default value is empty
+		bool empty = a.empty();
+		a.push(1);
+		a.push(2);
+		a.pop();
+		uint8[4] b = [3, 4, 5, 6];
+		return (len, empty, flag ? a : b);
+	}
+
+	function sum() public view returns (uint s) {
+		for (uint8 value : m_arr)
+			s += value;
+	}
+
+	function emitValues() public view {
+		emit Values(m_arr);
+	}
+
+	function encode() public view returns (TvmCell) {
+		return abi.encode(m_arr);
+	}
+}
@@ -0,0 +1,71 @@
+pragma tvm-solidity >=0.50.0;
+
+contract StructMapping {
+	struct Info {
+		uint24 id;
+		uint120 balance;
+		bool active;
+	}
+	struct Inner {
+		uint20 x;
+		uint36 y;
+	}
+	struct Outer {
+		uint13 tag;
+		Inner inner;
+	}
+	struct Other {
+		uint56 id;
+		uint64 balance;
+	}
+	struct WithCell {
+		uint72 a;
+		TvmCell c;
+		uint88 v;
+	}
+	struct Big {
+		uint256 a;
+		uint256 b;
+		uint256 c;
+		uint256 d;
+		uint40 e;
+	}
+
+	mapping(uint32 => Info) m_info;
+	mapping(uint32 => Outer) m_outer;
+	mapping(uint32 => Other) m_other;
+	mapping(uint32 => WithCell) m_withCell;
+	mapping(uint32 => Big) m_big;
+
+	// a missing key gets the default struct
+	function setId(uint32 k, uint24 id) public {
+		m_info[k].id = id;
+	}
+
+	function addBalance(uint32 k, uint120 value) public {
+		m_info[k].balance += value;
+	}
+
+	function activate(uint32 k) public {
+		m_info[k].active = true;
+	}
+
+	function setInnerY(uint32 k, uint36 y) public {
+		m_outer[k].inner.y = y;
+	}
+
+	// the result is used, so the struct is decoded
+	function addOtherBalance(uint32 k, uint64 value) public returns (uint64) {
+		return m_other[k].balance += value;
+	}
+
+	// the cell before `v` is stored in a reference, so `v` has no fixed offset
+	function setWithCell(uint32 k, uint88 v) public {
+		m_withCell[k].v = v;
+	}
+
+	// the struct doesn't fit in the dictionary cell and is stored in a reference
+	function setBig(uint32 k, uint40 e) public {
+		m_big[k].e = e;
+	}
+}
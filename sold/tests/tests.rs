@@ -11,6 +11,10 @@
  */
 
 use assert_cmd::Command;
+use ever_block::{
+    read_single_root_boc, BuilderData, Cell, Deserializable, HashmapE, HashmapType, Serializable,
+    SliceData, StateInit, UInt256,
+};
 use predicates::prelude::*;
 use sold_lib::ERROR_MSG_NO_OUTPUT;
 
@@ -212,3 +216,640 @@ User Documentation
         ));
     Ok(())
 }
+
+#[test]
+fn test_optimizer_stats() -> Status {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Optimizer.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg("OptimizerStats")
+        .arg("--optimizer-rounds")
+        .arg("1")
+        .arg("--optimizer-stats")
+        .assert()
+        .success()
+        .stderr(predicate::str::contains("Optimizer rounds: 1"))
+        .stderr(predicate::str::contains("Optimizer passes:"));
+
+    remove_all_outputs("OptimizerStats")?;
+    Ok(())
+}
+
+#[test]
+fn test_jobs() -> Status {
+    for (jobs, prefix) in [("1", "Jobs1"), ("4", "Jobs4")] {
+        Command::cargo_bin(BIN_NAME)?
+            .arg("tests/Optimizer.sol")
+            .arg("--output-dir")
+            .arg("tests")
+            .arg("--output-prefix")
+            .arg(prefix)
+            .arg("--jobs")
+            .arg(jobs)
+            .assert()
+            .success();
+    }
+    assert_eq!(
+        std::fs::read_to_string("tests/Jobs1.code")?,
+        std::fs::read_to_string("tests/Jobs4.code")?
+    );
+
+    remove_all_outputs("Jobs1")?;
+    remove_all_outputs("Jobs4")?;
+    Ok(())
+}
+
+#[test]
+fn test_hex_pushint_in_assembly() -> Status {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/HexPushint.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .assert()
+        .success();
+
+    remove_all_outputs("HexPushint")?;
+    Ok(())
+}
+
+#[test]
+fn test_function_profile() -> Status {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Selector.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg("SelectorProfile")
+        .arg("--function-profile")
+        .arg("tests/Selector.profile.json")
+        .arg("--optimizer-stats")
+        .assert()
+        .success()
+        .stderr(predicate::str::contains(
+            "Selector internal function selector: 1 hot function(s), 3 function(s) in the dictionary",
+        ))
+        .stderr(predicate::str::contains("hot (frequency 1)"));
+
+    // the report is printed only with --optimizer-stats
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Selector.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg("SelectorProfileQuiet")
+        .arg("--function-profile")
+        .arg("tests/Selector.profile.json")
+        .assert()
+        .success()
+        .stderr(predicate::str::contains("function selector").not());
+    remove_all_outputs("SelectorProfileQuiet")?;
+
+    let code = std::fs::read_to_string("tests/SelectorProfile.code")?;
+    assert!(code.contains("DICTPUSHCONST"));
+
+    remove_all_outputs("SelectorProfile")?;
+    Ok(())
+}
+
+#[test]
+fn test_invalid_function_profile() -> Status {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Selector.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--function-profile")
+        .arg("tests/Selector.sol")
+        .assert()
+        .failure()
+        .stderr(predicate::str::contains("Invalid function profile"));
+
+    Ok(())
+}
+
+#[test]
+fn test_gas_report() -> Status {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Optimizer.sol")
+        .arg("--gas-report")
+        .assert()
+        .success()
+        .stdout(predicate::str::contains(r#""set": {"#))
+        .stdout(predicate::str::contains(r#""get": {"#))
+        .stdout(predicate::str::contains(r#""typical": "#));
+    Ok(())
+}
+
+#[test]
+fn test_optimize_for() -> Status {
+    for objective in ["size", "gas", "balanced"] {
+        Command::cargo_bin(BIN_NAME)?
+            .arg("tests/Optimizer.sol")
+            .arg("--output-dir")
+            .arg("tests")
+            .arg("--output-prefix")
+            .arg(format!("OptimizeFor_{objective}"))
+            .arg("--optimize-for")
+            .arg(objective)
+            .assert()
+            .success();
+    }
+    let size = std::fs::metadata("tests/OptimizeFor_size.tvc")?.len();
+    let gas = std::fs::metadata("tests/OptimizeFor_gas.tvc")?.len();
+    assert!(size <= gas);
+
+    for objective in ["size", "gas", "balanced"] {
+        remove_all_outputs(&format!("OptimizeFor_{objective}"))?;
+    }
+    Ok(())
+}
+
+fn compile_outline(objective: &str) -> Result<(String, u64), Box<dyn std::error::Error>> {
+    let prefix = format!("Outline_{objective}");
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Outline.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg(&prefix)
+        .arg("--optimize-for")
+        .arg(objective)
+        .assert()
+        .success();
+    let code = std::fs::read_to_string(format!("tests/{prefix}.code"))?;
+    let tvc = std::fs::metadata(format!("tests/{prefix}.tvc"))?.len();
+    remove_all_outputs(&prefix)?;
+    Ok((code, tvc))
+}
+
+#[test]
+fn test_outline_for_size() -> Status {
+    // the statements repeated in each function (they are on different lines) are moved
+    // to a fragment that is called by CALLREF
+    let (size_code, size_tvc) = compile_outline("size")?;
+    assert!(size_code.contains(".fragment __outlined"));
+    assert!(size_code.contains("CALLREF {"));
+    // the locations aren't outlined, so each function still points at its own lines
+    assert!(!fragment(&size_code, "__outlined0").contains(".loc "));
+    let (balanced_code, balanced_tvc) = compile_outline("balanced")?;
+    assert!(!balanced_code.contains("__outlined"));
+    assert!(size_tvc < balanced_tvc);
+    Ok(())
+}
+
+fn compile_state(prefix: &str, option: Option<&str>) -> Result<String, Box<dyn std::error::Error>> {
+    let mut cmd = Command::cargo_bin(BIN_NAME)?;
+    cmd.arg("tests/State.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg(prefix);
+    if let Some(option) = option {
+        cmd.arg(option);
+    }
+    cmd.assert().success();
+    let code = std::fs::read_to_string(format!("tests/{prefix}.code"))?;
+    remove_all_outputs(prefix)?;
+    Ok(code)
+}
+
+#[test]
+fn test_lazy_state_loading() -> Status {
+    let default = compile_state("StateDefault", None)?;
+    let lazy = compile_state("StateLazy", Some("--lazy-state-loading"))?;
+    assert_ne!(default, lazy);
+    Ok(())
+}
+
+fn fragment<'a>(code: &'a str, name: &str) -> &'a str {
+    let start = code
+        .find(&format!(".fragment {name}, {{"))
+        .unwrap_or_else(|| panic!("no fragment {name}"));
+    let len = code[start..].find("\n}\n").unwrap();
+    &code[start..start + len]
+}
+
+#[test]
+fn test_partial_state_saving() -> Status {
+    let default = compile_state("StateFull", None)?;
+    let partial = compile_state("StatePartial", Some("--partial-state-saving"))?;
+    // by default every function that can change the state saves all of c4
+    assert!(fragment(&default, "setB").contains("c7_to_c4"));
+    // only m_b is re-encoded, the rest of c4 is copied
+    assert!(!fragment(&partial, "setB").contains("c7_to_c4"));
+    // the replay protection value is stored in the header of c4, which is only saved by c7_to_c4
+    assert!(fragment(&partial, "setReplayProtection").contains("c7_to_c4"));
+    Ok(())
+}
+
+fn compile_layout(prefix: &str, options: &[&str]) -> Result<Vec<String>, Box<dyn std::error::Error>> {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Layout.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg(prefix)
+        .arg("--abi-json")
+        .args(options)
+        .assert()
+        .success();
+    let abi_file = format!("tests/{prefix}.abi.json");
+    let abi: serde_json::Value = serde_json::from_str(&std::fs::read_to_string(&abi_file)?)?;
+    std::fs::remove_file(abi_file)?;
+    let names = abi["fields"]
+        .as_array()
+        .unwrap()
+        .iter()
+        .map(|field| field["name"].as_str().unwrap().to_string())
+        .filter(|name| name.starts_with("m_"))
+        .collect();
+    Ok(names)
+}
+
+#[test]
+fn test_storage_layout() -> Status {
+    assert_eq!(
+        compile_layout("LayoutDefault", &[])?,
+        ["m_cold", "m_hot", "m_new"]
+    );
+    assert_eq!(
+        compile_layout("LayoutOptimized", &["--optimize-storage-layout"])?,
+        ["m_hot", "m_new", "m_cold"]
+    );
+    // variables of the previous version keep their order, new ones follow them
+    assert_eq!(
+        compile_layout(
+            "LayoutPinned",
+            &[
+                "--optimize-storage-layout",
+                "--storage-layout",
+                "tests/Layout.previous.abi.json"
+            ]
+        )?,
+        ["m_cold", "m_hot", "m_new"]
+    );
+    Ok(())
+}
+
+#[test]
+fn test_dead_function_eliminator_keeps_entry_points() -> Status {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Dispatch.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg("DispatchEntryPoints")
+        .assert()
+        .success();
+
+    // public functions are called only through the dictionary of the function selector
+    let code = std::fs::read_to_string("tests/DispatchEntryPoints.code")?;
+    for i in 0..9 {
+        let name = format!("f{i}");
+        fragment(&code, &name);
+        assert!(code.contains(&format!(" = {name},")));
+    }
+    for name in ["receive", "fallback", "on_bounce"] {
+        fragment(&code, name);
+    }
+
+    remove_all_outputs("DispatchEntryPoints")?;
+    Ok(())
+}
+
+#[test]
+fn test_inline_threshold() -> Status {
+    // `add` has two call sites, so it's inlined only if it's small enough
+    for (threshold, inlined) in [("0", false), ("100000", true)] {
+        let assert = Command::cargo_bin(BIN_NAME)?
+            .arg("tests/Inline.sol")
+            .arg("--output-dir")
+            .arg("tests")
+            .arg("--output-prefix")
+            .arg("InlineThreshold")
+            .arg("--optimizer-stats")
+            .arg("--inline-threshold")
+            .arg(threshold)
+            .assert()
+            .success();
+        let stderr = String::from_utf8(assert.get_output().stderr.clone())?;
+        assert_eq!(stderr.contains("inlined calls of add_"), inlined);
+    }
+
+    remove_all_outputs("InlineThreshold")?;
+    Ok(())
+}
+
+#[test]
+fn test_inline_threshold_off() -> Status {
+    // threshold 0 turns the inliner off, even functions with one call site (`twice`) are called by CALLREF
+    let assert = Command::cargo_bin(BIN_NAME)?
+        .arg("tests/Inline.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg("InlineOff")
+        .arg("--optimizer-stats")
+        .arg("--inline-threshold")
+        .arg("0")
+        .assert()
+        .success();
+    let stderr = String::from_utf8(assert.get_output().stderr.clone())?;
+    assert!(!stderr.contains("inlined calls of"));
+
+    let code = std::fs::read_to_string("tests/InlineOff.code")?;
+    for name in ["add", "twice"] {
+        assert!(code.contains(&format!(".fragment {name}_")), "{name} is inlined");
+    }
+
+    remove_all_outputs("InlineOff")?;
+    Ok(())
+}
+
+#[test]
+fn test_function_selector_without_profile() -> Status {
+    // without a profile both small and large contracts find all public functions in the dictionary
+    for (name, functions) in [
+        ("Optimizer", vec!["set".to_string(), "get".to_string()]),
+        ("Dispatch", (0..9).map(|i| format!("f{i}")).collect()),
+    ] {
+        Command::cargo_bin(BIN_NAME)?
+            .arg(format!("tests/{name}.sol"))
+            .arg("--output-dir")
+            .arg("tests")
+            .arg("--output-prefix")
+            .arg(format!("{name}NoProfile"))
+            .assert()
+            .success()
+            .stderr(predicate::str::contains("function selector").not());
+
+        let code = std::fs::read_to_string(format!("tests/{name}NoProfile.code"))?;
+        assert!(code.contains("DICTPUSHCONST 32"));
+        for function in functions {
+            assert!(code.contains(&format!(" = {function},")), "{function} isn't in the dictionary");
+        }
+        remove_all_outputs(&format!("{name}NoProfile"))?;
+    }
+    Ok(())
+}
+
+fn compile_code(name: &str, prefix: &str, options: &[&str]) -> Result<String, Box<dyn std::error::Error>> {
+    Command::cargo_bin(BIN_NAME)?
+        .arg(format!("tests/{name}.sol"))
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg(prefix)
+        .args(options)
+        .assert()
+        .success();
+    let code = std::fs::read_to_string(format!("tests/{prefix}.code"))?;
+    remove_all_outputs(prefix)?;
+    Ok(code)
+}
+
+#[test]
+fn test_compare_function_ids() -> Status {
+    // 3 public functions (with the constructor) are cheaper to compare one by one
+    let dict = compile_code("Optimizer", "CompareDict", &[])?;
+    let compare = compile_code("Optimizer", "Compare", &["--compare-function-ids"])?;
+    assert_ne!(dict, compare);
+    // the dictionary is smaller, so it's kept for --optimize-for size
+    assert_eq!(
+        compile_code("Optimizer", "CompareSizeDict", &["--optimize-for", "size"])?,
+        compile_code("Optimizer", "CompareSize", &["--optimize-for", "size", "--compare-function-ids"])?
+    );
+    // starting from 8 functions only the dictionary is used
+    assert_eq!(
+        compile_code("Dispatch", "CompareLargeDict", &[])?,
+        compile_code("Dispatch", "CompareLarge", &["--compare-function-ids"])?
+    );
+    Ok(())
+}
+
+// value of a result printed by --optimizer-stats, e.g. "  folded instructions: 3"
+fn optimizer_result(stderr: &str, name: &str) -> Option<i64> {
+    let prefix = format!("  {name}: ");
+    stderr
+        .lines()
+        .find_map(|line| line.strip_prefix(&prefix))
+        .map(|value| value.trim().parse().unwrap())
+}
+
+fn optimizer_stats(name: &str, rounds: &str) -> Result<String, Box<dyn std::error::Error>> {
+    optimizer_stats_with(name, &format!("{name}Rounds{rounds}"), rounds, &[])
+}
+
+fn optimizer_stats_with(
+    name: &str,
+    prefix: &str,
+    rounds: &str,
+    options: &[&str],
+) -> Result<String, Box<dyn std::error::Error>> {
+    let assert = Command::cargo_bin(BIN_NAME)?
+        .arg(format!("tests/{name}.sol"))
+        .arg("--output-dir")
+        .arg("tests")
+        .arg("--output-prefix")
+        .arg(prefix)
+        .arg("--optimizer-stats")
+        .arg("--optimizer-rounds")
+        .arg(rounds)
+        .args(options)
+        .assert()
+        .success();
+    remove_all_outputs(prefix)?;
+    Ok(String::from_utf8(assert.get_output().stderr.clone())?)
+}
+
+#[test]
+fn test_constant_propagation() -> Status {
+    let stats = optimizer_stats("Fold", "10")?;
+    assert!(optimizer_result(&stats, "folded instructions").unwrap() > 0);
+    assert!(optimizer_result(&stats, "removed branches").unwrap() > 0);
+    // the pass runs in the rounds of the function optimizer
+    let stats = optimizer_stats("Fold", "0")?;
+    assert_eq!(optimizer_result(&stats, "folded instructions"), None);
+    Ok(())
+}
+
+#[test]
+fn test_loop_invariant_hoisting() -> Status {
+    // m_value isn't changed in the loop, so it's read once before the loop, and the loop body
+    // (the continuations, so the lines with two tabs) takes it from the stack
+    let code = compile_code("Loop", "Loop", &[])?;
+    let reads: Vec<_> = function_body(&code, "sum")
+        .lines()
+        .filter(|line| line.trim() == "GETGLOB 10")
+        .map(str::to_owned)
+        .collect();
+    assert_eq!(reads, ["\tGETGLOB 10"]);
+    let code = compile_code("Loop", "LoopNoDataflow", &["--no-dataflow-passes"])?;
+    assert!(function_body(&code, "sum").contains("\t\tGETGLOB 10"));
+    Ok(())
+}
+
+#[test]
+fn test_dict_lookup_elimination() -> Status {
+    // the second lookup of the same key in each function reuses the result of the first one
+    let lookups = |code: &str, name: &str| {
+        function_body(code, name)
+            .lines()
+            .filter(|line| line.trim_start().starts_with("DICTUGET"))
+            .count()
+    };
+    let code = compile_code("Lookup", "Lookup", &[])?;
+    let unoptimized = compile_code("Lookup", "LookupNoDataflow", &["--no-dataflow-passes"])?;
+    for name in ["square", "get"] {
+        assert_eq!(lookups(&code, name), 1, "{name}");
+        assert_eq!(lookups(&unoptimized, name), 2, "{name}");
+    }
+    Ok(())
+}
+
+#[test]
+fn test_no_dataflow_passes() -> Status {
+    for name in ["Fold", "Loop", "Lookup"] {
+        let prefix = format!("{name}NoDataflow");
+        let stats = optimizer_stats_with(name, &prefix, "10", &["--no-dataflow-passes"])?;
+        assert!(stats.contains("PeepholeOptimizer"));
+        for pass in ["DictLookupEliminator", "LoopInvariantHoister", "ConstantPropagator"] {
+            assert!(!stats.contains(pass), "{pass} runs for {name}");
+        }
+    }
+    Ok(())
+}
+
+#[test]
+fn test_deep_stack_squashing() -> Status {
+    // the compiler checks that squashed and found stack opcodes have the same stack effect as the original ones,
+    // the search for deep stacks runs only with --optimize-for gas
+    for objective in ["balanced", "gas"] {
+        let stats = optimizer_stats_with("DeepStack", &format!("DeepStack_{objective}"), "10", &["--optimize-for", objective])?;
+        assert!(stats.contains("PeepholeOptimizer"));
+    }
+    Ok(())
+}
+
+#[test]
+fn test_assign_member_of_struct_in_mapping() -> Status {
+    let code = compile_code("StructMapping", "StructMapping", &[])?;
+    // members are updated in the encoded struct: the prefix before the member is split off
+    // by LDSLICE <offset>, the old value is skipped or loaded, the rest of the struct is kept
+    assert!(code.contains("SDSKIPFIRST"));
+    assert!(code.contains("LDSLICE 24")); // Info.balance
+    assert!(code.contains("LDSLICE 144")); // Info.active
+    assert!(code.contains("LDSLICE 33")); // Outer.inner.y
+    // fallbacks decode and encode the whole struct
+    assert!(!code.contains("LDSLICE 56")); // the result of the assignment is used
+    assert!(!code.contains("LDSLICE 72")); // a member after a cell
+    assert!(!code.contains("LDSLICEX")); // a struct stored in a reference
+    // a missing key gets the encoded default struct before the member is replaced
+    let set_id = fragment(&code, "setId");
+    assert!(set_id.contains("DICTUGET"));
+    assert!(set_id.contains("IFNOT"));
+    assert!(set_id.contains("SDSKIPFIRST"));
+    Ok(())
+}
+
+// the code of a public function without its name and source locations. The function is either
+// inlined into its wrapper or kept in the fragment `<name>_<id>_internal`.
+fn function_body(code: &str, name: &str) -> String {
+    let internal = code.lines().find_map(|line| {
+        line.strip_prefix(".fragment ")
+            .and_then(|rest| rest.strip_suffix(", {"))
+            .filter(|f| f.starts_with(&format!("{name}_")) && f.ends_with("_internal"))
+    });
+    fragment(code, internal.unwrap_or(name))
+        .lines()
+        .skip(1)
+        .filter(|line| !line.trim_start().starts_with(".loc "))
+        .collect::<Vec<_>>()
+        .join("\n")
+}
+
+#[test]
+fn test_for_each_over_keys_and_values() -> Status {
+    let code = compile_code("KeysValues", "KeysValues", &[])?;
+    // `m.keys()` and `m.values()` in a for loop are compiled as the iteration over the mapping itself,
+    // so the keys aren't collected into an array, values aren't decoded for keys and the mapping
+    // is a snapshot taken before the loop, as in `for ((k, v) : m)`
+    for (name, pairs) in [
+        ("sumKeys", "sumKeysOfPairs"),
+        ("sumValues", "sumValuesOfPairs"),
+        ("shiftKeys", "shiftKeysOfPairs"),
+    ] {
+        assert!(!function_body(&code, name).contains("UNTUPLE 2"), "{name} builds an array");
+        assert_eq!(function_body(&code, name), function_body(&code, pairs));
+    }
+    assert!(!function_body(&code, "sumKeys").contains("LDU 64"));
+    Ok(())
+}
+
+// the dictionary of an array of `len` equal elements, built by inserting the elements one by one
+fn array_dict(len: u32, value: &BuilderData) -> Result<Cell, Box<dyn std::error::Error>> {
+    let mut dict = HashmapE::with_bit_len(32);
+    for key in 0..len {
+        dict.set_builder(SliceData::load_builder(key.write_to_new_cell()?)?, value)?;
+    }
+    Ok(dict.data().ok_or("empty dictionary")?.clone())
+}
+
+fn contains_cell(root: &Cell, hash: &UInt256) -> bool {
+    root.repr_hash() == *hash
+        || (0..root.references_count())
+            .any(|i| root.reference(i).map_or(false, |cell| contains_cell(&cell, hash)))
+}
+
+#[test]
+fn test_new_array() -> Status {
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/NewArray.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .assert()
+        .success();
+
+    let code = std::fs::read_to_string("tests/NewArray.code")?;
+    let tvc = read_single_root_boc(std::fs::read("tests/NewArray.tvc")?)?;
+    let tvc_code = StateInit::construct_from_cell(tvc)?.code.ok_or("no code")?;
+    // arrays of constant length are computed at compile time and must be the same as the ones
+    // filled element by element
+    for (len, bits) in [(5, 8), (1000, 32)] {
+        let dict = array_dict(len, &BuilderData::with_raw(vec![0; bits / 8], bits)?)?;
+        assert!(contains_cell(&tvc_code, &dict.repr_hash()), "no dictionary of new uint{bits}[]({len})");
+        assert!(code.contains(&format!("PUSHINT {len}")), "no length of new uint{bits}[]({len})");
+    }
+    // runtime length is range-checked as REPEAT did: 0 <= n < 2^31
+    let make = function_body(&code, "make");
+    assert!(!make.contains("REPEAT"));
+    assert!(make.contains("UBITSIZE"));
+    assert!(make.contains("GTINT 31"));
+    assert!(make.contains("THROWIF 5"));
+
+    remove_all_outputs("NewArray")?;
+    Ok(())
+}
+
+#[test]
+fn test_static_array() -> Status {
+    // statically sized arrays are arrays with a dictionary, so push() and pop() can be used with them
+    Command::cargo_bin(BIN_NAME)?
+        .arg("tests/StaticArray.sol")
+        .arg("--output-dir")
+        .arg("tests")
+        .assert()
+        .success();
+
+    let code = std::fs::read_to_string("tests/StaticArray.code")?;
+    // index access looks up the dictionary and throws ArrayIndexOutOfRange for a missing index
+    assert!(code.contains("DICTUGET"));
+    assert!(code.contains("THROWIFNOT 50"));
+    // state variables are loaded and saved without converting elements one by one
+    assert!(!fragment(&code, "c4_to_c7").contains("REPEAT"));
+    assert!(!fragment(&code, "c7_to_c4").contains("REPEAT"));
+
+    remove_all_outputs("StaticArray")?;
+    Ok(())
+}